@@ -1,10 +1,7 @@
 #include <fcntl.h>
-#include <fstream>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
-#include <sys/ioctl.h>
 #include <unistd.h>
 #include <termios.h>
 #include <dirent.h>
@@ -12,15 +9,9 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <string.h>
-
-struct framebuffer_info
-{
-    uint32_t bits_per_pixel;
-    uint32_t xres_virtual;
-    uint32_t yres_virtual;
-};
-
-struct framebuffer_info get_framebuffer_info(const char *framebuffer_device_path);
+#include "../../common/cam_capture.h"
+#include "../../common/fb_sink.h"
+#include "../../common/fb_letterbox.h"
 
 // ----- helper: check if directory exists -----
 bool dir_exists(const char *path)
@@ -73,19 +64,23 @@ int kbhit()
 int main(int argc, const char *argv[])
 {
     cv::Mat frame;
-    cv::VideoCapture camera(2);
+    cam_config cam_cfg;
+    cam_cfg.path = cam_default_path("/dev/video2");
+    cam_cfg.outputs = CAM_OUT_DISPLAY;     // BGR only for screenshots
+    cam_capture camera;
 
-    framebuffer_info fb_info = get_framebuffer_info("/dev/fb0");
-    std::ofstream ofs("/dev/fb0", std::ios::out | std::ios::binary);
-
-    if (!camera.isOpened())
+    if (!cam_open(camera, cam_cfg))
     {
         std::cerr << "Could not open video device." << std::endl;
         return 1;
     }
 
-    int fb_width = fb_info.xres_virtual;
-    int fb_height = fb_info.yres_virtual;
+    fb_sink fb;
+    if (!fb_sink_open(fb, fb_default_path()))
+        return 1;
+
+    int fb_width = fb.width;
+    int fb_height = fb.height;
     double target_aspect = 4.0 / 3.0;
 
     // ---------- Create new screenshot directory ----------
@@ -108,13 +103,17 @@ int main(int argc, const char *argv[])
     std::cout << "Saving screenshots to: " << save_dir << std::endl;
 
     int screenshot_count = 0;
+    fb_letterbox letterbox;
 
     while (true)
     {
-        if (!camera.read(frame))
-            continue;
+        // borrow the driver's buffer; it is shown straight from YUV and
+        // given back at the end of the loop
+        cam_frame grabbed;
+        if (!cam_grab(camera, grabbed))
+            break;
 
-        double cam_aspect = static_cast<double>(frame.cols) / frame.rows;
+        double cam_aspect = static_cast<double>(grabbed.width) / grabbed.height;
         int new_width, new_height;
         if (cam_aspect > target_aspect)
         {
@@ -127,30 +126,19 @@ int main(int argc, const char *argv[])
             new_width = static_cast<int>(fb_height * target_aspect);
         }
 
-        cv::Mat resized;
-        cv::resize(frame, resized, cv::Size(new_width, new_height));
-
-        cv::Mat display(fb_height, fb_width, CV_8UC3, cv::Scalar(0, 0, 0));
-        int x_offset = (fb_width - resized.cols) / 2;
-        int y_offset = (fb_height - resized.rows) / 2;
-        resized.copyTo(display(cv::Rect(x_offset, y_offset, resized.cols, resized.rows)));
-
-        cv::Mat frame_bgr565;
-        cv::cvtColor(display, frame_bgr565, cv::COLOR_BGR2BGR565);
+        // scale, letterbox and convert YUV to the screen format in one pass,
+        // straight into the framebuffer (only the camera view is rewritten)
+        fb_rect view;
+        view.w = new_width;
+        view.h = new_height;
+        view.x = (fb_width - new_width) / 2;
+        view.y = (fb_height - new_height) / 2;
+        cam_show(fb, letterbox, grabbed, view);
+        fb_present(fb);
 
-        for (int y = 0; y < fb_height; y++)
-        {
-            std::streamoff row_offset =
-                static_cast<std::streamoff>(y) *
-                static_cast<std::streamoff>(fb_info.xres_virtual) *
-                static_cast<std::streamoff>(fb_info.bits_per_pixel / 8);
-            ofs.seekp(row_offset, std::ios::beg);
-
-            const char *row_ptr = reinterpret_cast<const char *>(frame_bgr565.ptr(y));
-            std::size_t bytes_to_write =
-                static_cast<std::size_t>(fb_width) * static_cast<std::size_t>(fb_info.bits_per_pixel / 8);
-            ofs.write(row_ptr, static_cast<std::streamsize>(bytes_to_write));
-        }
+        if (fb.frames % 300 == 0)
+            std::cout << "fb: " << fb.bytes_last / 1024 << " KiB written/frame (full screen "
+                      << (size_t)fb_width * fb_height * fb.bytes_per_pixel / 1024 << " KiB)" << std::endl;
 
         // ---------- Non-blocking key detection ----------
         if (kbhit())
@@ -160,38 +148,15 @@ int main(int argc, const char *argv[])
             {
                 char filename[512];
                 snprintf(filename, sizeof(filename), "%s/%d.bmp", save_dir.c_str(), screenshot_count++);
+                cam_bgr(grabbed, frame);
                 cv::imwrite(filename, frame);
                 std::cout << "Captured: " << filename << std::endl;
             }
         }
+        cam_release(camera, grabbed);
     }
 
-    camera.release();
+    cam_close(camera);
+    fb_sink_close(fb);
     return 0;
 }
-
-struct framebuffer_info get_framebuffer_info(const char *framebuffer_device_path)
-{
-    struct framebuffer_info fb_info;
-    struct fb_var_screeninfo screen_info;
-    int fd = open(framebuffer_device_path, O_RDWR);
-    if (fd >= 0)
-    {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &screen_info) == 0)
-        {
-            fb_info.xres_virtual = screen_info.xres_virtual;
-            fb_info.yres_virtual = screen_info.yres_virtual;
-            fb_info.bits_per_pixel = screen_info.bits_per_pixel;
-        }
-        else
-        {
-            fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-        }
-        close(fd);
-    }
-    else
-    {
-        fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-    }
-    return fb_info;
-}
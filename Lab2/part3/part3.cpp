@@ -1,22 +1,15 @@
 #include <fcntl.h>
-#include <fstream>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
-#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 #include <vector>
+#include <chrono>
+#include <cmath>
 #include "lodepng.h"  // include your downloaded decoder
-
-struct framebuffer_info {
-    uint32_t bits_per_pixel;
-    uint32_t xres_virtual;
-    uint32_t yres_virtual;
-};
-
-framebuffer_info get_framebuffer_info(const char *framebuffer_device_path);
+#include "../../common/fb_letterbox.h"
+#include "../../common/fb_sink.h"
 
 // ----- Non-blocking keyboard input -----
 int kbhit() {
@@ -60,21 +53,19 @@ cv::Mat load_png_lodepng(const std::string &filename) {
 }
 
 int main() {
-    framebuffer_info fb_info = get_framebuffer_info("/dev/fb0");
-    int fb_width = fb_info.xres_virtual;
-    int fb_height = fb_info.yres_virtual;
-    int fb_bpp = fb_info.bits_per_pixel;
-
-    if (fb_width == 0 || fb_height == 0) {
-        std::cerr << "Failed to get framebuffer info." << std::endl;
+    fb_sink fb;
+    if (!fb_sink_open(fb, fb_default_path())) {
+        std::cerr << "Failed to open framebuffer." << std::endl;
         return 1;
     }
+    int fb_width = fb.width;
+    int fb_height = fb.height;
 
-    std::ofstream ofs("/dev/fb0", std::ios::out | std::ios::binary);
-    if (!ofs.is_open()) {
-        std::cerr << "Failed to open /dev/fb0" << std::endl;
-        return 1;
-    }
+    // Draw off-screen and flip on vsync instead of rewriting the visible
+    // buffer while it is being scanned out (falls back to single buffer).
+    fb_enable_flip(fb, 2);
+    fb_letterbox out;
+    fb_rect screen = {0, 0, fb_width, fb_height};
 
     // --- Load PNG via lodepng (no libpng needed) ---
     cv::Mat img = load_png_lodepng("advance.png");
@@ -98,36 +89,31 @@ int main() {
     int direction = 1;  // 1 = right, -1 = left
     int total_w = doubled.cols;
 
+    // Scroll by time rather than per frame, so the speed is the same
+    // (50 px per 30 ms, as before) whatever rate vsync lets us run at.
+    const double speed = 50.0 / 0.030;  // px per second
+    double pos = 0.0;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
     std::cout << "Electronic scroll board running (loop mode).\n";
     std::cout << "J → move left,  L → move right,  Q → quit\n";
 
     while (true) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double dt = std::chrono::duration<double>(now - last).count();
+        last = now;
+
         // Wrap offset to create infinite scrolling
-        if (direction == 1) {
-            x_offset += 50;
-            if (x_offset >= scaled_w) x_offset = 0;
-        } else {
-            x_offset -= 50;
-            if (x_offset < 0) x_offset = scaled_w - 1;
-        }
+        pos = std::fmod(pos + direction * speed * dt, (double)scaled_w);
+        if (pos < 0) pos += scaled_w;
+        x_offset = (int)pos;
 
         // Crop visible region (within doubled image)
         cv::Mat view = doubled(cv::Rect(x_offset, 0, fb_width, fb_height));
 
-        cv::Mat bgr565;
-        cv::cvtColor(view, bgr565, cv::COLOR_BGR2BGR565);
-
-        // Write to framebuffer
-        for (int y = 0; y < fb_height; y++) {
-            std::streamoff pos = static_cast<std::streamoff>(y) *
-                                 static_cast<std::streamoff>(fb_info.xres_virtual) *
-                                 static_cast<std::streamoff>(fb_bpp / 8);
-            ofs.seekp(pos, std::ios::beg);
-            const char *row_ptr = reinterpret_cast<const char *>(bgr565.ptr(y));
-            std::size_t bytes_to_write =
-                static_cast<std::size_t>(fb_width) * static_cast<std::size_t>(fb_bpp / 8);
-            ofs.write(row_ptr, static_cast<std::streamsize>(bytes_to_write));
-        }
+        // Convert into the back buffer (screen pixel format) and flip it on screen
+        fb_letterbox_bgr(fb, out, view.data, view.step, fb_width, fb_height, screen);
+        fb_present(fb);
 
         // Keyboard control
         if (kbhit()) {
@@ -137,29 +123,10 @@ int main() {
             if (c == 'q' || c == 'Q') break;           // quit
         }
 
-        usleep(30000);  // smooth refresh
+        if (!fb.vsync) usleep(16000);  // nothing paces us, don't spin
     }
 
-    ofs.close();
+    fb_sink_close(fb);
     std::cout << "Program exited.\n";
     return 0;
 }
-
-framebuffer_info get_framebuffer_info(const char *framebuffer_device_path) {
-    framebuffer_info fb_info;
-    struct fb_var_screeninfo screen_info;
-    int fd = open(framebuffer_device_path, O_RDWR);
-    if (fd >= 0) {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &screen_info) == 0) {
-            fb_info.xres_virtual = screen_info.xres_virtual;
-            fb_info.yres_virtual = screen_info.yres_virtual;
-            fb_info.bits_per_pixel = screen_info.bits_per_pixel;
-        } else {
-            fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-        }
-        close(fd);
-    } else {
-        fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-    }
-    return fb_info;
-}
@@ -1,12 +1,10 @@
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/objdetect.hpp>
 #include <opencv2/face.hpp>
-#include <sys/ioctl.h>
 #include <unistd.h>
 #include <termios.h>
 #include <dirent.h>
@@ -15,19 +13,16 @@
 #include <errno.h>
 #include <string.h>
 #include <map>
+#include "../../common/cam_capture.h"
+#include "../../common/cam_ring.h"
+#include "../../common/fb_sink.h"
+#include "../../common/fb_letterbox.h"
+#include "../../common/latency_stats.h"
 
 using namespace cv;
 using namespace cv::face;
 using namespace std;
 
-struct framebuffer_info {
-    uint32_t bits_per_pixel;
-    uint32_t xres_virtual;
-    uint32_t yres_virtual;
-};
-
-struct framebuffer_info get_framebuffer_info(const char *framebuffer_device_path);
-
 bool dir_exists(const char *path) {
     DIR *dir = opendir(path);
     if (dir) {
@@ -74,19 +69,20 @@ map<int, string> loadLabels(const string &path) {
 }
 
 int main(int argc, const char *argv[]) {
-    Mat frame;
-    VideoCapture camera(2);
-    if (!camera.isOpened()) {
+    cam_config cam_cfg;
+    cam_cfg.path = cam_default_path("/dev/video2");
+    cam_cfg.width = 320;
+    cam_cfg.height = 240;
+    cam_cfg.outputs = CAM_OUT_GRAY | CAM_OUT_DISPLAY;    // no BGR frame needed
+    cam_capture camera;
+    if (!cam_open(camera, cam_cfg)) {
         cerr << "cannot open camara" << endl;
         return 1;
     }
-    camera.set(CV_CAP_PROP_FRAME_WIDTH, 320);
-    camera.set(CAP_PROP_BUFFERSIZE, 1);
 
-    framebuffer_info fb_info = get_framebuffer_info("/dev/fb0");
-    ofstream ofs("/dev/fb0", ios::out | ios::binary);
-    if (!ofs.is_open()) {
-        cerr << "cannot open /dev/fb0" << endl;
+    fb_sink fb;
+    if (!fb_sink_open(fb, fb_default_path())) {
+        cerr << "cannot open framebuffer" << endl;
         return 1;
     }
 
@@ -107,19 +103,29 @@ int main(int argc, const char *argv[]) {
 
     cout << "Successfully loaded LBPH model and labels" << endl;
 
-    int fb_width = fb_info.xres_virtual;
-    int fb_height = fb_info.yres_virtual;
+    int fb_width = fb.width;
+    int fb_height = fb.height;
     double target_aspect = 4.0 / 3.0;
 
     vector<Rect> faces;
+    fb_letterbox letterbox;
+
+    // a capture thread keeps draining the camera; we always get the newest frame
+    cam_ring ring;
+    if (!cam_ring_start(ring, camera)) {
+        cerr << "cannot start camera capture thread" << endl;
+        return 1;
+    }
+    latency_stats glass_to_glass;
 
     while (true) {
-        if (!camera.read(frame)) continue;
+        // the frame stays in the camera's YUV buffer until it is released
+        cam_frame grabbed;
+        if (!cam_ring_latest(ring, grabbed)) break;
 
-        // ---- face detect ----
+        // ---- face detect (grey = the camera's Y, no BGR frame) ----
         Mat gray;
-        cvtColor(frame, gray, COLOR_BGR2GRAY);
-        equalizeHist(gray, gray);
+        equalizeHist(grabbed.gray, gray);
         face_cascade.detectMultiScale(gray, faces, 1.1, 5, 0, Size(80, 80), Size(250, 250));
 
         // ---- face identify ----
@@ -143,73 +149,55 @@ int main(int argc, const char *argv[]) {
 	    sprintf(conf_text, "(%.1f)", confidence);
 
 	    string text = name + " " + conf_text;
-	    rectangle(frame, face, color, 2);
-	    putText(frame, text, Point(face.x, face.y - 10),
+
+	    // only the box + label area goes to BGR for drawing, then back
+	    int baseline = 0;
+	    Size text_size = getTextSize(text, FONT_HERSHEY_SIMPLEX, 0.8, 2, &baseline);
+	    Rect area = Rect(face.x - 2, face.y - 2, face.width + 4, face.height + 4) |
+	                Rect(face.x - 2, face.y - 12 - text_size.height, text_size.width + 4,
+	                     text_size.height + baseline + 4);
+	    Mat patch;
+	    cam_roi_bgr(grabbed, area, patch);
+	    if (patch.empty()) continue;
+	    rectangle(patch, Rect(face.x - area.x, face.y - area.y, face.width, face.height), color, 2);
+	    putText(patch, text, Point(face.x - area.x, face.y - 10 - area.y),
 		    FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
+	    cam_roi_store(grabbed, area, patch);
 	}
 
         // ---- Resize to framebuffer ----
         double scale = 0.5;
-	int display_width  = static_cast<int>(fb_info.xres_virtual * scale);
-	int display_height = static_cast<int>(fb_info.yres_virtual * scale);
-
-	cv::Mat resized;
-	cv::resize(frame, resized, cv::Size(display_width, display_height));
-
-	// 黑色背景畫布
-	cv::Mat display(fb_info.yres_virtual, fb_info.xres_virtual, CV_8UC3, cv::Scalar(0, 0, 0));
-
-	// 置中顯示
-	int x_offset = (fb_info.xres_virtual - resized.cols) / 2;
-	int y_offset = (fb_info.yres_virtual - resized.rows) / 2;
-	resized.copyTo(display(cv::Rect(x_offset, y_offset, resized.cols, resized.rows)));
-
-
-        // ---- transfer to BGR565 and write into framebuffer ----
-        Mat frame_bgr565;
-        cvtColor(display, frame_bgr565, COLOR_BGR2BGR565);
-
-        for (int y = 0; y < fb_height; y++) {
-            streamoff row_offset = static_cast<streamoff>(y) *
-                                   static_cast<streamoff>(fb_info.xres_virtual) *
-                                   static_cast<streamoff>(fb_info.bits_per_pixel / 8);
-            ofs.seekp(row_offset, ios::beg);
-            const char *row_ptr = reinterpret_cast<const char *>(frame_bgr565.ptr(y));
-            size_t bytes_to_write =
-                static_cast<size_t>(fb_width) * static_cast<size_t>(fb_info.bits_per_pixel / 8);
-            ofs.write(row_ptr, static_cast<streamsize>(bytes_to_write));
-        }
+	int display_width  = static_cast<int>(fb_width * scale);
+	int display_height = static_cast<int>(fb_height * scale);
+
+	// 置中顯示，每個 frame 只重寫相機畫面，黑邊不動
+	fb_rect view;
+	view.w = display_width;
+	view.h = display_height;
+	view.x = (fb_width - display_width) / 2;
+	view.y = (fb_height - display_height) / 2;
+
+        // ---- resize + YUV -> screen format straight into framebuffer ----
+        cam_show(fb, letterbox, grabbed, view);
+        fb_present(fb);
+        latency_record(glass_to_glass, cam_now_us() - grabbed.timestamp_us);
+        cam_ring_release(ring, grabbed);
 
         // ---- q to exit ----
         if (kbhit()) {
             char c = getchar();
             if (c == 'q') {
-                cout << "exit" << endl;
+                cout << "exit, fb wrote " << fb.bytes_total / max<uint64_t>(fb.frames, 1) / 1024
+                     << " KiB/frame on average" << endl;
                 break;
             }
         }
     }
 
-    camera.release();
-    ofs.close();
+    cam_ring_stop(ring);
+    cout << "camera frames dropped: " << ring.dropped << " of " << ring.captured << endl;
+    latency_report(glass_to_glass, "camera -> screen");
+    cam_close(camera);
+    fb_sink_close(fb);
     return 0;
 }
-
-struct framebuffer_info get_framebuffer_info(const char *framebuffer_device_path) {
-    struct framebuffer_info fb_info;
-    struct fb_var_screeninfo screen_info;
-    int fd = open(framebuffer_device_path, O_RDWR);
-    if (fd >= 0) {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &screen_info) == 0) {
-            fb_info.xres_virtual = screen_info.xres_virtual;
-            fb_info.yres_virtual = screen_info.yres_virtual;
-            fb_info.bits_per_pixel = screen_info.bits_per_pixel;
-        } else {
-            fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-        }
-        close(fd);
-    } else {
-        fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-    }
-    return fb_info;
-}
@@ -1,45 +1,14 @@
-#include <fcntl.h>
-#include <fstream>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/dnn.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
-#include <sys/ioctl.h>
-#include <unistd.h>
 #include <vector>
-#include <dirent.h>
-#include <sys/stat.h>
-#include <errno.h>
+#include "../../common/fb_sink.h"
+#include "../../common/fb_letterbox.h"
 
 using namespace cv;
 using namespace std;
 
-struct framebuffer_info {
-    uint32_t bits_per_pixel;
-    uint32_t xres_virtual;
-    uint32_t yres_virtual;
-};
-
-framebuffer_info get_framebuffer_info(const char *framebuffer_device_path) {
-    framebuffer_info fb_info;
-    fb_var_screeninfo screen_info;
-    int fd = open(framebuffer_device_path, O_RDWR);
-    if (fd >= 0) {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &screen_info) == 0) {
-            fb_info.xres_virtual = screen_info.xres_virtual;
-            fb_info.yres_virtual = screen_info.yres_virtual;
-            fb_info.bits_per_pixel = screen_info.bits_per_pixel;
-        } else {
-            fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-        }
-        close(fd);
-    } else {
-        fb_info.xres_virtual = fb_info.yres_virtual = fb_info.bits_per_pixel = 0;
-    }
-    return fb_info;
-}
-
 int main() {
     string cfgFile = "./yolov3.cfg";
     string weightsFile = "./yolov3_best.weights";
@@ -123,42 +92,33 @@ int main() {
     cout << "結果輸出到：" << outputPath << endl;
 
     // ---- Framebuffer 顯示 ----
-    framebuffer_info fb_info = get_framebuffer_info("/dev/fb0");
-    ofstream ofs("/dev/fb0", ios::out | ios::binary);
-
-    if (!ofs.is_open()) {
+    fb_sink fb;
+    if (!fb_sink_open(fb, fb_default_path())) {
         cerr << "⚠️ 無法開啟 framebuffer" << endl;
         return 0;
     }
 
-    int fb_w = fb_info.xres_virtual;
-    int fb_h = fb_info.yres_virtual;
-
-    Mat resized;
+    int fb_w = fb.width;
+    int fb_h = fb.height;
 
     double fb_aspect = (double)fb_w / fb_h;
     double img_aspect = (double)W / H;
 
-    if (img_aspect > fb_aspect)
-        resize(img, resized, Size(fb_w, fb_w / img_aspect));
-    else
-        resize(img, resized, Size(fb_h * img_aspect, fb_h));
-
-    Mat canvas(fb_h, fb_w, CV_8UC3, Scalar(0,0,0));
-    int x_off = (fb_w - resized.cols) / 2;
-    int y_off = (fb_h - resized.rows) / 2;
-    resized.copyTo(canvas(Rect(x_off, y_off, resized.cols, resized.rows)));
-
-    Mat bgr565;
-    cvtColor(canvas, bgr565, COLOR_BGR2BGR565);
-
-    for (int y = 0; y < fb_h; y++) {
-        streamoff offset = (streamoff)y * fb_info.xres_virtual * (fb_info.bits_per_pixel / 8);
-        ofs.seekp(offset, ios::beg);
-        ofs.write((char*)bgr565.ptr(y), fb_w * (fb_info.bits_per_pixel / 8));
+    fb_rect view;
+    if (img_aspect > fb_aspect) {
+        view.w = fb_w;
+        view.h = (int)(fb_w / img_aspect);
+    } else {
+        view.w = (int)(fb_h * img_aspect);
+        view.h = fb_h;
     }
+    view.x = (fb_w - view.w) / 2;
+    view.y = (fb_h - view.h) / 2;
+
+    fb_letterbox lb;
+    fb_letterbox_bgr(fb, lb, img.data, img.step, img.cols, img.rows, view);
 
-    ofs.close();
+    fb_sink_close(fb);
     cout << "📺 HDMI 顯示完成！" << endl;
 
     return 0;
@@ -1,34 +1,63 @@
 #include <fcntl.h>
-#include <fstream>
+#include <stdio.h>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
 #include <unistd.h>
 #include <termios.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
 #include <ncnn/net.h>
 #include <ncnn/mat.h>
 #include <vector>
 #include <algorithm>
-#include <numeric>
 #include <string>   // NEW
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../../common/cam_capture.h"
+#include "../../common/cam_ring.h"
+#include "../../common/fb_sink.h"
+#include "../../common/fb_letterbox.h"
+#include "../../common/latest_slot.h"
+#include "../../common/bounded_queue.h"
+#include "../../common/infer_scheduler.h"
+#include "../../common/infer_size.h"
+#include "../../common/box_tracker.h"
+#include "../../common/roi_detect.h"
+#include "../../common/yolo_decode.h"
+#include "../../common/yolo_model.h"
+#include "../../common/nms.h"
+#include "../../common/latency_stats.h"
+#include "../../common/ncnn_pool.h"
+#include "../../common/alloc_counter.h"
 
 using namespace std;
 using namespace cv;
 
 //================ YOLO Settings ================
-const int INPUT_SIZE = 320;
+const char *MODEL_BASE = "./yolov8n320";    // .ncnn.param/.bin，int8 是 -int8.ncnn.param/.bin
+// input 大小跑的時候切換（224 / 320 / 416，同一個模型）：看 extract 花多久、追蹤到的最小物體多大
+// YOLO_INPUT_SIZE=320 之類的可以固定成一個大小
+const int INPUT_SIZE_INITIAL = 320;
+const double EXTRACT_BUDGET_MS = 80;     // extract 超過這個就換小一點的 input
+// YOLO_ROI=1：兩次整張偵測之間，只在追蹤中物體周圍的 crop 上跑（拼成一張 160x160 / 320x160 / 320x320）
+const double ROI_FULL_INTERVAL_S = 1.0;  // 至少這麼常跑一次整張（找新出現的物體）
+const char *CALIB_DIR = "./calib_frames";   // 按 c 開始 / 停止存 INT8 校正用的 frame
 const int NUM_CLASSES = 80;
 const float CONF_THRESH = 0.1f;
 const float NMS_THRESH = 0.45f;
-const int SKIP_FRAMES = 2;    // 每 2 frame 才推論一次 YOLO
+// 不再固定每 N frame 推論一次：infer_scheduler 看 extract 花多久、螢幕實際 FPS 自己決定
+const double DISPLAY_FPS_FLOOR = 20;     // 螢幕至少要這麼順
+const double DETECT_FPS_CEILING = 10;    // 一秒最多偵測幾次（中間的 frame 由 tracker 推算框的位置）
+const uint64_t ALLOC_WARMUP_FRAMES = 10; // 前幾張 pool 還在長，malloc 次數分開算
 
 struct Object {
     Rect rect;
     int label;
     float prob;
+    int track_id = 0;    // tracker 給的 id（0 = 還沒追蹤）
 };
 
 //================ 只保留的 8 個類別 ================
@@ -36,23 +65,8 @@ struct Object {
 // bottle=39, cup=41, spoon=44, banana=46,
 // keyboard=66, cell phone=67, book=73, scissors=76
 
-// 判斷這個類別是不是我們要的 8 種之一  // NEW
-bool is_target_class(int cls)
-{
-    switch (cls) {
-        case 39: // bottle
-        case 41: // cup
-        case 44: // spoon
-        case 46: // banana
-        case 66: // keyboard
-        case 67: // cell phone
-        case 73: // book
-        case 76: // scissors
-            return true;
-        default:
-            return false;
-    }
-}
+// decoder 只讀這 8 個類別的 row，其他 72 類完全不碰
+const int TARGET_CLASSES[8] = {39, 41, 44, 46, 66, 67, 73, 76};
 
 // 把類別 id 轉成對應名字              // NEW
 std::string class_name(int cls)
@@ -70,64 +84,6 @@ std::string class_name(int cls)
     }
 }
 
-//================ NMS ================
-float intersection_area(const Object &a, const Object &b) {
-    Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
-}
-
-void nms_custom(const vector<Object> &objs, vector<Object> &picked, float thr) {
-    picked.clear();
-    if (objs.empty()) return;
-
-    vector<int> idx(objs.size());
-    iota(idx.begin(), idx.end(), 0);
-
-    sort(idx.begin(), idx.end(), [&](int a, int b) {
-        return objs[a].prob > objs[b].prob;
-    });
-
-    for (int i : idx) {
-        const Object &a = objs[i];
-        bool keep = true;
-
-        for (const auto &b : picked) {
-            float inter = intersection_area(a, b);
-            float uni = a.rect.area() + b.rect.area() - inter;
-            if (uni <= 0.f) continue;
-
-            if (inter / uni > thr) {
-                keep = false;
-                break;
-            }
-        }
-        if (keep) picked.push_back(a);
-    }
-}
-
-//================ Framebuffer ================
-struct framebuffer_info {
-    uint32_t bits_per_pixel;
-    uint32_t xres;
-    uint32_t yres;
-};
-
-framebuffer_info get_fb_info(const char *path) {
-    framebuffer_info fb{};
-    fb_var_screeninfo info{};
-
-    int fd = open(path, O_RDWR);
-    if (fd >= 0) {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &info) == 0) {
-            fb.xres = info.xres_virtual;
-            fb.yres = info.yres_virtual;
-            fb.bits_per_pixel = info.bits_per_pixel;
-        }
-        close(fd);
-    }
-    return fb;
-}
-
 //================ Keyboard ================
 int kbhit() {
     termios oldt, newt;
@@ -154,179 +110,545 @@ int kbhit() {
     return 0;
 }
 
-//================ Letterbox ================
-ncnn::Mat letterbox(const Mat &img, int target, float &scale, int &pad_x, int &pad_y) {
-    int w = img.cols, h = img.rows;
-
-    float r = min((float)target / w, (float)target / h);
-    int nw = round(w * r);
-    int nh = round(h * r);
-
-    scale = r;
-    pad_x = (target - nw) / 2;
-    pad_y = (target - nh) / 2;
-
-    Mat resized;
-    resize(img, resized, Size(nw, nh));
-
-    Mat canvas(target, target, CV_8UC3, Scalar(0, 0, 0));
-    resized.copyTo(canvas(Rect(pad_x, pad_y, nw, nh)));
+//================ INT8 校正 frame ================
+bool make_dir(const char *path) {
+    if (mkdir(path, 0777) == 0 || errno == EEXIST) return true;
+    cerr << "[ERR] mkdir " << path << ": " << strerror(errno) << "\n";
+    return false;
+}
 
-    ncnn::Mat in = ncnn::Mat::from_pixels(canvas.data, ncnn::Mat::PIXEL_BGR, target, target);
-    const float norm[3] = {1/255.f, 1/255.f, 1/255.f};
-    in.substract_mean_normalize(nullptr, norm);
+//================ Detect（拆成三段，每段一個 thread）================
+// letterbox → ncnn extract → decode + NMS，frame N 在 extract 的時候 frame N+1 已經在 letterbox
+struct Job {
+    Mat image;              // 原始 BGR frame（letterbox 完就不需要了）
+    int64_t t_capture_us;
+    int size;               // 這次的 network input 大小（整張的時候）
+    float to_frame;         // image 的座標 × to_frame = 顯示 frame 的座標（image 照 size 另外解碼的時候不是 1）
+    bool roi;               // 只跑 plan 裡的 crop（roi_detect）
+    roi_plan plan;
+    ncnn::Mat in, out;
+    float scale;
+    int pad_x, pad_y;
+};
 
-    return in;
+// input buffer 重複使用（extract 用完就回到 net_in），一次 pass 縮放 + 正規化直接寫進去
+void stage_letterbox(yolo_input &net_in, Job &job) {
+    if (job.roi)
+        job.in = yolo_mosaic(net_in, job.image, job.plan);
+    else
+        job.in = yolo_letterbox(net_in, job.image, job.size, job.scale, job.pad_x, job.pad_y);
+    job.image.release();
 }
 
-//================ Main ================
-int main() {
-    // Load YOLO model
-    ncnn::Net net;
-    net.opt.num_threads = 4;
-    net.opt.use_fp16_storage = true;
-    net.opt.use_vulkan_compute = false;
+// 每張一個新的 extractor（ncnn 的 Extractor 用完 clear() 之後 blob 表就空了，不能再 input / extract）
+// blob / workspace 的 allocator 在 net.opt 裡，每個 extractor 建的時候都會照抄，還是從 pool 拿
+// extractor 在這裡結束：中間的 blob 和 input 都放掉，input buffer 回到 net_in
+// input / extract 失敗印 [ERR] 回傳 false，這張丟掉
+bool stage_extract(const ncnn::Net &net, Job &job) {
+    bool ok = true;
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        if (ex.input("in0", job.in) != 0) {
+            cerr << "[ERR] ex.input failed: in0\n";
+            ok = false;
+        } else if (ex.extract("out0", job.out) != 0) {
+            cerr << "[ERR] ex.extract failed: out0\n";
+            ok = false;
+        }
+    }
+    job.in.release();
+    if (!ok) {
+        job.out.release();
+        return false;
+    }
 
-    if (net.load_param("./yolov8n320.ncnn.param") ||
-        net.load_model("./yolov8n320.ncnn.bin")) {
-        cerr << "Failed to load YOLO model\n";
-        return 1;
+    // YOLO_DUMP_OUT0=out0.bin：存第一個 out0 給 common/bench/bench_yolo_decode 用
+    static const char *dump = getenv("YOLO_DUMP_OUT0");
+    if (dump) {
+        if (yolo_save_tensor(dump, job.out.row(0), job.out.w, job.out.h, job.out.w))
+            printf("[YOLO] out0 (%d x %d) saved to %s\n", job.out.h, job.out.w, dump);
+        dump = NULL;
     }
+    return true;
+}
 
-    // Open camera
-    VideoCapture cam(2);
-    if (!cam.isOpened()) {
-        cerr << "Camera not found\n";
-        return 1;
+// 結果（已 NMS、換回原圖座標）放進 picked
+// out0 每個 class 是連續的一個 row：一次掃一整個 row、SIMD 同時比很多個 proposal 的 max / argmax
+void stage_decode(yolo_decoder &dec, nms_workspace &nms, const Job &job, vector<Object> &picked) {
+    const ncnn::Mat &out = job.out;
+    int n = yolo_decode(dec, out.row(0), out.w, out.h, out.w, CONF_THRESH);
+
+    // NMS 直接在 letterbox 座標上做（IoU 不受縮放 / 平移影響），只有留下來的才換回原圖
+    static thread_local vector<nms_box> boxes;
+    boxes.resize(n);
+    for (int i = 0; i < n; i++) {
+        const yolo_candidate &c = dec.out[i];
+        nms_box b = {c.x0, c.y0, c.x1, c.y1, c.score, c.label};
+        boxes[i] = b;
     }
-    cam.set(CAP_PROP_FRAME_WIDTH, 640);
-    cam.set(CAP_PROP_FRAME_HEIGHT, 480);
-    cam.set(CAP_PROP_BUFFERSIZE, 1);
 
-    // Framebuffer mmap
-    framebuffer_info fb = get_fb_info("/dev/fb0");
-    int fb_w = fb.xres, fb_h = fb.yres;
+    nms_config cfg;
+    cfg.iou_thresh = NMS_THRESH;    // 每個類別各自 NMS：杯子不會把後面的瓶子吃掉
+    int k = nms_run(nms, boxes.data(), n, cfg);
 
-    int fb_fd = open("/dev/fb0", O_RDWR);
-    long screensize = fb_w * fb_h * fb.bits_per_pixel / 8;
-    unsigned short *fbp = (unsigned short *)mmap(
-        0, screensize, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+    picked.clear();
+    for (int i = 0; i < k; i++) {
+        const nms_box &b = boxes[nms.keep[i]];
+        float x0 = b.x0, y0 = b.y0, x1 = b.x1, y1 = b.y1;
+        if (job.roi) {
+            // 哪個 crop 就換回那個 crop 在原圖的位置；落在 padding 上的丟掉
+            if (!roi_map_box(job.plan, x0, y0, x1, y1)) continue;
+        } else {
+            x0 = (x0 - job.pad_x) / job.scale * job.to_frame;
+            y0 = (y0 - job.pad_y) / job.scale * job.to_frame;
+            x1 = (x1 - job.pad_x) / job.scale * job.to_frame;
+            y1 = (y1 - job.pad_y) / job.scale * job.to_frame;
+        }
 
-    if ((long)fbp == -1) {
-        cerr << "Framebuffer mmap failed\n";
-        return 1;
+        Object o;
+        o.rect = Rect(Point(x0, y0), Point(x1, y1));
+        o.label = b.label;
+        o.prob = b.score;
+        picked.push_back(o);
     }
+}
 
-    Mat frame;
-    vector<Object> last_detection;   // 上一個 YOLO 的偵測結果
-    int frame_count = 0;
+//================ Draw ================
+// 畫框 + 類別名稱
+void draw_objects(Mat &frame, const vector<Object> &objs) {
+    for (auto &o : objs) {
+        // 畫框
+        rectangle(frame, o.rect, Scalar(0, 255, 0), 2);
+
+        // 準備文字：類別名稱 + 機率百分比     // NEW
+        int prob_percent = (int)(o.prob * 100 + 0.5f);
+        string label_text = class_name(o.label) + " " + to_string(prob_percent) + "%";
+        if (o.track_id) label_text = "#" + to_string(o.track_id) + " " + label_text;
+
+        int baseLine = 0;
+        Size textSize = getTextSize(label_text, FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+        int x = o.rect.x;
+        int y = o.rect.y - 5;
+        if (y < textSize.height) y = textSize.height + 5;
+
+        // 先畫一個背景方塊讓文字比較清楚   // NEW
+        rectangle(frame,
+                  Point(x, y - textSize.height - 2),
+                  Point(x + textSize.width + 2, y + baseLine),
+                  Scalar(0, 255, 0), FILLED);
+
+        // 再畫白色文字                // NEW
+        putText(frame, label_text, Point(x + 1, y - 2),
+                FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0), 1);
+    }
+}
 
-    while (true) {
-        cam.read(frame);
-        if (frame.empty()) continue;
+//================ Threads ================
+// capture thread（cam_ring）→ main thread 轉 BGR ─┬→ latest_slot → display thread（overlay）
+//                                                 └→ queue → letterbox → queue → extract → queue → decode/NMS
+//                                                                                 → latest_slot（detections）→ display
+// 推論各段之間是有上限的 queue：後面慢就擋住前面，只有入口丟掉最舊的那張，不會擋到相機
+static atomic<bool> g_quit(false);
+static atomic<uint64_t> g_captured(0), g_inferred(0), g_displayed(0);
+
+// BGR frame + 相機拍到它的時間（CLOCK_MONOTONIC），用來量 glass-to-glass latency
+struct Frame {
+    Mat image;
+    int64_t t_capture_us;
+};
 
-        frame_count++;
+// 一次 YOLO 的結果 + 它是哪個時間點拍到的 frame（tracker 要用）
+struct Detections {
+    vector<Object> objects;
+    int64_t t_capture_us;
+};
 
-        // ---- 只有每 SKIP_FRAMES frame 才跑 YOLO ----
-        if (frame_count % SKIP_FRAMES == 0) {
-            float scale; int pad_x, pad_y;
-            ncnn::Mat in = letterbox(frame, INPUT_SIZE, scale, pad_x, pad_y);
+// 每段的處理時間和數量，結束時印出來看是哪一段卡住 FPS
+struct StageStats {
+    const char *name;
+    latency_stats service;
+    uint64_t done;
+    uint64_t allocs, allocs_warm;   // 這段做的 heap allocation（全部 / 暖機之後）
+};
 
-            ncnn::Extractor ex = net.create_extractor();
-            ex.input("in0", in);
+// 每張 frame 在這段 thread 上 malloc 了幾次（alloc_counter 算的，ncnn / OpenCV 裡面的也算）
+// 只有 -DALLOC_COUNT 編的時候會數，不然都是 0
+static void record_allocs(StageStats &st, uint64_t n) {
+    st.allocs += n;
+    if (st.done >= ALLOC_WARMUP_FRAMES) st.allocs_warm += n;
+}
 
-            ncnn::Mat out;
-            ex.extract("out0", out);
+typedef chrono::steady_clock clk;
 
-            int attrs = out.h;
-            int num = out.w;
-            bool has_obj = (attrs == 5 + NUM_CLASSES);
+static double seconds_since(clk::time_point t0) {
+    return chrono::duration<double>(clk::now() - t0).count();
+}
 
-            vector<Object> props;
+// 一個 stage 的 thread：從 in 拿、做 work、交給 out；in 關掉就關 out 然後結束
+// work 回傳 false：這張失敗了，不往下傳
+template <typename Work>
+void run_stage(bounded_queue<Job> &in, bounded_queue<Job> &out, StageStats &st, Work work) {
+    Job job;
+    while (in.pop(job)) {
+        int64_t t0 = cam_now_us();
+        uint64_t a0 = alloc_count_thread();
+        bool ok = work(job);
+        latency_record(st.service, cam_now_us() - t0);
+        record_allocs(st, alloc_count_thread() - a0);
+        st.done++;
+        if (!ok) continue;
+        if (!out.push(std::move(job))) break;
+    }
+    out.close();
+}
 
-            for (int i = 0; i < num; i++) {
-                float cx = out.row(0)[i];
-                float cy = out.row(1)[i];
-                float w  = out.row(2)[i];
-                float h  = out.row(3)[i];
+// 最後一段：decode + NMS，結果交給 display thread
+void decode_loop(bounded_queue<Job> &in, latest_slot<Detections> &dets, StageStats &st,
+                 latency_stats &to_detection) {
+    yolo_decoder dec;
+    yolo_decoder_init(dec, NUM_CLASSES, TARGET_CLASSES, 8);
+    nms_workspace nms;
+
+    Job job;
+    while (in.pop(job)) {
+        int64_t t0 = cam_now_us();
+        uint64_t a0 = alloc_count_thread();
+        stage_decode(dec, nms, job, dets.back().objects);
+        dets.back().t_capture_us = job.t_capture_us;
+        job.out.release();              // 還給 blob pool
+        dets.publish();
+        int64_t t1 = cam_now_us();
+        latency_record(st.service, t1 - t0);
+        latency_record(to_detection, t1 - job.t_capture_us);
+        record_allocs(st, alloc_count_thread() - a0);
+        st.done++;
+        g_inferred++;
+    }
+}
 
-                float obj = has_obj ? out.row(4)[i] : 1.f;
-                if (obj < CONF_THRESH) continue;
+void report_stages(const StageStats *stages, int n, double seconds) {
+    int slowest = 0;
+    for (int i = 0; i < n; i++) {
+        const latency_stats &s = stages[i].service;
+        double mean_ms = s.count ? s.sum_us / 1000.0 / s.count : 0;
+        printf("[STAGE] %-10s %6.1f/s  mean %.2f  p50 %.2f  p95 %.2f ms  (alone: %.1f/s)\n", stages[i].name,
+               stages[i].done / seconds, mean_ms, latency_percentile(s, 0.50) / 1000.0,
+               latency_percentile(s, 0.95) / 1000.0, mean_ms > 0 ? 1000.0 / mean_ms : 0.0);
+        if (s.sum_us * stages[slowest].service.count > stages[slowest].service.sum_us * s.count) slowest = i;
+    }
+    printf("[STAGE] slowest stage (bounds detection FPS): %s\n", stages[slowest].name);
+
+#ifdef ALLOC_COUNT
+    // 目標：暖機之後每張幾乎 0 次（有的話就是 latency 抖動的來源）
+    // extract 每張固定有幾次：每張新建的 ncnn::Extractor 自己的 blob 表，大小固定、很小
+    double warm_total = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t warm = stages[i].done > ALLOC_WARMUP_FRAMES ? stages[i].done - ALLOC_WARMUP_FRAMES : 0;
+        double per_frame = warm ? (double)stages[i].allocs_warm / warm : 0.0;
+        warm_total += per_frame;
+        printf("[ALLOC] %-10s %.2f heap allocations/frame after %llu frames (%llu in total)\n", stages[i].name,
+               per_frame, (unsigned long long)ALLOC_WARMUP_FRAMES, (unsigned long long)stages[i].allocs);
+    }
+    printf("[ALLOC] detection pipeline: %.2f heap allocations/frame in steady state\n", warm_total);
+#endif
+}
 
-                int cls_start = has_obj ? 5 : 4;
-                int best_cls = -1;
-                float best_score = 0.f;
+// YOLO 結果交給 tracker（IoU 配對 + Kalman），框的位置用 YOLO 拍到那一刻的時間更新
+void track_detections(box_tracker &tracker, const Detections &dets) {
+    vector<trk_detection> in(dets.objects.size());
+    for (size_t i = 0; i < in.size(); i++) {
+        const Object &o = dets.objects[i];
+        trk_box b = {(float)o.rect.x, (float)o.rect.y, (float)o.rect.width, (float)o.rect.height};
+        in[i].box = b;
+        in[i].label = o.label;
+        in[i].score = o.prob;
+    }
+    tracker_update(tracker, in.data(), (int)in.size(), dets.t_capture_us);
+}
 
-                for (int c = 0; c < NUM_CLASSES; c++) {
-                    float s = out.row(cls_start + c)[i];
-                    if (s > best_score) {
-                        best_score = s;
-                        best_cls = c;
-                    }
-                }
+// 相機每來一張就畫上目前追蹤到的框送上螢幕，不等 YOLO
+// 框的位置由 tracker 推算到這張 frame 拍到的時間，物體移動時框會跟著走
+// latency：相機拍到 → fb_present() 回來（已經 flip 上螢幕）
+void display_loop(fb_sink &fb, latest_slot<Frame> &frames, latest_slot<Detections> &dets,
+                  latency_stats &latency, infer_scheduler &sched, infer_size_selector &sizer,
+                  latest_slot<vector<trk_box>> &tracked) {
+    fb_letterbox fb_out;              // resize + 轉成螢幕格式直接寫進 framebuffer
+    fb_rect full = {0, 0, (int)fb.width, (int)fb.height};
+    box_tracker tracker;
+    vector<trk_output> tracks;
+    vector<Object> shown;
+
+    while (!g_quit) {
+        if (dets.fetch()) track_detections(tracker, dets.front());
+        if (!frames.fetch()) { usleep(1000); continue; }
+
+        Frame &frame = frames.front();
+        tracker_boxes(tracker, frame.t_capture_us, frame.image.cols, frame.image.rows, tracks);
+        shown.resize(tracks.size());
+        float min_side = 1;             // 最小的物體（短邊 / 畫面長邊），決定 input 要不要放大
+        for (size_t i = 0; i < tracks.size(); i++) {
+            const trk_box &b = tracks[i].box;
+            min_side = min(min_side, min(b.w, b.h) / max(frame.image.cols, frame.image.rows));
+            shown[i].rect = Rect(cvRound(b.x), cvRound(b.y), cvRound(b.w), cvRound(b.h));
+            shown[i].label = tracks[i].label;
+            shown[i].prob = tracks[i].score;
+            shown[i].track_id = tracks[i].id;
+        }
+        infer_size_objects(sizer, (int)tracks.size(), min_side);
+        vector<trk_box> &boxes = tracked.back();      // ROI 模式要在這些框周圍偵測
+        boxes.resize(tracks.size());
+        for (size_t i = 0; i < tracks.size(); i++) boxes[i] = tracks[i].box;
+        tracked.publish();
+        draw_objects(frame.image, shown);
+        fb_letterbox_bgr(fb, fb_out, frame.image.data, frame.image.step, frame.image.cols, frame.image.rows, full);
+        fb_present(fb);
+        latency_record(latency, cam_now_us() - frame.t_capture_us);
+        infer_sched_displayed(sched);
+        g_displayed++;
+    }
+}
 
-                float score = obj * best_score;
-                if (score < CONF_THRESH) continue;
+//================ Main ================
+int main() {
+    // Load YOLO model
+    // YOLO_PRECISION=fp32 / fp16（預設）/ int8；int8 模型用 yolo_int8 calib 產生
+    yolo_precision precision = YOLO_FP16;
+    const char *prec_env = getenv("YOLO_PRECISION");
+    if (prec_env && !yolo_precision_parse(prec_env, precision)) {
+        cerr << "YOLO_PRECISION must be fp32, fp16 or int8\n";
+        return 1;
+    }
+    // ncnn 的 blob / workspace 記憶體從這兩個 pool 拿，暖機之後推論不再 malloc / free
+    // blob pool 要上鎖（out0 在 decode thread 放掉），workspace 只有 extract thread 用
+    // pool 要比 net 晚解構，所以先宣告
+    ncnn_pool blob_pool(true), workspace_pool(false);
+    ncnn::Net net;
+    if (!yolo_model_load(net, MODEL_BASE, precision, 4)) {
+        cerr << "Failed to load YOLO model\n";
+        return 1;
+    }
+    // 模型載入之後才設：權重不會放進 pool，只有推論用的 blob
+    net.opt.blob_allocator = &blob_pool;
+    net.opt.workspace_allocator = &workspace_pool;
+
+    infer_size_config size_cfg;
+    size_cfg.initial = INPUT_SIZE_INITIAL;
+    size_cfg.budget_ms = EXTRACT_BUDGET_MS;
+    const char *size_env = getenv("YOLO_INPUT_SIZE");
+    if (size_env) {
+        int fixed = atoi(size_env);
+        if (fixed < 32 || fixed % 32) {
+            cerr << "YOLO_INPUT_SIZE must be a multiple of 32\n";
+            return 1;
+        }
+        size_cfg.sizes[0] = size_cfg.initial = fixed;
+        size_cfg.n_sizes = 1;
+    }
+    infer_size_selector sizer;
+    infer_size_init(sizer, size_cfg);
+
+    const char *roi_env = getenv("YOLO_ROI");
+    const bool roi_mode = roi_env && atoi(roi_env) != 0;
+    roi_config roi_cfg;
+    roi_cfg.full_interval_s = ROI_FULL_INTERVAL_S;
+    roi_stats roi_st;
+    printf("[YOLO] %s model, input %d", yolo_precision_name(precision), infer_size_current(sizer));
+    if (size_cfg.n_sizes > 1) {
+        printf(" (switching between");
+        for (int i = 0; i < size_cfg.n_sizes; i++) printf(" %d", size_cfg.sizes[i]);
+        printf(")");
+    }
+    printf(roi_mode ? ", ROI passes between full frames\n" : "\n");
+
+    // Open camera（V4L2 mmap buffer 直接拿來用，不經過 VideoCapture）
+    // 用 MJPEG：USB 頻寬夠跑滿 fps；解碼時直接在 DCT 階段縮小，不用先解出整張再 resize
+    // 顯示 / tracker 用的 frame 解到蓋得滿螢幕的大小（螢幕比相機大就是整張，畫面不會變糊）
+    // 送去偵測的那張照這次的 input 大小另外解（320 → 640x480 的 1/2 = 320x240，416 → 整張）
+    // 解碼比例在 main thread 每張自己選，capture 這邊不縮（decode_size 0）
+    cam_config cam_cfg;
+    cam_cfg.path = cam_default_path("/dev/video2");
+    cam_cfg.width = 640;
+    cam_cfg.height = 480;
+    cam_cfg.fourcc = V4L2_PIX_FMT_MJPEG;
+    cam_capture cam;
+    if (!cam_open(cam, cam_cfg)) {
+        cerr << "Camera not found\n";
+        return 1;
+    }
+    // capture thread 開始之後就不能碰 cam，先記下來
+    const bool cam_mjpeg = cam.fourcc == V4L2_PIX_FMT_MJPEG;
+    const int coded_w = cam.coded_width, coded_h = cam.coded_height;
 
-                // 只保留我們指定的 8 個類別     // NEW
-                if (!is_target_class(best_cls)) continue;
+    // Framebuffer mmap
+    fb_sink fb;
+    if (!fb_sink_open(fb, fb_default_path())) {
+        cerr << "Framebuffer mmap failed\n";
+        return 1;
+    }
 
-                float x0 = (cx - w/2 - pad_x) / scale;
-                float y0 = (cy - h/2 - pad_y) / scale;
-                float x1 = (cx + w/2 - pad_x) / scale;
-                float y1 = (cy + h/2 - pad_y) / scale;
+    // 畫在背景 buffer，vsync 時再 flip，避免 tearing（驅動不支援時退回單 buffer）
+    fb_enable_flip(fb, 2);
 
-                Object o;
-                o.rect = Rect(Point(x0, y0), Point(x1, y1));
-                o.label = best_cls;
-                o.prob = score;
+    // 顯示的 frame 整張拉滿螢幕：寬高都至少是螢幕的大小
+    const int display_denom = cam_mjpeg ? mjpeg_pick_denom(coded_w, coded_h, (int)fb.width, (int)fb.height) : 1;
+    if (display_denom > 1)
+        printf("[cam] display frames decoded at 1/%d for a %ux%u screen\n", display_denom, fb.width, fb.height);
 
-                props.push_back(o);
-            }
+    // 相機由獨立的 thread 一直收（driver queue 不會堆積），這裡永遠拿最新的那張
+    cam_ring ring;
+    if (!cam_ring_start(ring, cam)) {
+        cerr << "Camera capture thread failed\n";
+        return 1;
+    }
 
-            nms_custom(props, last_detection, NMS_THRESH);
-        }
+    latest_slot<Frame> to_display;
+    latest_slot<Detections> detections;
+    latest_slot<vector<trk_box>> tracked;           // display thread 追蹤中的框 → ROI 模式
+    latency_stats glass_to_glass, to_detection;
+
+    // 推論 pipeline：每段一個 thread，中間 queue 最多放 2 個
+    infer_sched_config sched_cfg;
+    sched_cfg.display_fps_floor = DISPLAY_FPS_FLOOR;
+    sched_cfg.detect_fps_ceiling = DETECT_FPS_CEILING;
+    infer_scheduler sched;
+    infer_sched_init(sched, sched_cfg);
+
+    bounded_queue<Job> q_letterbox(2), q_extract(2), q_decode(2);
+    StageStats stages[3] = {{"letterbox", latency_stats(), 0, 0, 0},
+                            {"extract", latency_stats(), 0, 0, 0},
+                            {"decode+NMS", latency_stats(), 0, 0, 0}};
+    yolo_input net_in;
+    thread letterbox_thread([&] {
+        run_stage(q_letterbox, q_extract, stages[0], [&](Job &job) {
+            stage_letterbox(net_in, job);
+            return true;
+        });
+    });
+    thread extract_thread([&] {
+        run_stage(q_extract, q_decode, stages[1], [&](Job &job) {
+            int64_t t0 = cam_now_us();
+            if (!stage_extract(net, job)) return false;
+            int64_t us = cam_now_us() - t0;
+            infer_sched_extract_done(sched, us);
+            if (!job.roi) infer_size_extract_done(sizer, job.size, us);
+            roi_record(roi_st, job.roi, us);
+            return true;
+        });
+    });
+    thread decode_thread(decode_loop, ref(q_decode), ref(detections), ref(stages[2]), ref(to_detection));
+    thread display_thread(display_loop, ref(fb), ref(to_display), ref(detections), ref(glass_to_glass),
+                          ref(sched), ref(sizer), ref(tracked));
 
-        // ---- 畫上次 YOLO 偵測出的框 + 類別名稱 ----
-        for (auto &o : last_detection) {
-            // 畫框
-            rectangle(frame, o.rect, Scalar(0, 255, 0), 2);
-
-            // 準備文字：類別名稱 + 機率百分比     // NEW
-            int prob_percent = (int)(o.prob * 100 + 0.5f);
-            string label_text = class_name(o.label) + " " + to_string(prob_percent) + "%";
-
-            int baseLine = 0;
-            Size textSize = getTextSize(label_text, FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-            int x = o.rect.x;
-            int y = o.rect.y - 5;
-            if (y < textSize.height) y = textSize.height + 5;
-
-            // 先畫一個背景方塊讓文字比較清楚   // NEW
-            rectangle(frame,
-                      Point(x, y - textSize.height - 2),
-                      Point(x + textSize.width + 2, y + baseLine),
-                      Scalar(0, 255, 0), FILLED);
-
-            // 再畫白色文字                // NEW
-            putText(frame, label_text, Point(x + 1, y - 2),
-                    FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0), 1);
-        }
+    int64_t last_full_us = 0;
+    bool calib_recording = false;
+    int calib_saved = 0;
 
-        // ---- 顯示到 framebuffer ----
-        Mat resized;
-        resize(frame, resized, Size(fb_w, fb_h));
+    clk::time_point t_start = clk::now(), t_report = t_start;
+    uint64_t last_cap = 0, last_inf = 0, last_disp = 0;
 
-        Mat bgr565;
-        cvtColor(resized, bgr565, COLOR_BGR2BGR565);
+    while (true) {
+        // driver buffer 解碼 / 轉成 BGR 直接寫進 slot；偵測那張也解好了就還給 driver
+        cam_frame grabbed;
+        if (!cam_ring_latest(ring, grabbed)) break;
+        grabbed.decode_denom = display_denom;
+        Frame &frame = to_display.back();
+        cam_bgr(grabbed, frame.image);
+        frame.t_capture_us = grabbed.timestamp_us;
+        if (frame.image.empty()) {
+            cam_ring_release(ring, grabbed);
+            continue;
+        }
 
-        memcpy(fbp, bgr565.data, screensize);
+        g_captured++;
+
+        // ---- scheduler 決定這張要不要交給 YOLO（pipeline 忙不過來時入口丟最舊的）----
+        if (infer_sched_frame(sched, frame.t_capture_us)) {
+            Job job;
+            job.t_capture_us = frame.t_capture_us;
+            // ROI 模式：上次整張之後不到 ROI_FULL_INTERVAL_S、追蹤中的物體不多，就只偵測它們周圍
+            tracked.fetch();
+            const vector<trk_box> &boxes = tracked.front();
+            job.roi = roi_mode && roi_plan_make(roi_cfg, boxes.data(), (int)boxes.size(), frame.image.cols,
+                                                frame.image.rows, frame.t_capture_us, last_full_us, job.plan);
+            if (!job.roi) {
+                job.size = infer_size_pick(sizer, frame.t_capture_us);
+                last_full_us = frame.t_capture_us;
+            }
+            // 這個 input 大小要的 DCT 縮小比例跟顯示的 frame 不一樣：從同一張 JPEG 照它再解一次
+            // （螢幕比相機大的時候顯示的是整張，320 / 224 的 job 就解 1/2）
+            // ROI 的 crop 是在顯示 frame 上規劃的，直接用顯示的
+            int denom = grabbed.decode_denom;
+            if (cam_mjpeg && !job.roi) {
+                const bool wide = coded_w >= coded_h;
+                denom = mjpeg_pick_denom(coded_w, coded_h, wide ? job.size : 0, wide ? 0 : job.size);
+            }
+            if (denom != grabbed.decode_denom) {
+                cam_frame scaled = grabbed;
+                scaled.decode_denom = denom;
+                cam_bgr(scaled, job.image);
+            }
+            if (job.image.empty()) frame.image.copyTo(job.image);
+            job.to_frame = (float)frame.image.cols / job.image.cols;
+            if (calib_recording) {
+                char name[256];
+                snprintf(name, sizeof(name), "%s/%05d.jpg", CALIB_DIR, calib_saved++);
+                imwrite(name, job.image);
+            }
+            q_letterbox.push_latest(std::move(job));
+        }
+        cam_ring_release(ring, grabbed);
+        to_display.publish();
+
+        // ---- 每 2 秒印一次各自的 FPS ----
+        double dt = seconds_since(t_report);
+        if (dt >= 2.0) {
+            uint64_t cap = g_captured, inf = g_inferred, disp = g_displayed;
+            printf("[FPS] capture %.1f  inference %.1f  display %.1f  input %d\n",
+                   (cap - last_cap) / dt, (inf - last_inf) / dt, (disp - last_disp) / dt,
+                   infer_size_current(sizer));
+            last_cap = cap; last_inf = inf; last_disp = disp;
+            t_report = clk::now();
+        }
 
-        if (kbhit() && getchar() == 'q') break;
+        if (kbhit()) {
+            int c = getchar();
+            if (c == 'q') break;
+            if (c == 'c') {
+                // 送去偵測的 frame 才存（跟實際推論看到的一樣），一秒最多 DETECT_FPS_CEILING 張
+                calib_recording = !calib_recording && make_dir(CALIB_DIR);
+                printf("[YOLO] calibration frames: %s (%d in %s)\n", calib_recording ? "recording" : "stopped",
+                       calib_saved, CALIB_DIR);
+            }
+        }
     }
 
-    munmap(fbp, screensize);
-    close(fb_fd);
+    g_quit = true;
+    q_letterbox.close();              // 後面幾段把手上的做完就會一個接一個結束
+    letterbox_thread.join();
+    extract_thread.join();
+    decode_thread.join();
+    display_thread.join();
+    cam_ring_stop(ring);
+
+    double total = seconds_since(t_start);
+    printf("[FPS] average over %.1f s: capture %.1f  inference %.1f  display %.1f\n", total,
+           g_captured / total, g_inferred / total, g_displayed / total);
+    printf("[FPS] frames skipped: camera %llu of %llu, display %llu, inference %llu\n",
+           (unsigned long long)ring.dropped, (unsigned long long)ring.captured,
+           (unsigned long long)to_display.dropped_count(), (unsigned long long)q_letterbox.dropped_count());
+    infer_sched_report(sched);
+    infer_size_report(sizer);
+    if (roi_mode) roi_report(roi_st);
+    report_stages(stages, 3, total);
+    printf("[ALLOC] ncnn pools: blob %zu buffers %.1f MB (%zu from the heap), workspace %zu buffers %.1f MB (%zu); "
+           "input buffers %llu\n",
+           blob_pool.slots.size(), blob_pool.bytes / 1048576.0, blob_pool.allocations, workspace_pool.slots.size(),
+           workspace_pool.bytes / 1048576.0, workspace_pool.allocations, (unsigned long long)net_in.allocations);
+    latency_report(to_detection, "camera -> detections");
+    latency_report(glass_to_glass, "camera -> screen");
+
+    cam_close(cam);
+    fb_sink_close(fb);
 
     return 0;
 }
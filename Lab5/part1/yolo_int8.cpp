@@ -0,0 +1,335 @@
+// INT8 工具：給 part1 的 YOLOv8n 做量化校正，並比較 fp32 / fp16 / int8
+//
+//   g++ -O2 yolo_int8.cpp ../../common/yolo_model.cpp ../../common/yolo_decode.cpp ../../common/nms.cpp
+//       ../../common/latency_stats.cpp -o yolo_int8 `pkg-config --cflags --libs opencv` -lncnn -fopenmp
+//   （同一行）
+//
+//   ./yolo_int8 calib  <frames_dir> [model_base] [input_size]
+//   ./yolo_int8 report <frames_dir> [model_base] [input_size]
+//
+// frames_dir：part1 執行時按 c 存下來的 frame（./calib_frames），或任何 jpg / png / bmp。
+// model_base 預設 ./yolov8n320，input_size 預設 320（要跟 part1 一樣）。
+//
+// calib：每張 frame 用跟 part1 一模一樣的 letterbox 做成 input_size x input_size 的圖，
+//        寫到 <model_base>-calib/，再跑 ncnn 的 ncnn2table（KL 校正）和 ncnn2int8，
+//        產生 <model_base>-int8.ncnn.param/.bin。ncnn2table / ncnn2int8 從 PATH 找，
+//        或放在 $NCNN_TOOLS 目錄。之後 YOLO_PRECISION=int8 ./part1 就會用 int8 模型。
+// report：同一組 frame 分別用 fp32 / fp16 / int8 跑，印出 extract 每張幾 ms，
+//        以及用 fp32 的框（score >= 0.25）當標準答案算的 mAP@0.5（準確度的近似指標）。
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <ncnn/net.h>
+#include "../../common/yolo_model.h"
+#include "../../common/yolo_decode.h"
+#include "../../common/nms.h"
+#include "../../common/latency_stats.h"
+
+using namespace std;
+
+typedef chrono::steady_clock clk;
+
+const int NUM_CLASSES = 80;
+const float CONF_THRESH = 0.1f;     // 跟 part1 一樣
+const float NMS_THRESH = 0.45f;
+const float REF_CONF = 0.25f;       // fp32 的框超過這個分數才當標準答案
+const float MATCH_IOU = 0.5f;
+const int NUM_THREADS = 4;
+
+//================ 檔案 ================
+bool has_image_ext(const string &name) {
+    size_t dot = name.rfind('.');
+    if (dot == string::npos) return false;
+    string ext = name.substr(dot + 1);
+    for (size_t i = 0; i < ext.size(); i++) ext[i] = (char)tolower((unsigned char)ext[i]);
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp";
+}
+
+// 目錄裡的圖片，依檔名排序
+bool list_images(const string &dir, vector<string> &files) {
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        cerr << "[ERR] cannot open " << dir << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    while (dirent *e = readdir(d))
+        if (e->d_name[0] != '.' && has_image_ext(e->d_name)) files.push_back(dir + "/" + e->d_name);
+    closedir(d);
+    sort(files.begin(), files.end());
+    if (files.empty()) {
+        cerr << "[ERR] no images in " << dir << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool make_dir(const char *path) {
+    if (mkdir(path, 0777) == 0 || errno == EEXIST) return true;
+    cerr << "[ERR] mkdir " << path << ": " << strerror(errno) << "\n";
+    return false;
+}
+
+bool file_exists(const string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+string ncnn_tool(const char *name) {
+    const char *dir = getenv("NCNN_TOOLS");
+    return dir ? string(dir) + "/" + name : string(name);
+}
+
+bool run(const string &cmd) {
+    cout << "$ " << cmd << endl;
+    int rc = system(cmd.c_str());
+    if (rc != 0) {
+        cerr << "[ERR] command failed (" << rc << ")\n";
+        return false;
+    }
+    return true;
+}
+
+//================ calib ================
+int calibrate(const vector<string> &files, const string &base, int input_size) {
+    const string work = base + "-calib";
+    if (!make_dir(work.c_str())) return 1;
+
+    // 跟 part1 一樣的 letterbox，ncnn2table 拿到的就是推論時真正的輸入（它自己只會直接拉伸）
+    string list_file = work + "/imagelist.txt";
+    FILE *list = fopen(list_file.c_str(), "w");
+    if (!list) {
+        cerr << "[ERR] cannot write " << list_file << "\n";
+        return 1;
+    }
+    int n = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        cv::Mat img = cv::imread(files[i]);
+        if (img.empty()) {
+            cerr << "[WARN] skip unreadable " << files[i] << "\n";
+            continue;
+        }
+        float scale;
+        int pad_x, pad_y;
+        cv::Mat boxed = yolo_letterbox_bgr(img, input_size, scale, pad_x, pad_y);
+        char name[512];
+        snprintf(name, sizeof(name), "%s/%05d.png", work.c_str(), n++);
+        if (!cv::imwrite(name, boxed)) {
+            cerr << "[ERR] imwrite failed: " << name << "\n";
+            fclose(list);
+            return 1;
+        }
+        fprintf(list, "%s\n", name);
+    }
+    fclose(list);
+    cout << "[OK] " << n << " calibration images in " << work << endl;
+
+    string param, bin, param8, bin8;
+    yolo_model_paths(base, YOLO_FP32, param, bin);
+    yolo_model_paths(base, YOLO_INT8, param8, bin8);
+    const string table = base + ".table";
+    char shape[64];
+    snprintf(shape, sizeof(shape), "shape=[%d,%d,3]", input_size, input_size);
+
+    // 輸入是 BGR、0..1（mean 0、norm 1/255），跟 yolo_letterbox 一樣（縮放的四捨五入可能差 1/255）
+    if (!run(ncnn_tool("ncnn2table") + " " + param + " " + bin + " " + list_file + " " + table +
+             " mean=[0,0,0] norm=[0.003921569,0.003921569,0.003921569] " + shape + " pixel=BGR thread=" +
+             to_string(NUM_THREADS) + " method=kl"))
+        return 1;
+    if (!run(ncnn_tool("ncnn2int8") + " " + param + " " + bin + " " + param8 + " " + bin8 + " " + table))
+        return 1;
+
+    cout << "[OK] int8 model: " << param8 << " / " << bin8 << "\n"
+         << "     run part1 with YOLO_PRECISION=int8, compare with ./yolo_int8 report <frames_dir>" << endl;
+    return 0;
+}
+
+//================ report ================
+struct Box {
+    nms_box b;
+    int frame;
+};
+
+struct RunResult {
+    yolo_precision precision;
+    latency_stats extract;
+    vector<Box> boxes;          // 所有 frame 的結果（NMS 後，letterbox 座標）
+};
+
+bool run_model(yolo_precision p, const string &base, const vector<cv::Mat> &frames, int input_size,
+               RunResult &res) {
+    ncnn::Net net;
+    if (!yolo_model_load(net, base, p, NUM_THREADS)) return false;
+    res.precision = p;
+
+    yolo_decoder dec;
+    yolo_decoder_init(dec, NUM_CLASSES, NULL, 0);
+    nms_workspace ws;
+    nms_config cfg;
+    cfg.iou_thresh = NMS_THRESH;
+    vector<nms_box> cand;
+    yolo_input net_in;
+
+    for (size_t f = 0; f < frames.size(); f++) {
+        float scale;
+        int pad_x, pad_y;
+        ncnn::Mat in = yolo_letterbox(net_in, frames[f], input_size, scale, pad_x, pad_y);
+
+        ncnn::Mat out;
+        // 第一張多跑一次當暖機（記憶體配置、cache），不算時間
+        for (int pass = f == 0 ? 0 : 1; pass < 2; pass++) {
+            clk::time_point t0 = clk::now();
+            ncnn::Extractor ex = net.create_extractor();
+            ex.input("in0", in);
+            ex.extract("out0", out);
+            if (pass == 1)
+                latency_record(res.extract, chrono::duration_cast<chrono::microseconds>(clk::now() - t0).count());
+        }
+
+        int n = yolo_decode(dec, out.row(0), out.w, out.h, out.w, CONF_THRESH);
+        cand.resize(n);
+        for (int i = 0; i < n; i++) {
+            const yolo_candidate &c = dec.out[i];
+            nms_box b = {c.x0, c.y0, c.x1, c.y1, c.score, c.label};
+            cand[i] = b;
+        }
+        int k = nms_run(ws, cand.data(), n, cfg);
+        for (int i = 0; i < k; i++) {
+            Box box = {cand[ws.keep[i]], (int)f};
+            res.boxes.push_back(box);
+        }
+    }
+    return true;
+}
+
+// VOC 的 all-point AP：score 由高到低，一個框配一個還沒被配走、同 frame 同類別、IoU >= 0.5 的標準答案
+double average_precision(const vector<Box> &gt, vector<Box> dets, int cls) {
+    vector<const Box *> truth;
+    for (size_t i = 0; i < gt.size(); i++)
+        if (gt[i].b.label == cls) truth.push_back(&gt[i]);
+    if (truth.empty()) return -1;
+
+    dets.erase(remove_if(dets.begin(), dets.end(), [cls](const Box &d) { return d.b.label != cls; }), dets.end());
+    sort(dets.begin(), dets.end(), [](const Box &a, const Box &b) { return a.b.score > b.b.score; });
+
+    vector<char> used(truth.size(), 0);
+    vector<double> prec, rec;
+    int tp = 0;
+    for (size_t i = 0; i < dets.size(); i++) {
+        int best = -1;
+        float best_iou = MATCH_IOU;
+        for (size_t t = 0; t < truth.size(); t++) {
+            if (used[t] || truth[t]->frame != dets[i].frame) continue;
+            float iou = nms_iou(truth[t]->b, dets[i].b);
+            if (iou >= best_iou) {
+                best_iou = iou;
+                best = (int)t;
+            }
+        }
+        if (best >= 0) {
+            used[best] = 1;
+            tp++;
+        }
+        prec.push_back((double)tp / (i + 1));
+        rec.push_back((double)tp / truth.size());
+    }
+
+    // precision 由後往前取最大值，再對 recall 積分
+    double ap = 0, prev_rec = 0;
+    for (int i = (int)prec.size() - 2; i >= 0; i--) prec[i] = max(prec[i], prec[i + 1]);
+    for (size_t i = 0; i < prec.size(); i++) {
+        ap += (rec[i] - prev_rec) * prec[i];
+        prev_rec = rec[i];
+    }
+    return ap;
+}
+
+double mean_ap(const vector<Box> &gt, const vector<Box> &dets, int &classes) {
+    double sum = 0;
+    classes = 0;
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        double ap = average_precision(gt, dets, c);
+        if (ap < 0) continue;
+        sum += ap;
+        classes++;
+    }
+    return classes ? sum / classes : 0;
+}
+
+int report(const vector<string> &files, const string &base, int input_size) {
+    vector<cv::Mat> frames;
+    for (size_t i = 0; i < files.size(); i++) {
+        cv::Mat img = cv::imread(files[i]);
+        if (img.empty())
+            cerr << "[WARN] skip unreadable " << files[i] << "\n";
+        else
+            frames.push_back(img);
+    }
+    if (frames.empty()) return 1;
+
+    vector<RunResult> results;
+    const yolo_precision all[3] = {YOLO_FP32, YOLO_FP16, YOLO_INT8};
+    for (int i = 0; i < 3; i++) {
+        string param, bin;
+        yolo_model_paths(base, all[i], param, bin);
+        if (all[i] == YOLO_INT8 && !file_exists(param)) {
+            cerr << "[WARN] no " << param << ", run ./yolo_int8 calib first; int8 skipped\n";
+            continue;
+        }
+        results.push_back(RunResult());
+        cout << "[..] " << yolo_precision_name(all[i]) << ": " << frames.size() << " frames" << endl;
+        if (!run_model(all[i], base, frames, input_size, results.back())) {
+            if (all[i] == YOLO_FP32) return 1;      // 沒有 fp32 就沒有標準答案
+            results.pop_back();
+        }
+    }
+
+    // fp32 夠有把握的框當標準答案
+    vector<Box> gt;
+    for (size_t i = 0; i < results[0].boxes.size(); i++)
+        if (results[0].boxes[i].b.score >= REF_CONF) gt.push_back(results[0].boxes[i]);
+
+    printf("\n[INT8] %zu frames, input %d, %d threads; reference: %zu fp32 boxes with score >= %.2f\n",
+           frames.size(), input_size, NUM_THREADS, gt.size(), REF_CONF);
+    printf("  %-6s %9s %9s %9s %9s %12s %8s\n", "model", "mean ms", "p50 ms", "p95 ms", "speedup", "mAP50 proxy",
+           "boxes");
+    const double ref_ms = results[0].extract.sum_us / 1000.0 / results[0].extract.count;
+    for (size_t i = 0; i < results.size(); i++) {
+        const RunResult &r = results[i];
+        const double ms = r.extract.sum_us / 1000.0 / r.extract.count;
+        int classes;
+        const double map = mean_ap(gt, r.boxes, classes);
+        printf("  %-6s %9.2f %9.2f %9.2f %8.2fx %12.3f %8zu\n", yolo_precision_name(r.precision), ms,
+               latency_percentile(r.extract, 0.5) / 1000.0, latency_percentile(r.extract, 0.95) / 1000.0,
+               ref_ms / ms, map, r.boxes.size());
+    }
+    printf("  (ms = ncnn extract only; mAP50 proxy = AP@IoU 0.5 against the fp32 boxes, averaged over the classes"
+           " present; fp32 itself scores 1)\n");
+    return 0;
+}
+
+//================ Main ================
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "calib") != 0 && strcmp(argv[1], "report") != 0)) {
+        cerr << "usage: " << argv[0] << " calib|report <frames_dir> [model_base] [input_size]\n";
+        return 1;
+    }
+    const string base = argc > 3 ? argv[3] : "./yolov8n320";
+    const int input_size = argc > 4 ? atoi(argv[4]) : 320;
+
+    vector<string> files;
+    if (!list_images(argv[2], files)) return 1;
+
+    if (strcmp(argv[1], "calib") == 0) return calibrate(files, base, input_size);
+    return report(files, base, input_size);
+}
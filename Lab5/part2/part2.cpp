@@ -1,24 +1,37 @@
 #include <fcntl.h>
 #include <iostream>
-#include <linux/fb.h>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgcodecs.hpp>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
 #include <unistd.h>
 #include <vector>
 #include <algorithm>
 #include <cmath>
-#include <numeric>
 #include <string>
 #include <cstdio>
 #include <cctype>
 #include <cerrno>
 #include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include <ncnn/net.h>
 #include <ncnn/mat.h>
+#include <ncnn/cpu.h>
+
+#include "../../common/fb_letterbox.h"
+#include "../../common/fb_sink.h"
+#include "../../common/bounded_queue.h"
+#include "../../common/nms.h"
+#include "../../common/out_writer.h"
+#include "../../common/tile_detect.h"
+#include "../../common/yolo_model.h"
 
 using namespace cv;
 using namespace std;
@@ -85,164 +98,109 @@ static inline std::string get_custom_name(int label)
     return "Cls" + std::to_string(label);
 }
 
-// ================== IoU / NMS ==================
-static float intersection_area(const Object& a, const Object& b)
-{
-    Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
-}
-
+// ================== NMS ==================
+// common/nms：每個類別各自 NMS、grid 分桶只比附近的框
+// 兩個模型同時跑，workspace 每個 thread 一份
 static void nms_custom(const vector<Object>& objects, vector<Object>& picked, float nms_thresh)
 {
-    picked.clear();
-    if (objects.empty()) return;
-
-    vector<int> idx(objects.size());
-    iota(idx.begin(), idx.end(), 0);
-
-    sort(idx.begin(), idx.end(), [&](int a, int b){
-        return objects[a].prob > objects[b].prob;
-    });
-
-    for (int i : idx)
+    static thread_local nms_workspace ws;
+    vector<nms_box> boxes(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
     {
-        const Object& a = objects[i];
-        bool keep = true;
-        for (const auto& b : picked)
-        {
-            float inter = intersection_area(a, b);
-            float uni   = a.rect.area() + b.rect.area() - inter;
-            if (uni <= 0.f) continue;
-
-            float iou = inter / uni;
-            if (iou > nms_thresh)
-            {
-                keep = false;
-                break;
-            }
-        }
-        if (keep) picked.push_back(a);
+        const Rect& r = objects[i].rect;
+        nms_box b = {(float)r.x, (float)r.y, (float)(r.x + r.width), (float)(r.y + r.height),
+                     objects[i].prob, objects[i].label};
+        boxes[i] = b;
     }
-}
 
-// ================== Framebuffer ==================
-struct framebuffer_info {
-    uint32_t bits_per_pixel;
-    uint32_t xres_virtual;
-    uint32_t yres_virtual;
-};
+    nms_config cfg;
+    cfg.iou_thresh = nms_thresh;
+    int k = nms_run(ws, boxes.data(), (int)boxes.size(), cfg);
 
-static framebuffer_info get_framebuffer_info(const char *path)
-{
-    framebuffer_info fb{};
-    fb_var_screeninfo info{};
-    int fd = open(path, O_RDWR);
-    if (fd >= 0)
-    {
-        if (ioctl(fd, FBIOGET_VSCREENINFO, &info) == 0)
-        {
-            fb.xres_virtual   = info.xres_virtual;
-            fb.yres_virtual   = info.yres_virtual;
-            fb.bits_per_pixel = info.bits_per_pixel;
-        }
-        close(fd);
-    }
-    return fb;
+    picked.clear();
+    for (int i = 0; i < k; i++)
+        picked.push_back(objects[ws.keep[i]]);
 }
 
-// ================== Letterbox 前處理 ==================
-static ncnn::Mat letterbox(const Mat& img, int target_size, float& scale, int& pad_x, int& pad_y)
+// ================== 安全寫 JPG（避免偶發壞檔） ==================
+// 交給 out_writer：JPEG 在它的 thread 編碼，寫 .tmp → fdatasync → rename，資料夾的 fsync 多張一起做
+// （原本每張都 ::sync()，整個系統的髒頁都要寫回，批次的時候一次卡好幾秒）
+// img 只是多一個 reference，呼叫的人之後不能再改這張圖
+static bool submit_jpg(out_writer& w, const std::string& out_file, const cv::Mat& img, int quality = 95)
 {
-    int w = img.cols;
-    int h = img.rows;
-
-    float r = std::min((float)target_size / w, (float)target_size / h);
-    int new_w = (int)std::round(w * r);
-    int new_h = (int)std::round(h * r);
-
-    scale = r;
-    pad_x = (target_size - new_w) / 2;
-    pad_y = (target_size - new_h) / 2;
+    return out_writer_submit(w, out_file, [img, quality](std::vector<unsigned char>& out) {
+        std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, quality };
+        try {
+            return cv::imencode(".jpg", img, out, params);
+        } catch (const cv::Exception& e) {
+            std::cerr << "[ERR] imencode exception: " << e.what() << "\n";
+            return false;
+        }
+    });
+}
 
-    Mat resized;
-    resize(img, resized, Size(new_w, new_h));
+// ================== 偵測 API：回傳 boxes + 時間，不畫 ==================
+// 一個模型和它的設定；net / input 由呼叫的人擁有（模型載入一次，一直用）
+struct Detector {
+    const char* name;
+    ncnn::Net* net;
+    yolo_input* input;          // 重複使用的 input buffer（一個 Detector 一次只給一個 thread 用）
+    int input_size;
+    int num_classes;
+    float conf_thresh;
+    float nms_thresh;
+    const char* in_blob;
+    const char* out_blob;
+};
 
-    Mat canvas(target_size, target_size, CV_8UC3, Scalar(0, 0, 0));
-    resized.copyTo(canvas(Rect(pad_x, pad_y, new_w, new_h)));
+struct DetectTiming {
+    double letterbox_ms, extract_ms, decode_ms, total_ms;
+};
 
-    // 統一用 BGR2RGB
-    ncnn::Mat in = ncnn::Mat::from_pixels(
-        canvas.data, ncnn::Mat::PIXEL_BGR2RGB,
-        target_size, target_size
-    );
+// objects 重複使用（批次跑很多張時不用每張重新配置）
+struct DetectResult {
+    vector<Object> objects;     // 原圖座標，已 NMS
+    DetectTiming timing;
+};
 
-    const float norm_vals[3] = {1.f/255.f, 1.f/255.f, 1.f/255.f};
-    in.substract_mean_normalize(nullptr, norm_vals);
+typedef std::chrono::steady_clock clk;
 
-    return in;
+static double ms_since(clk::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(clk::now() - t0).count();
 }
 
-// ================== 安全寫 JPG（避免偶發壞檔） ==================
-static bool safe_imwrite_jpg(const std::string& out_file, const cv::Mat& img, int quality = 95)
+// 一塊區域（整張圖或一個 tile）：letterbox 到 input_size → extract → decode
+// 結果（還沒 NMS，換回原圖座標：region 在原圖的 off_x / off_y）加在 proposals 後面，時間加進 timing
+// num_threads > 0：這個 extractor 用幾個 thread（tile 平行跑的時候一個 tile 一個）
+static bool detect_region(const Detector& d, yolo_input& input, int input_size, const cv::Mat& region, int off_x,
+                          int off_y, int num_threads, vector<Object>& proposals, DetectTiming& timing)
 {
-    std::string tmp = out_file + ".tmp";
-    std::vector<int> params = { cv::IMWRITE_JPEG_QUALITY, quality };
-
-    bool ok = false;
-    try {
-        ok = cv::imwrite(tmp, img, params);
-    } catch (const cv::Exception& e) {
-        std::cerr << "[ERR] imwrite exception: " << e.what() << "\n";
-        ok = false;
-    }
-
-    if (!ok) {
-        std::cerr << "[ERR] imwrite failed: " << tmp << "\n";
-        return false;
-    }
+    const int num_classes = d.num_classes;
+    const float conf_thresh = d.conf_thresh;
 
-    if (::rename(tmp.c_str(), out_file.c_str()) != 0) {
-        std::cerr << "[ERR] rename failed: " << std::strerror(errno) << "\n";
-        return false;
-    }
-
-    ::sync(); // 板子上比較保險
-    return true;
-}
-
-// ================== 推論 + 畫框（通用） ==================
-template <typename NameFunc>
-static int infer_and_draw(
-    ncnn::Net& net,
-    cv::Mat& img_inplace,
-    int input_size,
-    int num_classes,
-    float conf_thresh,
-    float nms_thresh,
-    const char* in_blob,
-    const char* out_blob,
-    NameFunc get_name,
-    const cv::Scalar& box_color,
-    const std::string& prefix
-) {
+    clk::time_point t0 = clk::now();
     float scale = 1.f;
     int pad_x = 0, pad_y = 0;
-    ncnn::Mat in = letterbox(img_inplace, input_size, scale, pad_x, pad_y);
+    ncnn::Mat in = yolo_letterbox(input, region, input_size, scale, pad_x, pad_y);
+    clk::time_point t1 = clk::now();
 
-    ncnn::Extractor ex = net.create_extractor();
-    if (ex.input(in_blob, in) != 0) {
-        std::cerr << "[ERR] ex.input failed: " << in_blob << "\n";
-        return -1;
+    ncnn::Extractor ex = d.net->create_extractor();
+    if (num_threads > 0) ex.set_num_threads(num_threads);
+    if (ex.input(d.in_blob, in) != 0) {
+        std::cerr << "[ERR] " << d.name << " ex.input failed: " << d.in_blob << "\n";
+        return false;
     }
 
     ncnn::Mat out;
-    if (ex.extract(out_blob, out) != 0) {
-        std::cerr << "[ERR] ex.extract failed: " << out_blob << "\n";
-        return -1;
+    if (ex.extract(d.out_blob, out) != 0) {
+        std::cerr << "[ERR] " << d.name << " ex.extract failed: " << d.out_blob << "\n";
+        return false;
     }
+    clk::time_point t2 = clk::now();
 
-    int img_w = img_inplace.cols;
-    int img_h = img_inplace.rows;
+    int img_w = region.cols;
+    int img_h = region.rows;
 
     int attrs = out.h;
     int num_proposals = out.w;
@@ -257,12 +215,9 @@ static int infer_and_draw(
         std::cerr << "[ERR] unexpected out.h=" << attrs
                   << " expected " << (4 + num_classes) << " or " << (5 + num_classes)
                   << " (classes=" << num_classes << ")\n";
-        return -1;
+        return false;
     }
 
-    vector<Object> proposals;
-    proposals.reserve(256);
-
     for (int i = 0; i < num_proposals; i++)
     {
         float cx = out.row(0)[i];
@@ -311,42 +266,500 @@ static int infer_and_draw(
         y1 = std::max(0.f, std::min((float)img_h - 1.f, y1));
 
         Object obj;
-        obj.rect  = Rect(Point((int)x0, (int)y0), Point((int)x1, (int)y1));
+        obj.rect  = Rect(Point((int)x0 + off_x, (int)y0 + off_y), Point((int)x1 + off_x, (int)y1 + off_y));
         obj.label = best_cls;
         obj.prob  = score;
         proposals.push_back(obj);
     }
 
-    vector<Object> objects;
-    nms_custom(proposals, objects, nms_thresh);
+    timing.letterbox_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    timing.extract_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    timing.decode_ms += ms_since(t2);
+    return true;
+}
+
+// 輸入圖不會被改：幾個模型可以同時讀同一張
+// 失敗（input / extract / output shape 不對）印 [ERR] 回傳 false
+static bool detect(const Detector& d, const cv::Mat& img, DetectResult& res)
+{
+    clk::time_point t0 = clk::now();
+    DetectTiming timing = {0, 0, 0, 0};
+    static thread_local vector<Object> proposals;
+    proposals.clear();
+    if (!detect_region(d, *d.input, d.input_size, img, 0, 0, 0, proposals, timing)) return false;
+
+    clk::time_point t1 = clk::now();
+    nms_custom(proposals, res.objects, d.nms_thresh);
+    timing.decode_ms += ms_since(t1);
+    timing.total_ms = ms_since(t0);
+    res.timing = timing;
+    return true;
+}
+
+// ================== Tiled 推論（小物體）：原尺寸切成重疊的 tile，各自偵測再合併 ==================
+// 不用把整張縮到一個很大的 input：每個 tile 就是模型的 input 大小，1:1 不縮小
+struct TiledSetup {
+    tile_config cfg;
+    int threads = 1;                    // 幾個 tile 同時跑（各一個 ncnn thread）
+    int global_size = 0;                // > 0：另外加一次整張縮到這個大小（切到的大物體靠它）
+    vector<yolo_input> inputs;          // 一個 tile thread 一個
+    vector<tile_rect> tiles;
+    vector<vector<Object>> found;       // 每個 tile thread 找到的
+    vector<DetectTiming> timing;
+    nms_workspace ws;
+    vector<nms_box> boxes;
+    vector<int> keep;
+};
+
+static bool detect_tiled(const Detector& d, TiledSetup& ts, const cv::Mat& img, DetectResult& res)
+{
+    clk::time_point t0 = clk::now();
+    const int n = tile_grid(ts.cfg, img.cols, img.rows, ts.tiles);
+    const int threads = std::max(1, std::min(ts.threads, n));
+    ts.inputs.resize(threads);
+    ts.found.resize(threads);
+    ts.timing.assign(threads, DetectTiming{0, 0, 0, 0});
+    for (yolo_input& in : ts.inputs) in.lb.rgb = d.input->lb.rgb;
+
+    // tile k 給 thread k % threads；每個 tile 的框先去掉被 tile 邊切到、鄰居那邊完整的
+    std::atomic<bool> ok(true);
+    auto work = [&](int k) {
+        vector<Object>& found = ts.found[k];
+        found.clear();
+        for (int i = k; i < n && ok; i += threads) {
+            const tile_rect& t = ts.tiles[i];
+            size_t first = found.size();
+            if (!detect_region(d, ts.inputs[k], ts.cfg.tile, img(Rect(t.x, t.y, t.w, t.h)), t.x, t.y, 1, found,
+                               ts.timing[k])) {
+                ok = false;
+                return;
+            }
+            size_t kept = first;
+            for (size_t j = first; j < found.size(); j++) {
+                const Rect& r = found[j].rect;
+                nms_box b = {(float)r.x, (float)r.y, (float)(r.x + r.width), (float)(r.y + r.height), 0, 0};
+                if (tile_box_keep(ts.cfg, t, img.cols, img.rows, b)) found[kept++] = found[j];
+            }
+            found.resize(kept);
+        }
+    };
+    vector<std::thread> pool;
+    for (int k = 1; k < threads; k++) pool.emplace_back(work, k);
+    work(0);
+    for (std::thread& th : pool) th.join();
+
+    DetectTiming timing = {0, 0, 0, 0};
+    for (const DetectTiming& t : ts.timing) {
+        timing.letterbox_ms += t.letterbox_ms;
+        timing.extract_ms += t.extract_ms;
+        timing.decode_ms += t.decode_ms;
+    }
+    static thread_local vector<Object> all;
+    all.clear();
+    for (const vector<Object>& f : ts.found) all.insert(all.end(), f.begin(), f.end());
+    if (ok && ts.global_size > 0) ok = detect_region(d, *d.input, ts.global_size, img, 0, 0, 0, all, timing);
+    if (!ok) return false;
+
+    // 跨 tile 合併：NMS + 被切成一半的框（IoS）
+    clk::time_point t1 = clk::now();
+    ts.boxes.resize(all.size());
+    for (size_t i = 0; i < all.size(); i++) {
+        const Rect& r = all[i].rect;
+        nms_box b = {(float)r.x, (float)r.y, (float)(r.x + r.width), (float)(r.y + r.height), all[i].prob,
+                     all[i].label};
+        ts.boxes[i] = b;
+    }
+    ts.cfg.iou_thresh = d.nms_thresh;
+    int k = tile_merge(ts.ws, ts.cfg, ts.boxes.data(), (int)ts.boxes.size(), ts.keep);
+    res.objects.clear();
+    for (int i = 0; i < k; i++) res.objects.push_back(all[ts.keep[i]]);
+
+    timing.decode_ms += ms_since(t1);
+    timing.total_ms = ms_since(t0);     // letterbox / extract / decode 是各 thread 加起來（CPU），total 是 wall
+    res.timing = timing;
+    return true;
+}
+
+// ================== 畫框：幾個模型的結果一次畫上去 ==================
+// 一層 = 一個模型的結果 + 它的類別名稱 / 顏色 / 前綴
+struct OverlayLayer {
+    const vector<Object>* objects;
+    std::string (*get_name)(int label);
+    cv::Scalar color;
+    const char* prefix;         // 例如 "[FT] "，不要就 ""
+};
+
+// 先畫所有框再寫所有文字：後面模型的框不會蓋掉前面模型的字
+static void draw_overlay(cv::Mat& img, const OverlayLayer* layers, int n)
+{
+    for (int l = 0; l < n; l++)
+        for (const auto& o : *layers[l].objects)
+            rectangle(img, o.rect, layers[l].color, 2);
+
+    for (int l = 0; l < n; l++) {
+        for (const auto& o : *layers[l].objects) {
+            std::string name = layers[l].get_name(o.label);
+            char text[160];
+            std::snprintf(text, sizeof(text), "%s%s %.2f", layers[l].prefix, name.c_str(), o.prob);
+
+            Point org = o.rect.tl();
+            org.y = std::max(0, org.y - 5);
+            putText(img, text, org, FONT_HERSHEY_SIMPLEX, 0.7, layers[l].color, 2);
+        }
+    }
+}
+
+// ================== 兩個模型同時跑：各自一組 CPU core ==================
+// "0-2" / "3" / "0,2-3" → CpuSet；空字串或格式不對回傳 false
+static bool parse_cpus(const char* text, ncnn::CpuSet& cpus)
+{
+    cpus.disable_all();
+    int n = 0;
+    const char* p = text;
+    while (*p) {
+        char* end;
+        long a = std::strtol(p, &end, 10);
+        if (end == p || a < 0) return false;
+        long b = a;
+        if (*end == '-') {
+            p = end + 1;
+            b = std::strtol(p, &end, 10);
+            if (end == p || b < a) return false;
+        }
+        for (long c = a; c <= b; c++, n++) cpus.enable((int)c);
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return n > 0;
+}
+
+struct ModelRun {
+    Detector det;
+    ncnn::CpuSet cpus;          // 這個模型的 ncnn worker thread 只跑在這些 core
+    std::string cpus_text;
+    DetectResult res;
+    bool ok;
+    TiledSetup* tiled;          // 不是 nullptr：切 tile 跑（finetune 的 FT_TILES=1）
+    bool also_single;           // tiled 時再跑一次原本的整張 input_size 比較（結果在 single，不畫）
+    DetectResult single;
+};
+
+// 一個模型一個常駐 thread：ncnn 的 OpenMP worker 綁好 core 之後一直用，不用每張圖重建
+struct ModelWorker {
+    ModelRun* run;
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    const Mat* img;             // 這次要跑的圖
+    uint64_t started, finished;
+    bool quit;
+};
+
+static void worker_loop(ModelWorker* w)
+{
+    ncnn::set_cpu_thread_affinity(w->run->cpus);
+    std::unique_lock<std::mutex> hold(w->lock);
+    while (true) {
+        w->wake.wait(hold, [w] { return w->quit || w->started != w->finished; });
+        if (w->started == w->finished) return;     // quit，手上沒有工作
+        const Mat* img = w->img;
+        hold.unlock();
+
+        // tile thread 從這個 thread 開出來，繼承它綁的 core
+        ModelRun& run = *w->run;
+        run.det.net->opt.num_threads = run.cpus.num_enabled();
+        if (run.tiled) {
+            run.tiled->threads = run.cpus.num_enabled();
+            run.ok = detect_tiled(run.det, *run.tiled, *img, run.res);
+            if (run.ok && run.also_single) run.ok = detect(run.det, *img, run.single);
+        } else {
+            run.ok = detect(run.det, *img, run.res);
+        }
+
+        hold.lock();
+        w->finished++;
+        w->wake.notify_all();
+    }
+}
+
+static void worker_start(ModelWorker& w, ModelRun& run)
+{
+    w.run = &run;
+    w.img = nullptr;
+    w.started = w.finished = 0;
+    w.quit = false;
+    w.thread = std::thread(worker_loop, &w);
+}
 
-    // draw
-    for (const auto& o : objects)
+static void worker_stop(ModelWorker& w)
+{
     {
-        rectangle(img_inplace, o.rect, box_color, 2);
+        std::lock_guard<std::mutex> hold(w.lock);
+        w.quit = true;
+    }
+    w.wake.notify_all();
+    w.thread.join();
+}
+
+// 所有模型同時跑同一張圖，全部做完才回來；回傳 wall-clock ms
+static double run_concurrent(ModelWorker* workers, int n, const Mat& img)
+{
+    clk::time_point t0 = clk::now();
+    for (int i = 0; i < n; i++) {
+        std::lock_guard<std::mutex> hold(workers[i].lock);
+        workers[i].img = &img;
+        workers[i].started++;
+        workers[i].wake.notify_all();
+    }
+    for (int i = 0; i < n; i++) {
+        std::unique_lock<std::mutex> hold(workers[i].lock);
+        workers[i].wake.wait(hold, [&] { return workers[i].finished == workers[i].started; });
+    }
+    return ms_since(t0);
+}
 
-        std::string name = get_name(o.label);
-        char text[160];
-        std::snprintf(text, sizeof(text), "%s%s %.2f", prefix.c_str(), name.c_str(), o.prob);
+// ================== 小物體 recall：有標註（YOLO 格式 <檔名>.txt 在圖旁邊）就算 ==================
+// 小物體 = 面積 < 32x32（COCO 的 small）；同 class、IoU >= 0.5 算找到
+struct SmallRecall {
+    uint64_t gt, tiled, single;
+};
 
-        Point org = o.rect.tl();
-        org.y = std::max(0, org.y - 5);
-        putText(img_inplace, text, org, FONT_HERSHEY_SIMPLEX, 0.7, box_color, 2);
+// 一行 "class cx cy w h"（0~1）；沒有這個檔回傳 false
+static bool load_yolo_labels(const std::string& img_path, int img_w, int img_h, vector<Object>& gt)
+{
+    size_t dot = img_path.rfind('.');
+    size_t slash = img_path.rfind('/');
+    std::string path = (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+                           ? img_path : img_path.substr(0, dot);
+    FILE* f = std::fopen((path + ".txt").c_str(), "r");
+    if (!f) return false;
+    gt.clear();
+    int cls;
+    float cx, cy, w, h;
+    while (std::fscanf(f, "%d %f %f %f %f", &cls, &cx, &cy, &w, &h) == 5) {
+        Object o;
+        o.rect = Rect((int)((cx - w / 2) * img_w), (int)((cy - h / 2) * img_h), (int)(w * img_w), (int)(h * img_h));
+        o.label = cls;
+        o.prob = 1.f;
+        gt.push_back(o);
+    }
+    std::fclose(f);
+    return true;
+}
+
+// gt 裡的小物體有幾個被 found 找到
+static uint64_t small_hits(const vector<Object>& gt, const vector<Object>& found, uint64_t* small_count)
+{
+    uint64_t hits = 0, small = 0;
+    for (const Object& g : gt) {
+        if (g.rect.area() >= 32 * 32) continue;
+        small++;
+        for (const Object& o : found) {
+            if (o.label != g.label) continue;
+            float inter = (float)(g.rect & o.rect).area();
+            if (inter / (g.rect.area() + o.rect.area() - inter) >= 0.5f) {
+                hits++;
+                break;
+            }
+        }
     }
+    if (small_count) *small_count = small;
+    return hits;
+}
+
+// 有標註就把這張的結果加進 recall
+static void add_small_recall(SmallRecall& r, const std::string& img_path, const Mat& img, const ModelRun& run)
+{
+    static vector<Object> gt;
+    if (!load_yolo_labels(img_path, img.cols, img.rows, gt)) return;
+    uint64_t small = 0;
+    r.tiled += small_hits(gt, run.res.objects, &small);
+    r.gt += small;
+    if (run.also_single) r.single += small_hits(gt, run.single.objects, nullptr);
+}
 
-    return (int)objects.size();
+static void print_small_recall(const SmallRecall& r, const ModelRun& run)
+{
+    if (!r.gt) return;
+    std::printf("[TILE] small objects (< 32x32): %llu labelled, tiled found %llu (%.0f%%)", (unsigned long long)r.gt,
+                (unsigned long long)r.tiled, 100.0 * r.tiled / r.gt);
+    if (run.also_single)
+        std::printf(", single pass %d found %llu (%.0f%%)", run.det.input_size, (unsigned long long)r.single,
+                    100.0 * r.single / r.gt);
+    std::printf("\n");
+}
+
+// ================== 批次：一個資料夾（或檔案清單）裡的每一張 ==================
+// 模型只載入一次；讀圖解碼在 prefetch thread，寫檔在 writer thread，主 thread 只管推論 + 畫框
+struct BatchImage {
+    std::string in_path, out_path;
+    Mat img;
+};
+
+static bool is_image_name(const std::string& name)
+{
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return false;
+    std::string ext = name.substr(dot + 1);
+    for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+    return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp";
 }
 
-// ================== 主程式：讀一次圖，先 COCO 再 finetune ==================
-int main()
+// 資料夾：裡面的圖檔（照檔名排序）；其他檔案：一行一個路徑的清單
+static bool list_inputs(const std::string& input, vector<std::string>& files)
 {
-    // ======= COCO model (先跑) =======
+    struct stat st;
+    if (::stat(input.c_str(), &st) != 0) {
+        std::cerr << "[ERR] " << input << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = ::opendir(input.c_str());
+        if (!dir) {
+            std::cerr << "[ERR] opendir " << input << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        while (struct dirent* e = ::readdir(dir)) {
+            if (is_image_name(e->d_name)) files.push_back(input + "/" + e->d_name);
+        }
+        ::closedir(dir);
+        std::sort(files.begin(), files.end());
+    } else {
+        FILE* f = std::fopen(input.c_str(), "r");
+        if (!f) {
+            std::cerr << "[ERR] open " << input << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        char line[4096];
+        while (std::fgets(line, sizeof(line), f)) {
+            std::string path(line);
+            while (!path.empty() && std::isspace((unsigned char)path.back())) path.pop_back();
+            if (!path.empty() && path[0] != '#') files.push_back(path);
+        }
+        std::fclose(f);
+    }
+    if (files.empty()) {
+        std::cerr << "[ERR] no images in " << input << "\n";
+        return false;
+    }
+    return true;
+}
+
+// out_dir/<檔名去掉副檔名>.jpg
+static std::string output_path(const std::string& out_dir, const std::string& in_path)
+{
+    size_t slash = in_path.rfind('/');
+    std::string name = slash == std::string::npos ? in_path : in_path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) name.resize(dot);
+    return out_dir + "/" + name + ".jpg";
+}
+
+static int run_batch(ModelWorker* workers, int n, const OverlayLayer* layers, const std::string& input,
+                     const std::string& out_dir)
+{
+    vector<std::string> files;
+    if (!list_inputs(input, files)) return -1;
+    if (::mkdir(out_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        std::cerr << "[ERR] mkdir " << out_dir << ": " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    std::cout << "[BATCH] " << files.size() << " images -> " << out_dir << "\n";
+
+    // prefetch：最多先解好 4 張等推論；writer：最多 4 張等編碼 + 寫
+    bounded_queue<BatchImage> decoded(4);
+    out_writer_config write_cfg;
+    write_cfg.queue = 4;
+    out_writer writer(write_cfg);
+    out_writer_start(writer);
+    double decode_ms = 0;
+    uint64_t unreadable = 0;
+
+    std::thread prefetch([&] {
+        for (const std::string& path : files) {
+            clk::time_point t0 = clk::now();
+            BatchImage item;
+            item.in_path = path;
+            item.out_path = output_path(out_dir, path);
+            item.img = imread(path);
+            decode_ms += ms_since(t0);
+            if (item.img.empty()) {
+                std::cerr << "[WARN] imread failed: " << path << "\n";
+                unreadable++;
+                continue;
+            }
+            if (!decoded.push(std::move(item))) break;
+        }
+        decoded.close();
+    });
+
+    clk::time_point t_start = clk::now();
+    double detect_ms = 0;
+    vector<double> model_ms(n, 0.0), single_ms(n, 0.0);
+    SmallRecall recall = {0, 0, 0};
+    uint64_t done = 0, failed = 0;
+    BatchImage item;
+    while (decoded.pop(item)) {
+        detect_ms += run_concurrent(workers, n, item.img);
+        bool ok = true;
+        for (int i = 0; i < n; i++) {
+            ok = ok && workers[i].run->ok;
+            model_ms[i] += workers[i].run->res.timing.total_ms;
+        }
+        if (!ok) {
+            std::cerr << "[WARN] detection failed: " << item.in_path << "\n";
+            failed++;
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            const ModelRun& run = *workers[i].run;
+            if (!run.tiled) continue;
+            add_small_recall(recall, item.in_path, item.img, run);
+            if (run.also_single) single_ms[i] += run.single.timing.total_ms;
+        }
+        draw_overlay(item.img, layers, n);
+        done++;
+        if (!submit_jpg(writer, item.out_path, item.img)) break;
+        item = BatchImage();
+    }
+    prefetch.join();
+    out_writer_stop(writer);
+    const uint64_t write_failed = writer.stats.failed;
+
+    const double total_s = ms_since(t_start) / 1000.0;
+    std::printf("[BATCH] %llu images in %.1f s: %.2f images/s (%llu unreadable, %llu detection failed, %llu not written)\n",
+                (unsigned long long)done, total_s, done / total_s, (unsigned long long)unreadable,
+                (unsigned long long)failed, (unsigned long long)write_failed);
+    if (done) {
+        std::printf("[BATCH] per image: decode %.1f ms (prefetch thread), detect %.1f ms wall\n",
+                    decode_ms / files.size(), detect_ms / done);
+        out_writer_report(writer, "WRITE");
+        for (int i = 0; i < n; i++) {
+            const ModelRun& run = *workers[i].run;
+            std::printf("[BATCH]   %s %.1f ms/image on cpus %s%s\n", run.det.name, model_ms[i] / done,
+                        run.cpus_text.c_str(), run.tiled ? " (tiled)" : "");
+            if (run.tiled && run.also_single)
+                std::printf("[BATCH]   %s single pass %d: %.1f ms/image\n", run.det.name, run.det.input_size,
+                            single_ms[i] / done);
+            if (run.tiled) print_small_recall(recall, run);
+        }
+    }
+    return failed || write_failed ? 1 : 0;
+}
+
+// ================== 主程式：讀一次圖，COCO 和 finetune 同時跑，兩個都好了再一起畫 ==================
+//   ./part2                          ./sample.jpg → ./result.jpg + framebuffer
+//   ./part2 <資料夾|清單.txt> [out]   批次：每張都跑，結果寫到 out/（預設 ./results）
+int main(int argc, char** argv)
+{
+    // ======= COCO model =======
     string coco_param = "./yolov8x.ncnn.param";
     string coco_bin   = "./yolov8x.ncnn.bin";
     const int COCO_INPUT = 640;
     const int COCO_CLASSES = 80;
 
-    // ======= finetune model (後跑) =======
+    // ======= finetune model =======
     string ft_param = "./yolov8s.ncnn.param";
     string ft_bin   = "./yolov8s.ncnn.bin";
     const int FT_INPUT = 960;
@@ -354,7 +767,7 @@ int main()
 
     // ======= IO =======
     string image_file = "./sample.jpg";     // 讀進來的圖（只讀一次）
-    string out_file   = "./result.jpg"; // 同一張輸出：先 COCO 再 finetune
+    string out_file   = "./result.jpg"; // 同一張輸出：COCO（綠）+ finetune（紅）
 
     const float CONF_THRESH = 0.25f;
     const float NMS_THRESH  = 0.45f;
@@ -362,6 +775,11 @@ int main()
     const char* IN_BLOB  = "in0";
     const char* OUT_BLOB = "out0";
 
+    // letterbox 直接寫進重複使用的 ncnn::Mat；兩個模型都吃 RGB（跟原本 PIXEL_BGR2RGB 一樣）
+    yolo_input coco_in, ft_in;
+    coco_in.lb.rgb = true;
+    ft_in.lb.rgb = true;
+
     // 1) load models
     ncnn::Net net_coco;
     net_coco.opt.num_threads = 4;
@@ -391,80 +809,158 @@ int main()
 
     std::cout << "[OK] models loaded\n";
 
-    // 2) read image once
+    // 2) core split：COCO_CPUS / FT_CPUS（例如 "0-2" / "3"）
+    //    預設照計算量分：yolov8x@640 大約是 yolov8s@960 的 4 倍，finetune 拿 1/4 的 core（至少 1 個）
+    const int ncpu = std::max(1, ncnn::get_cpu_count());
+    const int ft_ncpu = std::max(1, ncpu / 4);
+    char coco_default[32], ft_default[32];
+    if (ncpu > 1) {
+        std::snprintf(coco_default, sizeof(coco_default), "0-%d", ncpu - ft_ncpu - 1);
+        std::snprintf(ft_default, sizeof(ft_default), "%d-%d", ncpu - ft_ncpu, ncpu - 1);
+    } else {
+        std::snprintf(coco_default, sizeof(coco_default), "0");
+        std::snprintf(ft_default, sizeof(ft_default), "0");
+    }
+    const char* coco_cpus = getenv("COCO_CPUS") ? getenv("COCO_CPUS") : coco_default;
+    const char* ft_cpus = getenv("FT_CPUS") ? getenv("FT_CPUS") : ft_default;
+
+    ModelRun coco = {{"COCO", &net_coco, &coco_in, COCO_INPUT, COCO_CLASSES, CONF_THRESH, NMS_THRESH,
+                      IN_BLOB, OUT_BLOB}, ncnn::CpuSet(), coco_cpus, DetectResult(), false, nullptr, false,
+                     DetectResult()};
+    ModelRun ft = {{"finetune", &net_ft, &ft_in, FT_INPUT, FT_CLASSES, CONF_THRESH, NMS_THRESH,
+                    IN_BLOB, OUT_BLOB}, ncnn::CpuSet(), ft_cpus, DetectResult(), false, nullptr, false,
+                   DetectResult()};
+    if (!parse_cpus(coco_cpus, coco.cpus) || !parse_cpus(ft_cpus, ft.cpus)) {
+        std::cerr << "[ERR] COCO_CPUS / FT_CPUS must look like 0-2 or 0,3: " << coco_cpus << " / " << ft_cpus << "\n";
+        return -1;
+    }
+
+    // FT_TILES=1：finetune（飛鏢、鉛筆這種小東西）改成切 tile，不再整張縮到 960
+    //   FT_TILE=640 tile 大小（= 模型 input）、FT_TILE_OVERLAP=0.2
+    //   FT_TILE_GLOBAL=640 另外加一次整張縮到 640（0 = 不加）、FT_TILE_COMPARE=1 順便跑原本的 960 比時間和 recall
+    TiledSetup ft_tiled;
+    const char* tiles_env = getenv("FT_TILES");
+    if (tiles_env && std::atoi(tiles_env) != 0) {
+        const char* tile_env = getenv("FT_TILE");
+        const char* overlap_env = getenv("FT_TILE_OVERLAP");
+        const char* global_env = getenv("FT_TILE_GLOBAL");
+        const char* tile_compare_env = getenv("FT_TILE_COMPARE");
+        if (tile_env) ft_tiled.cfg.tile = std::atoi(tile_env);
+        if (overlap_env) ft_tiled.cfg.overlap = (float)std::atof(overlap_env);
+        ft_tiled.global_size = global_env ? std::atoi(global_env) : 0;
+        if (ft_tiled.cfg.tile < 32 || ft_tiled.cfg.tile % 32 || ft_tiled.global_size < 0 || ft_tiled.global_size % 32) {
+            std::cerr << "[ERR] FT_TILE / FT_TILE_GLOBAL must be multiples of 32\n";
+            return -1;
+        }
+        if (ft_tiled.cfg.overlap < 0 || ft_tiled.cfg.overlap >= 1) {
+            std::cerr << "[ERR] FT_TILE_OVERLAP must be in [0, 1)\n";
+            return -1;
+        }
+        ft.tiled = &ft_tiled;
+        ft.also_single = tile_compare_env && std::atoi(tile_compare_env) != 0;
+        std::printf("[TILE] finetune: %dx%d tiles, overlap %.2f", ft_tiled.cfg.tile, ft_tiled.cfg.tile,
+                    ft_tiled.cfg.overlap);
+        if (ft_tiled.global_size) std::printf(", global pass %d", ft_tiled.global_size);
+        std::printf(ft.also_single ? ", single pass %d for comparison\n" : "\n", FT_INPUT);
+    }
+
+    // 結果一起畫：COCO 綠、finetune 紅（前綴可以改成 "[COCO] " / "[FT] "）
+    OverlayLayer layers[2] = {{&coco.res.objects, get_coco_name, Scalar(0, 255, 0), ""},
+                              {&ft.res.objects, get_custom_name, Scalar(0, 0, 255), ""}};
+
+    ModelWorker workers[2];
+    worker_start(workers[0], coco);
+    worker_start(workers[1], ft);
+
+    // 批次模式：模型已經載好，每張圖都跑
+    if (argc > 1) {
+        int rc = run_batch(workers, 2, layers, argv[1], argc > 2 ? argv[2] : "./results");
+        worker_stop(workers[0]);
+        worker_stop(workers[1]);
+        return rc;
+    }
+
+    // 3) read image once
     Mat img = imread(image_file);
     if (img.empty()) {
         std::cerr << "[ERR] imread failed: " << image_file << "\n";
+        worker_stop(workers[0]);
+        worker_stop(workers[1]);
         return -1;
     }
     std::cout << "[OK] image: " << img.cols << " x " << img.rows << "\n";
 
-    // 3) run COCO first (green)
-    int coco_cnt = infer_and_draw(
-        net_coco, img,
-        COCO_INPUT, COCO_CLASSES,
-        CONF_THRESH, NMS_THRESH,
-        IN_BLOB, OUT_BLOB,
-        [](int label){ return get_coco_name(label); },
-        Scalar(0, 255, 0),
-        ""   // 你也可以改成 "[COCO] " 做前綴
-    );
-    if (coco_cnt < 0) return -1;
-    std::cout << "[OK] COCO done, boxes=" << coco_cnt << "\n";
-
-    // 4) run finetune second (red)
-    int ft_cnt = infer_and_draw(
-        net_ft, img,
-        FT_INPUT, FT_CLASSES,
-        CONF_THRESH, NMS_THRESH,
-        IN_BLOB, OUT_BLOB,
-        [](int label){ return get_custom_name(label); },
-        Scalar(0, 0, 255),
-        ""   // 你也可以改成 "[FT] " 做前綴
-    );
-    if (ft_cnt < 0) return -1;
-    std::cout << "[OK] finetune done, boxes=" << ft_cnt << "\n";
-
-    // 5) save output (safe)
-	imwrite(out_file, img);
-    std::cout << "[OK] saved: " << out_file << "\n";
-
-    // 6) framebuffer display
-    framebuffer_info fb = get_framebuffer_info("/dev/fb0");
-    int fb_w = fb.xres_virtual;
-    int fb_h = fb.yres_virtual;
-
-    int fb_fd = open("/dev/fb0", O_RDWR);
-    if (fb_fd < 0) {
-        std::cerr << "[WARN] open /dev/fb0 failed\n";
-        return 0;
+    // PART2_COMPARE=1：先照原本的方式一個接一個跑（每個都用全部 core）量 baseline
+    // （前面先不計時跑一次，兩種跑法都是熱的）
+    const char* compare_env = getenv("PART2_COMPARE");
+    const bool compare = compare_env && std::atoi(compare_env) != 0;
+    double seq_ms = 0;
+    if (compare) {
+        run_concurrent(workers, 2, img);
+        clk::time_point t0 = clk::now();
+        for (ModelRun* r : {&coco, &ft}) {
+            r->det.net->opt.num_threads = ncpu;
+            r->ok = detect(r->det, img, r->res);
+        }
+        seq_ms = ms_since(t0);
+        std::cout << "[TIME] sequential (" << ncpu << " threads each): COCO " << coco.res.timing.total_ms
+                  << " ms + finetune " << ft.res.timing.total_ms << " ms = " << seq_ms << " ms\n";
     }
 
-    long int screensize = fb_w * fb_h * fb.bits_per_pixel / 8;
-    char* fbp = (char*)mmap(0, screensize, PROT_READ | PROT_WRITE,
-                            MAP_SHARED, fb_fd, 0);
-    if ((long)fbp == -1) {
-        std::cerr << "[WARN] framebuffer mmap failed\n";
-        close(fb_fd);
-        return 0;
+    // 4) 兩個模型同時跑同一張（沒畫過框的）圖
+    double wall_ms = run_concurrent(workers, 2, img);
+    worker_stop(workers[0]);
+    worker_stop(workers[1]);
+    if (!coco.ok || !ft.ok) return -1;
+    for (ModelRun* r : {&coco, &ft}) {
+        const DetectTiming& t = r->res.timing;
+        std::cout << "[OK] " << r->det.name << " done, boxes=" << r->res.objects.size() << "\n";
+        std::printf("[TIME] %s on cpus %s: letterbox %.1f  extract %.1f  decode+NMS %.1f  total %.1f ms\n",
+                    r->det.name, r->cpus_text.c_str(), t.letterbox_ms, t.extract_ms, t.decode_ms, t.total_ms);
+    }
+    std::cout << "[TIME] concurrent wall " << wall_ms << " ms\n";
+    if (compare)
+        std::cout << "[TIME] concurrent vs sequential: " << wall_ms << " / " << seq_ms << " ms ("
+                  << seq_ms / wall_ms << "x)\n";
+    if (ft.tiled) {
+        std::printf("[TILE] finetune: %d tiles on %d threads, %zu boxes in %.1f ms", (int)ft_tiled.tiles.size(),
+                    std::min(ft_tiled.threads, (int)ft_tiled.tiles.size()), ft.res.objects.size(),
+                    ft.res.timing.total_ms);
+        if (ft.also_single)
+            std::printf("; single pass %d: %zu boxes in %.1f ms", FT_INPUT, ft.single.objects.size(),
+                        ft.single.timing.total_ms);
+        std::printf("\n");
+        SmallRecall recall = {0, 0, 0};
+        add_small_recall(recall, image_file, img, ft);
+        print_small_recall(recall, ft);
     }
 
-    Mat disp;
-    resize(img, disp, Size(fb_w, fb_h));
-
-    if (fb.bits_per_pixel == 16) {
-        Mat bgr565;
-        cvtColor(disp, bgr565, COLOR_BGR2BGR565);
-        memcpy(fbp, bgr565.data, screensize);
+    // 5) 兩個都好了才一起畫
+    draw_overlay(img, layers, 2);
+
+    // 6) save output (safe)：在 writer thread 編碼寫檔，同時這邊去顯示
+    out_writer writer;
+    out_writer_start(writer);
+    submit_jpg(writer, out_file, img);
+
+    // 7) framebuffer display
+    fb_sink fb;
+    if (fb_sink_open(fb, fb_default_path())) {
+        // stretched to the whole screen, packed straight into its pixel format
+        fb_letterbox out;
+        fb_rect screen = {0, 0, (int)fb.width, (int)fb.height};
+        if (!fb_letterbox_bgr(fb, out, img.data, img.step, img.cols, img.rows, screen))
+            std::cerr << "[WARN] framebuffer pixel format not supported\n";
+
+        fb_sink_close(fb);
+        std::cout << "[OK] framebuffer displayed\n";
     } else {
-        Mat bgra;
-        cvtColor(disp, bgra, COLOR_BGR2BGRA);
-        memcpy(fbp, bgra.data, screensize);
+        std::cerr << "[WARN] framebuffer open/mmap failed\n";
     }
 
-    munmap(fbp, screensize);
-    close(fb_fd);
-
-    std::cout << "[OK] framebuffer displayed\n";
+    // 8) 等檔案寫好（含資料夾 fsync）
+    out_writer_stop(writer);
+    if (writer.stats.failed) return -1;
+    std::cout << "[OK] saved: " << out_file << "\n";
     return 0;
 }
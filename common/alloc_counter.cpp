@@ -0,0 +1,82 @@
+#include "alloc_counter.h"
+
+#ifdef ALLOC_COUNT
+
+#include <errno.h>
+#include <stddef.h>
+#include <atomic>
+
+// glibc's own allocator entry points (what malloc() is without us)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// Constant-initialised, so counting works for allocations made before
+// main() and in threads started by the libraries.
+static std::atomic<uint64_t> g_allocs(0);
+static thread_local uint64_t t_allocs = 0;
+
+static inline void count_alloc()
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    t_allocs++;
+}
+
+extern "C" {
+
+void *malloc(size_t size)
+{
+    count_alloc();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    count_alloc();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count_alloc();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_alloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    count_alloc();
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void *p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+}
+
+uint64_t alloc_count_total()
+{
+    return g_allocs.load(std::memory_order_relaxed);
+}
+
+uint64_t alloc_count_thread()
+{
+    return t_allocs;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <stdint.h>
+
+// ================== Heap allocation counter ==================
+// Compiling alloc_counter.cpp into a program replaces malloc, calloc,
+// realloc, memalign, aligned_alloc and posix_memalign for the whole
+// process (forwarding to glibc's __libc_* versions) and counts every call.
+// That includes what operator new, ncnn (fastMalloc) and OpenCV allocate
+// inside the libraries, so a delta of alloc_count_thread() around a piece
+// of work is the number of heap allocations it really made.
+//
+// Counting is a measurement build only: every allocation in every thread
+// (ncnn's OpenMP workers, OpenCV, libjpeg) then does an atomic add on one
+// shared counter. Build with -DALLOC_COUNT (for the program and
+// alloc_counter.cpp alike) to turn it on; otherwise malloc & co. are left
+// alone and both counts are always 0.
+//
+// glibc only. Do not combine with -fsanitize=address / thread, which
+// replace malloc themselves.
+
+#ifdef ALLOC_COUNT
+
+// allocations made by all threads since the start
+uint64_t alloc_count_total();
+
+// allocations made by the calling thread since it started
+uint64_t alloc_count_thread();
+
+#else
+
+inline uint64_t alloc_count_total() { return 0; }
+inline uint64_t alloc_count_thread() { return 0; }
+
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+// Display path benchmark without a real framebuffer: a memfd stands in for
+// /dev/fb0 and one 16 bpp frame is pushed N times, first the old way
+// (ofstream seekp + write per row) and then through fb_blit().
+//
+//   g++ -O2 -std=c++11 bench_fb_sink.cpp ../fb_sink.cpp ../fb_format.cpp -o bench_fb_sink
+//   ./bench_fb_sink [width height frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "../fb_sink.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    int w = argc > 1 ? atoi(argv[1]) : 1920;
+    int h = argc > 2 ? atoi(argv[2]) : 1080;
+    int frames = argc > 3 ? atoi(argv[3]) : 200;
+    const int bpp = 2;
+
+    int fd = memfd_create("fb-bench", 0);
+    if (fd < 0) {
+        perror("memfd_create");
+        return 1;
+    }
+
+    fb_sink fb;
+    if (!fb_sink_open_fd(fb, fd, w, h, 16))
+        return 1;
+
+    std::vector<unsigned char> frame((size_t)w * h * bpp);
+    for (size_t i = 0; i < frame.size(); i++) frame[i] = (unsigned char)(i * 7);
+
+    // ---- old path: one seekp + write per row ----
+    char fd_path[64];
+    snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", fb.fd);
+    std::ofstream ofs(fd_path, std::ios::out | std::ios::binary);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++) {
+        for (int y = 0; y < h; y++) {
+            ofs.seekp((std::streamoff)y * fb.line_length, std::ios::beg);
+            ofs.write((const char *)&frame[(size_t)y * w * bpp], (std::streamsize)w * bpp);
+        }
+        ofs.flush();
+    }
+    double ofs_ms = ms_since(t0);
+
+    // ---- new path: mmap + memcpy ----
+    t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++)
+        fb_blit(fb, frame.data(), (size_t)w * bpp, 0, 0, w, h);
+    double mmap_ms = ms_since(t0);
+
+    printf("%dx%d 16bpp, %d frames\n", w, h, frames);
+    printf("  ofstream seekp/write : %8.3f ms/frame (%d syscall pairs/frame)\n", ofs_ms / frames, h);
+    printf("  fb_blit (mmap)       : %8.3f ms/frame\n", mmap_ms / frames);
+
+    fb_sink_close(fb);
+    return 0;
+}
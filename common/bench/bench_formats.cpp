@@ -0,0 +1,102 @@
+// Per-format output benchmark: the same BGR888 frame is converted 1:1 and
+// scaled (4:3 letterbox) into a memfd framebuffer of each supported pixel
+// format.
+//
+//   g++ -O2 -std=c++11 bench_formats.cpp ../fb_letterbox.cpp ../yuv_convert.cpp ../fb_sink.cpp ../fb_format.cpp -o bench_formats
+//   ./bench_formats [src_w src_h fb_w fb_h frames]
+//
+// As with bench_letterbox, add -mavx2 / -mfpu=neon or -DFB_NO_SIMD to
+// compare code paths; the checksums must match between builds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "../fb_letterbox.h"
+#include "../fb_sink.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static unsigned long checksum(fb_sink &fb)
+{
+    unsigned long sum = 0;
+    for (uint32_t y = 0; y < fb.height; y++) {
+        const uint8_t *row = fb_row(fb, (int)y);
+        for (uint32_t x = 0; x < fb.width * fb.bytes_per_pixel; x++) sum = sum * 31 + row[x];
+    }
+    return sum;
+}
+
+// A stand-in only synthesises RGB565 / RGB888 / XRGB8888; the other two
+// differ in the bitfields alone, so they are patched in after opening.
+static bool open_format(fb_sink &fb, fb_format fmt, int w, int h)
+{
+    static const uint32_t bpp[FB_FMT_COUNT] = {0, 16, 16, 24, 32, 32};
+    if (!fb_sink_open_fd(fb, memfd_create("fb-bench", 0), w, h, bpp[fmt]))
+        return false;
+    if (fmt == FB_FMT_BGR565) {
+        fb.var.red.offset = 0;
+        fb.var.blue.offset = 11;
+    } else if (fmt == FB_FMT_ARGB8888) {
+        fb.var.transp.offset = 24;
+        fb.var.transp.length = 8;
+    }
+    fb.format = fb_detect_format(fb.var);
+    return fb.format == fmt;
+}
+
+static double run(fb_sink &fb, const std::vector<uint8_t> &src, int src_w, int src_h,
+                  fb_rect view, int frames)
+{
+    fb_letterbox lb;
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++) {
+        // changed = whole picture every frame, like a live camera
+        fb_letterbox_bgr(fb, lb, src.data(), (size_t)src_w * 3, src_w, src_h, view, &view);
+        fb_present(fb);
+    }
+    return ms_since(t0) / frames;
+}
+
+int main(int argc, char **argv)
+{
+    int src_w = argc > 1 ? atoi(argv[1]) : 640;
+    int src_h = argc > 2 ? atoi(argv[2]) : 480;
+    int fb_w = argc > 3 ? atoi(argv[3]) : 1920;
+    int fb_h = argc > 4 ? atoi(argv[4]) : 1080;
+    int frames = argc > 5 ? atoi(argv[5]) : 100;
+
+    std::vector<uint8_t> src((size_t)src_w * src_h * 3);
+    for (int y = 0; y < src_h; y++)
+        for (int x = 0; x < src_w * 3; x++)
+            src[(size_t)y * src_w * 3 + x] = (uint8_t)((x * 5 + y * 3 + (x % 3) * 70) & 0xff);
+
+    fb_rect copy = {0, 0, src_w, src_h};
+    fb_rect view;
+    view.h = fb_h;
+    view.w = fb_h * 4 / 3;
+    view.x = (fb_w - view.w) / 2;
+    view.y = 0;
+
+    printf("%dx%d BGR888 source, %dx%d screen, %d frames\n", src_w, src_h, fb_w, fb_h, frames);
+    printf("  %-9s %14s %18s   %s\n", "format", "1:1 ms/frame", "letterbox ms/frame", "checksum");
+    for (int f = FB_FMT_UNKNOWN + 1; f < FB_FMT_COUNT; f++) {
+        fb_sink fb;
+        if (!open_format(fb, (fb_format)f, fb_w, fb_h)) {
+            printf("  %-9s could not set up\n", fb_format_name((fb_format)f));
+            continue;
+        }
+        double copy_ms = run(fb, src, src_w, src_h, copy, frames);
+        double lb_ms = run(fb, src, src_w, src_h, view, frames);
+        printf("  %-9s %14.3f %18.3f   %016lx\n", fb_format_name(fb.format), copy_ms, lb_ms, checksum(fb));
+        fb_sink_close(fb);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Letterbox output benchmark on a memfd framebuffer: a synthetic BGR888
+// camera frame is scaled into a 4:3 view on a 16 bpp screen (see
+// bench_formats for the other pixel formats).
+//
+//   g++ -O2 -std=c++11 bench_letterbox.cpp ../fb_letterbox.cpp ../yuv_convert.cpp ../fb_sink.cpp ../fb_format.cpp -o bench_letterbox
+//   ./bench_letterbox [src_w src_h fb_w fb_h frames]
+//
+// Add -mavx2 (x86) or -mfpu=neon (32-bit ARM) to pick the SIMD path, or
+// -DFB_NO_SIMD to time the scalar one. With -DWITH_OPENCV (and
+// the OpenCV flags) the old resize / canvas / cvtColor / blit path is timed
+// as well. The printed checksum lets SIMD and scalar builds be compared.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "../fb_letterbox.h"
+#include "../fb_sink.h"
+#ifdef WITH_OPENCV
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static unsigned long checksum(fb_sink &fb)
+{
+    unsigned long sum = 0;
+    for (uint32_t y = 0; y < fb.height; y++) {
+        const uint8_t *row = fb_row(fb, (int)y);
+        for (uint32_t x = 0; x < fb.width * fb.bytes_per_pixel; x++) sum = sum * 31 + row[x];
+    }
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    int src_w = argc > 1 ? atoi(argv[1]) : 640;
+    int src_h = argc > 2 ? atoi(argv[2]) : 480;
+    int fb_w = argc > 3 ? atoi(argv[3]) : 1920;
+    int fb_h = argc > 4 ? atoi(argv[4]) : 1080;
+    int frames = argc > 5 ? atoi(argv[5]) : 100;
+
+    fb_sink fb;
+    if (!fb_sink_open_fd(fb, memfd_create("fb-bench", 0), fb_w, fb_h, 16))
+        return 1;
+
+    std::vector<uint8_t> src((size_t)src_w * src_h * 3);
+    for (int y = 0; y < src_h; y++)
+        for (int x = 0; x < src_w * 3; x++)
+            src[(size_t)y * src_w * 3 + x] = (uint8_t)((x * 5 + y * 3 + (x % 3) * 70) & 0xff);
+
+    // 4:3 view centered on the screen, as in Lab2/part2
+    fb_rect view;
+    view.h = fb_h;
+    view.w = fb_h * 4 / 3;
+    view.x = (fb_w - view.w) / 2;
+    view.y = 0;
+
+    fb_letterbox lb;
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++) {
+        fb_letterbox_bgr(fb, lb, src.data(), (size_t)src_w * 3, src_w, src_h, view);
+        fb_present(fb);
+    }
+    double fused_ms = ms_since(t0);
+
+    printf("%dx%d -> %dx%d view on %dx%d %s, %d frames\n",
+           src_w, src_h, view.w, view.h, fb_w, fb_h, fb_format_name(fb.format), frames);
+    printf("  fused letterbox      : %8.3f ms/frame, %7.1f KiB written/frame steady state (checksum %016lx)\n",
+           fused_ms / frames, fb.bytes_last / 1024.0, checksum(fb));
+
+    // only a 200x100 overlay box inside the picture changes
+    fb_rect box = {view.x + view.w / 4, view.y + view.h / 4, 200, 100};
+    t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++) {
+        fb_letterbox_bgr(fb, lb, src.data(), (size_t)src_w * 3, src_w, src_h, view, &box);
+        fb_present(fb);
+    }
+    double box_ms = ms_since(t0);
+    printf("  overlay-only update  : %8.3f ms/frame, %7.1f KiB written/frame\n",
+           box_ms / frames, fb.bytes_last / 1024.0);
+
+#ifdef WITH_OPENCV
+    cv::Mat frame(src_h, src_w, CV_8UC3, src.data());
+    t0 = bench_clock::now();
+    for (int f = 0; f < frames; f++) {
+        cv::Mat resized;
+        cv::resize(frame, resized, cv::Size(view.w, view.h));
+        cv::Mat display(fb_h, fb_w, CV_8UC3, cv::Scalar(0, 0, 0));
+        resized.copyTo(display(cv::Rect(view.x, view.y, view.w, view.h)));
+        cv::Mat bgr565;
+        cv::cvtColor(display, bgr565, cv::COLOR_BGR2BGR565);
+        fb_blit(fb, bgr565.data, bgr565.step, 0, 0, fb_w, fb_h);
+        fb_present(fb);
+    }
+    double cv_ms = ms_since(t0);
+    printf("  resize+canvas+cvtColor: %8.3f ms/frame, %7.1f KiB written/frame (checksum %016lx)\n",
+           cv_ms / frames, fb.bytes_last / 1024.0, checksum(fb));
+#endif
+
+    fb_sink_close(fb);
+    return 0;
+}
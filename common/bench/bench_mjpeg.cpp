@@ -0,0 +1,187 @@
+// MJPEG decode benchmark: every frame of a recorded MJPEG stream is brought
+// down to the detector's letterbox size, once with a full-size decode
+// followed by a resize (what a plain decoder has to do) and once with
+// libjpeg's DCT-domain scaling at 1/2, 1/4 and 1/8.
+//
+//   g++ -O2 -std=c++11 bench_mjpeg.cpp ../mjpeg_decode.cpp ../fb_letterbox.cpp ../yuv_convert.cpp ../fb_sink.cpp ../fb_format.cpp -ljpeg -o bench_mjpeg
+//   ./bench_mjpeg [clip.mjpg [target passes]]
+//
+// Without a clip, 30 synthetic 640x480 frames are encoded first. Record a
+// real one on the board with
+//   v4l2-ctl -d /dev/video2 --set-fmt-video=width=640,height=480,pixelformat=MJPG --stream-mmap --stream-count=300 --stream-to=clip.mjpg
+// The resize to target x target (letterboxed, packed BGR24) uses
+// fb_letterbox on a memfd; with -DWITH_OPENCV a cv::imdecode + cv::resize
+// row is added for comparison with the old Lab5 path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "../fb_letterbox.h"
+#include "../fb_sink.h"
+#include "../mjpeg_decode.h"
+#ifdef WITH_OPENCV
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// a moving gradient with some edges, 4:2:0 quality 85 like a UVC camera
+static std::vector<uint8_t> make_stream(int w, int h, int frames)
+{
+    std::vector<uint8_t> stream, row((size_t)w * 3);
+    for (int f = 0; f < frames; f++) {
+        jpeg_compress_struct c;
+        jpeg_error_mgr err;
+        c.err = jpeg_std_error(&err);
+        jpeg_create_compress(&c);
+        unsigned char *out = NULL;
+        unsigned long out_len = 0;
+        jpeg_mem_dest(&c, &out, &out_len);
+        c.image_width = w;
+        c.image_height = h;
+        c.input_components = 3;
+        c.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&c);
+        jpeg_set_quality(&c, 85, TRUE);
+        jpeg_start_compress(&c, TRUE);
+        while (c.next_scanline < c.image_height) {
+            int y = c.next_scanline;
+            for (int x = 0; x < w; x++) {
+                row[x * 3 + 0] = (uint8_t)(x + f * 4);
+                row[x * 3 + 1] = (uint8_t)(y * 2);
+                row[x * 3 + 2] = ((x / 40 + y / 40 + f) & 1) ? 220 : 30;
+            }
+            JSAMPROW r = row.data();
+            jpeg_write_scanlines(&c, &r, 1);
+        }
+        jpeg_finish_compress(&c);
+        jpeg_destroy_compress(&c);
+        stream.insert(stream.end(), out, out + out_len);
+        free(out);
+    }
+    return stream;
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+struct jpeg_frame {
+    const uint8_t *data;
+    size_t len;
+};
+
+int main(int argc, char **argv)
+{
+    const int target = argc > 2 ? atoi(argv[2]) : 320;
+    const int passes = argc > 3 ? atoi(argv[3]) : 3;
+
+    std::vector<uint8_t> stream;
+    if (argc > 1) {
+        if (!read_file(argv[1], stream)) {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        stream = make_stream(640, 480, 30);
+    }
+
+    std::vector<jpeg_frame> frames;
+    for (size_t pos = 0; pos + 4 <= stream.size();) {
+        size_t n = mjpeg_frame_length(&stream[pos], stream.size() - pos);
+        if (n) {
+            jpeg_frame jf = {&stream[pos], n};
+            frames.push_back(jf);
+            pos += n;
+        } else {
+            pos++;
+        }
+    }
+
+    mjpeg_decoder dec;
+    int w, h;
+    if (frames.empty() || !mjpeg_decoder_init(dec) ||
+        !mjpeg_read_header(dec, frames[0].data, frames[0].len, 1, false, w, h)) {
+        fprintf(stderr, "no decodable JPEG frames\n");
+        return 1;
+    }
+
+    // target x target BGR24 canvas, as the detector's letterbox
+    fb_sink fb;
+    if (!fb_sink_open_fd(fb, memfd_create("mjpeg-bench", 0), target, target, 24))
+        return 1;
+    fb_letterbox lb;
+    const fb_rect canvas = {0, 0, target, target};
+    const int picked = mjpeg_pick_denom(w, h, w >= h ? target : 0, w >= h ? 0 : target);
+
+    std::vector<uint8_t> bgr((size_t)w * h * 3);
+    printf("%zu frames %dx%d (%.1f KB avg) -> %dx%d letterbox, %d passes, ms/frame\n", frames.size(), w, h,
+           stream.size() / 1024.0 / frames.size(), target, target, passes);
+    printf("  %-14s %9s %8s %8s\n", "path", "decoded", "decode", "total");
+
+    for (int denom = 1; denom <= 8; denom *= 2) {
+        double decode_ms = 0, total_ms = 0;
+        int ow = 0, oh = 0;
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < frames.size(); i++) {
+                bench_clock::time_point t0 = bench_clock::now();
+                if (!mjpeg_read_header(dec, frames[i].data, frames[i].len, denom, false, ow, oh) ||
+                    !mjpeg_decode(dec, bgr.data(), (size_t)ow * 3)) {
+                    fprintf(stderr, "frame %zu: %s\n", i, mjpeg_error(dec));
+                    return 1;
+                }
+                decode_ms += ms_since(t0);
+                fb_letterbox_bgr(fb, lb, bgr.data(), (size_t)ow * 3, ow, oh, canvas);
+                fb_present(fb);
+                total_ms += ms_since(t0);
+            }
+        }
+
+        const int n = passes * (int)frames.size();
+        char label[32], size[32];
+        snprintf(label, sizeof(label), denom == 1 ? "full + resize" : "1/%d%s", denom,
+                 denom == picked ? " (picked)" : "");
+        snprintf(size, sizeof(size), "%dx%d", ow, oh);
+        printf("  %-14s %9s %8.3f %8.3f\n", label, size, decode_ms / n, total_ms / n);
+    }
+
+#ifdef WITH_OPENCV
+    {
+        double decode_ms = 0, total_ms = 0;
+        const double r = std::min((double)target / w, (double)target / h);
+        cv::Mat img, small;
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < frames.size(); i++) {
+                bench_clock::time_point t0 = bench_clock::now();
+                cv::Mat buf(1, (int)frames[i].len, CV_8UC1, (void *)frames[i].data);
+                img = cv::imdecode(buf, cv::IMREAD_COLOR);
+                decode_ms += ms_since(t0);
+                cv::resize(img, small, cv::Size((int)(w * r + 0.5), (int)(h * r + 0.5)));
+                total_ms += ms_since(t0);
+            }
+        }
+        const int n = passes * (int)frames.size();
+        printf("  %-14s %9s %8.3f %8.3f\n", "cv::imdecode", "", decode_ms / n, total_ms / n);
+    }
+#endif
+
+    mjpeg_decoder_free(dec);
+    fb_sink_close(fb);
+    return 0;
+}
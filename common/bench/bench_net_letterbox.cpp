@@ -0,0 +1,156 @@
+// Network input letterbox benchmark at 320 / 640 / 960: the path Lab5 used
+// (resize into a new image, new black canvas, copy, from_pixels into a new
+// float Mat, normalise in place; re-created here pass for pass without
+// OpenCV / ncnn) against net_letterbox writing into one reused buffer.
+// Heap allocations per call are counted by replacing operator new.
+//
+//   g++ -O2 -std=c++11 bench_net_letterbox.cpp ../net_letterbox.cpp -o bench_net_letterbox
+//   ./bench_net_letterbox [src_width src_height [iterations]]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "../net_letterbox.h"
+
+static size_t g_allocs = 0;
+
+void *operator new(size_t n)
+{
+    g_allocs++;
+    void *p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// ncnn::Mat(w, h, 3) channel step: w * h floats rounded up to 16 bytes
+static size_t mat_cstep(int w, int h)
+{
+    return ((size_t)w * h * 4 + 15) / 16 * 16 / 4;
+}
+
+// ---- the old path, one pass and one allocation at a time ----
+
+// cv::resize INTER_LINEAR on BGR24 (11-bit fixed-point weights like OpenCV)
+static void resize_bgr(const uint8_t *src, int sw, int sh, std::vector<uint8_t> &dst, int dw, int dh)
+{
+    dst.resize((size_t)dw * dh * 3);
+    // tap tables kept between calls: only the full-size images are counted
+    static std::vector<int> xo0, xo1, xa;
+    xo0.resize(dw);
+    xo1.resize(dw);
+    xa.resize(dw);
+    for (int x = 0; x < dw; x++) {
+        double s = (x + 0.5) * sw / dw - 0.5;
+        int s0 = (int)floor(s);
+        double f = s - s0;
+        if (s0 < 0) { s0 = 0; f = 0; }
+        if (s0 >= sw - 1) { s0 = sw - 1; f = 0; }
+        xo0[x] = s0 * 3;
+        xo1[x] = std::min(s0 + 1, sw - 1) * 3;
+        xa[x] = (int)lround(f * 2048);
+    }
+    for (int y = 0; y < dh; y++) {
+        double s = (y + 0.5) * sh / dh - 0.5;
+        int s0 = (int)floor(s);
+        double f = s - s0;
+        if (s0 < 0) { s0 = 0; f = 0; }
+        if (s0 >= sh - 1) { s0 = sh - 1; f = 0; }
+        const uint8_t *r0 = src + (size_t)s0 * sw * 3, *r1 = src + (size_t)std::min(s0 + 1, sh - 1) * sw * 3;
+        const int ya = (int)lround(f * 2048);
+        uint8_t *d = &dst[(size_t)y * dw * 3];
+        for (int x = 0; x < dw; x++)
+            for (int c = 0; c < 3; c++) {
+                int top = r0[xo0[x] + c] * (2048 - xa[x]) + r0[xo1[x] + c] * xa[x];
+                int bot = r1[xo0[x] + c] * (2048 - xa[x]) + r1[xo1[x] + c] * xa[x];
+                d[3 * x + c] = (uint8_t)(((int64_t)top * (2048 - ya) + (int64_t)bot * ya + (1 << 21)) >> 22);
+            }
+    }
+}
+
+static void old_letterbox(const uint8_t *src, int sw, int sh, int target, std::vector<float> &out)
+{
+    const float r = std::min((float)target / sw, (float)target / sh);
+    const int nw = (int)round(sw * r), nh = (int)round(sh * r);
+    const int px = (target - nw) / 2, py = (target - nh) / 2;
+
+    std::vector<uint8_t> resized;                                       // cv::resize
+    resize_bgr(src, sw, sh, resized, nw, nh);
+    std::vector<uint8_t> canvas((size_t)target * target * 3, 0);        // black canvas
+    for (int y = 0; y < nh; y++)                                        // copyTo
+        memcpy(&canvas[((size_t)(py + y) * target + px) * 3], &resized[(size_t)y * nw * 3], (size_t)nw * 3);
+
+    const size_t cstep = mat_cstep(target, target);                     // from_pixels
+    std::vector<float> mat(3 * cstep);
+    for (size_t i = 0; i < (size_t)target * target; i++)
+        for (int c = 0; c < 3; c++) mat[c * cstep + i] = canvas[3 * i + c];
+    const float norm = 1 / 255.f;                                       // substract_mean_normalize
+    for (int c = 0; c < 3; c++)
+        for (size_t i = 0; i < (size_t)target * target; i++) mat[c * cstep + i] *= norm;
+    out.swap(mat);
+}
+
+int main(int argc, char **argv)
+{
+    const int sw = argc > 2 ? atoi(argv[1]) : 1280;
+    const int sh = argc > 2 ? atoi(argv[2]) : 720;
+    const int iters = argc > 3 ? atoi(argv[3]) : 100;
+
+    std::vector<uint8_t> src((size_t)sw * sh * 3);
+    for (int y = 0; y < sh; y++)
+        for (int x = 0; x < sw; x++)
+            for (int c = 0; c < 3; c++)
+                src[((size_t)y * sw + x) * 3 + c] = (uint8_t)((x * (c + 1) + y * 3 + (x * y >> 6)) & 255);
+
+    printf("%dx%d BGR source, %d iterations, ms/call and heap allocations/call\n", sw, sh, iters);
+    const int targets[3] = {320, 640, 960};
+    for (int t = 0; t < 3; t++) {
+        const int target = targets[t];
+        const size_t cstep = mat_cstep(target, target);
+
+        std::vector<float> old_out;
+        size_t a0 = g_allocs;
+        bench_clock::time_point t0 = bench_clock::now();
+        for (int it = 0; it < iters; it++) old_letterbox(src.data(), sw, sh, target, old_out);
+        const double old_ms = ms_since(t0) / iters;
+        const double old_allocs = (double)(g_allocs - a0) / iters;
+
+        // the reused input buffer and geometry exist before the loop, as in the program
+        std::vector<float> buf(3 * cstep);
+        net_letterbox lb;
+        if (net_letterbox_geometry(lb, sw, sh, target)) net_letterbox_pad(lb, buf.data(), cstep);
+        a0 = g_allocs;
+        t0 = bench_clock::now();
+        for (int it = 0; it < iters; it++) {
+            if (net_letterbox_geometry(lb, sw, sh, target)) net_letterbox_pad(lb, buf.data(), cstep);
+            net_letterbox_run(lb, src.data(), (size_t)sw * 3, buf.data(), cstep);
+        }
+        const double new_ms = ms_since(t0) / iters;
+        const double new_allocs = (double)(g_allocs - a0) / iters;
+
+        float max_diff = 0;
+        for (int c = 0; c < 3; c++)
+            for (size_t i = 0; i < (size_t)target * target; i++)
+                max_diff = std::max(max_diff, fabsf(old_out[c * cstep + i] - buf[c * cstep + i]));
+
+        printf("  %4d: old %7.3f ms %4.1f allocs   fused %7.3f ms %4.1f allocs   %.1fx   max diff %.4f (%.2f/255)\n",
+               target, old_ms, old_allocs, new_ms, new_allocs, old_ms / new_ms, max_diff, max_diff * 255);
+    }
+    return 0;
+}
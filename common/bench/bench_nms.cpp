@@ -0,0 +1,137 @@
+// NMS benchmark on synthetic dense scenes: the loop Lab5 used (sort, then
+// every candidate against every kept box, areas recomputed each time)
+// against nms_run() with and without the grid, with top-K and soft-NMS.
+//
+//   g++ -O2 -std=c++11 bench_nms.cpp ../nms.cpp -o bench_nms
+//   ./bench_nms [candidates [objects [iterations]]]
+//
+// Candidates are jittered copies of `objects` ground-truth boxes spread
+// over a 640x640 input, 8 classes, scores as a detector at a low
+// threshold produces them: a few strong boxes per object and a long tail.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <vector>
+#include "../nms.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// the loop from Lab5 (class_aware adds the label check the shared module does)
+static void reference(const std::vector<nms_box> &objs, std::vector<int> &picked, float thr, bool class_aware)
+{
+    picked.clear();
+    std::vector<int> idx(objs.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    std::stable_sort(idx.begin(), idx.end(), [&](int a, int b) { return objs[a].score > objs[b].score; });
+
+    for (size_t n = 0; n < idx.size(); n++) {
+        const nms_box &a = objs[idx[n]];
+        bool keep = true;
+        for (size_t k = 0; k < picked.size(); k++) {
+            const nms_box &b = objs[picked[k]];
+            if (class_aware && a.label != b.label) continue;
+            if (nms_iou(a, b) > thr) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) picked.push_back(idx[n]);
+    }
+}
+
+static void synthesize(std::vector<nms_box> &boxes, int n, int objects)
+{
+    srand(1);
+    std::vector<nms_box> gt(objects);
+    for (int o = 0; o < objects; o++) {
+        const float w = 15 + rand() % 120, h = 15 + rand() % 120;
+        const float x = rand() % (int)(640 - w), y = rand() % (int)(640 - h);
+        nms_box b = {x, y, x + w, y + h, 0, rand() % 8};
+        gt[o] = b;
+    }
+    boxes.resize(n);
+    for (int i = 0; i < n; i++) {
+        const nms_box &g = gt[rand() % objects];
+        const float w = g.x1 - g.x0, h = g.y1 - g.y0;
+        const float j = (rand() % 1000) / 1000.f;           // 0 = on target
+        nms_box b;
+        b.x0 = g.x0 + (rand() % 201 - 100) / 100.f * w * 0.3f * j;
+        b.y0 = g.y0 + (rand() % 201 - 100) / 100.f * h * 0.3f * j;
+        b.x1 = b.x0 + w * (1 + (rand() % 201 - 100) / 100.f * 0.3f * j);
+        b.y1 = b.y0 + h * (1 + (rand() % 201 - 100) / 100.f * 0.3f * j);
+        b.score = 0.1f + 0.85f * (1 - j) * (1 - j);
+        b.label = rand() % 16 == 0 ? rand() % 8 : g.label;  // some confused classes
+        boxes[i] = b;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int n = argc > 1 ? atoi(argv[1]) : 4000;
+    const int objects = argc > 2 ? atoi(argv[2]) : 60;
+    const int iters = argc > 3 ? atoi(argv[3]) : 50;
+    const float thr = 0.45f;
+
+    std::vector<nms_box> boxes;
+    synthesize(boxes, n, objects);
+    printf("%d candidates around %d objects, IoU %.2f, %d iterations, us/call\n", n, objects, thr, iters);
+
+    std::vector<int> ref, ref_cls;
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int it = 0; it < iters; it++) reference(boxes, ref, thr, false);
+    printf("  %-36s %9.1f  (%zu kept)\n", "plain loop (Lab5)", ms_since(t0) * 1000 / iters, ref.size());
+    t0 = bench_clock::now();
+    for (int it = 0; it < iters; it++) reference(boxes, ref_cls, thr, true);
+    printf("  %-36s %9.1f  (%zu kept)\n", "plain loop, per class", ms_since(t0) * 1000 / iters, ref_cls.size());
+
+    nms_workspace ws;
+    bool ok = true;
+    struct variant {
+        const char *name;
+        bool per_class, grid;
+        int top_k;
+        nms_method method;
+        const std::vector<int> *expect;
+    } variants[] = {
+        {"nms_run, any class, no grid", false, false, 0, NMS_HARD, &ref},
+        {"nms_run, any class, grid", false, true, 0, NMS_HARD, &ref},
+        {"nms_run, per class, no grid", true, false, 0, NMS_HARD, &ref_cls},
+        {"nms_run, per class, grid", true, true, 0, NMS_HARD, &ref_cls},
+        {"nms_run, per class, grid, top 1000", true, true, 1000, NMS_HARD, NULL},
+        {"soft-NMS linear, per class, grid", true, true, 0, NMS_SOFT_LINEAR, NULL},
+        {"soft-NMS gaussian, per class, grid", true, true, 0, NMS_SOFT_GAUSSIAN, NULL},
+        {"soft-NMS gaussian, per class, no grid", true, false, 0, NMS_SOFT_GAUSSIAN, NULL},
+    };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        const variant &var = variants[v];
+        nms_config cfg;
+        cfg.iou_thresh = thr;
+        cfg.per_class = var.per_class;
+        cfg.use_grid = var.grid;
+        cfg.top_k = var.top_k;
+        cfg.method = var.method;
+        cfg.soft_min_score = 0.1f;      // Lab5's CONF_THRESH
+
+        t0 = bench_clock::now();
+        for (int it = 0; it < iters; it++) nms_run(ws, boxes.data(), n, cfg);
+        const double us = ms_since(t0) * 1000 / iters;
+
+        // hard NMS must keep what the plain loop keeps, in the same order
+        const char *check = "";
+        if (var.expect) {
+            const bool match = *var.expect == ws.keep;
+            check = match ? ", identical" : ", DIFFERENT";
+            ok = ok && match;
+        }
+        printf("  %-36s %9.1f  (%zu kept%s)\n", var.name, us, ws.keep.size(), check);
+    }
+    return ok ? 0 : 1;
+}
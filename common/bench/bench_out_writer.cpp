@@ -0,0 +1,117 @@
+// Result-file writing benchmark: `files` files of `kb` KB (JPEG-sized
+// random bytes, no encoder) written into `dir` four ways:
+//   sync()          temp file, rename, global sync() per file (old part2)
+//   durable inline  temp file, fdatasync, rename, directory fsync per file
+//   out_writer 1    the same on the writer thread, directory fsync per file
+//   out_writer N    writer thread, one directory fsync per N files
+// For the writer the caller's time (blocked in submit) is shown as well.
+//
+//   g++ -O2 -std=c++11 -pthread bench_out_writer.cpp ../out_writer.cpp -o bench_out_writer
+//   ./bench_out_writer [dir [files [kb [N]]]]
+//
+// Run it once on a tmpfs (/dev/shm) and once on the SD card / disk the
+// results go to. sync() costs more the more else is dirty on the system
+// (camera recordings, other writers), which a quiet run doesn't show.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../out_writer.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static std::string file_name(const std::string &dir, const char *mode, int i)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/bench_%s_%04d.jpg", mode, i);
+    return dir + name;
+}
+
+static void print_row(const char *what, int files, int kb, double total_ms, double caller_ms)
+{
+    printf("  %-16s: %8.1f files/s  %7.1f MB/s  caller %6.2f ms/file\n", what, files * 1000.0 / total_ms,
+           files * (double)kb / 1024 * 1000.0 / total_ms, caller_ms / files);
+}
+
+static void remove_files(const std::string &dir, const char *mode, int files)
+{
+    for (int i = 0; i < files; i++) unlink(file_name(dir, mode, i).c_str());
+}
+
+static void run_writer(const std::string &dir, const std::vector<unsigned char> &data, int files, int kb,
+                       int dir_sync_files, const char *mode, const char *label)
+{
+    out_writer_config cfg;
+    cfg.dir_sync_files = dir_sync_files;
+    out_writer w(cfg);
+    out_writer_start(w);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    double caller_ms = 0;
+    for (int i = 0; i < files; i++) {
+        bench_clock::time_point t1 = bench_clock::now();
+        out_writer_submit(w, file_name(dir, mode, i), [&data](std::vector<unsigned char> &out) {
+            out = data;
+            return true;
+        });
+        caller_ms += ms_since(t1);
+    }
+    out_writer_stop(w);
+    print_row(label, files, kb, ms_since(t0), caller_ms);
+    remove_files(dir, mode, files);
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = argc > 1 ? argv[1] : ".";
+    int files = argc > 2 ? atoi(argv[2]) : 200;
+    int kb = argc > 3 ? atoi(argv[3]) : 300;
+    int batch = argc > 4 ? atoi(argv[4]) : 32;
+
+    std::vector<unsigned char> data((size_t)kb * 1024);
+    srand(1);
+    for (unsigned char &b : data) b = (unsigned char)rand();
+
+    printf("%d files of %d KB in %s\n", files, kb, dir.c_str());
+
+    // old part2: write, rename, sync()
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int i = 0; i < files; i++) {
+        std::string path = file_name(dir, "sync", i), tmp = path + ".tmp";
+        FILE *f = fopen(tmp.c_str(), "wb");
+        if (!f || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+            fprintf(stderr, "write %s failed\n", tmp.c_str());
+            return 1;
+        }
+        fclose(f);
+        rename(tmp.c_str(), path.c_str());
+        sync();
+    }
+    double ms = ms_since(t0);
+    print_row("sync()", files, kb, ms, ms);
+    remove_files(dir, "sync", files);
+
+    t0 = bench_clock::now();
+    std::string d;
+    for (int i = 0; i < files; i++) {
+        if (!durable_write_file(file_name(dir, "inline", i), data.data(), data.size(), d)) return 1;
+        durable_sync_dir(d);
+    }
+    ms = ms_since(t0);
+    print_row("durable inline", files, kb, ms, ms);
+    remove_files(dir, "inline", files);
+
+    run_writer(dir, data, files, kb, 1, "w1", "out_writer 1");
+    char label[32];
+    snprintf(label, sizeof(label), "out_writer %d", batch);
+    run_writer(dir, data, files, kb, batch, "wn", label);
+    return 0;
+}
@@ -0,0 +1,132 @@
+// YOLOv8 out0 decoding benchmark: the per-proposal loop Lab5 used (reads
+// out.row(k)[i] down all 84 rows for every proposal, then filters by
+// class) against yolo_decode's row-wise SIMD argmax, scanning all classes
+// (YOLO_SUBSET_FILTER, must give the same candidates) and only the 8
+// target classes (YOLO_SUBSET_ONLY).
+//
+//   g++ -O2 -std=c++11 bench_yolo_decode.cpp ../yolo_decode.cpp -o bench_yolo_decode
+//   ./bench_yolo_decode [out0.bin [iterations]]
+//
+// out0.bin is a tensor recorded by Lab5/part1 with YOLO_DUMP_OUT0=out0.bin;
+// without one a synthetic 84 x 2100 tensor (320x320 input) is used.
+// -mavx2 / -mfpu=neon / -DFB_NO_SIMD as for the other benchmarks.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "../yolo_decode.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+static const int NUM_CLASSES = 80;
+static const int TARGETS[8] = {39, 41, 44, 46, 66, 67, 73, 76};
+static const float CONF_THRESH = 0.1f;
+
+static bool is_target_class(int cls)
+{
+    for (int i = 0; i < 8; i++)
+        if (TARGETS[i] == cls) return true;
+    return false;
+}
+
+// the loop from Lab5/part1 (out.row(k)[i] == data[k * num + i])
+static void reference(const float *data, int rows, int num, std::vector<yolo_candidate> &out)
+{
+    out.clear();
+    bool has_obj = rows == 5 + NUM_CLASSES;
+    for (int i = 0; i < num; i++) {
+        float cx = data[0 * num + i], cy = data[1 * num + i];
+        float w = data[2 * num + i], h = data[3 * num + i];
+        float obj = has_obj ? data[4 * num + i] : 1.f;
+        if (obj < CONF_THRESH) continue;
+        int cls_start = has_obj ? 5 : 4;
+        int best_cls = -1;
+        float best_score = 0.f;
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            float s = data[(cls_start + c) * num + i];
+            if (s > best_score) {
+                best_score = s;
+                best_cls = c;
+            }
+        }
+        float score = obj * best_score;
+        if (score < CONF_THRESH) continue;
+        if (!is_target_class(best_cls)) continue;
+        yolo_candidate c = {cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, score, best_cls};
+        out.push_back(c);
+    }
+}
+
+// mostly background (sigmoid of strongly negative logits), a few hundred
+// proposals with one clear class, like a cluttered desk
+static void synthesize(std::vector<float> &data, int &rows, int &num)
+{
+    rows = 4 + NUM_CLASSES;
+    num = 40 * 40 + 20 * 20 + 10 * 10;
+    data.resize((size_t)rows * num);
+    srand(1);
+    for (int i = 0; i < num; i++) {
+        data[0 * num + i] = rand() % 320;
+        data[1 * num + i] = rand() % 320;
+        data[2 * num + i] = 10 + rand() % 100;
+        data[3 * num + i] = 10 + rand() % 100;
+        const int peak = rand() % 8 == 0 ? rand() % NUM_CLASSES : -1;
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            float logit = c == peak ? -2.f + (rand() % 500) / 100.f : -9.f + (rand() % 400) / 100.f;
+            data[(4 + c) * num + i] = 1.f / (1.f + expf(-logit));
+        }
+    }
+}
+
+static bool same(const std::vector<yolo_candidate> &a, const std::vector<yolo_candidate> &b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].label != b[i].label || a[i].score != b[i].score || a[i].x0 != b[i].x0 || a[i].y1 != b[i].y1)
+            return false;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const int iters = argc > 2 ? atoi(argv[2]) : 2000;
+    std::vector<float> data;
+    int rows, num;
+    if (argc > 1) {
+        if (!yolo_load_tensor(argv[1], data, rows, num)) {
+            fprintf(stderr, "cannot read tensor %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        synthesize(data, rows, num);
+    }
+
+    std::vector<yolo_candidate> ref;
+    yolo_decoder all, subset;
+    yolo_decoder_init(all, NUM_CLASSES, TARGETS, 8, YOLO_SUBSET_FILTER);
+    yolo_decoder_init(subset, NUM_CLASSES, TARGETS, 8, YOLO_SUBSET_ONLY);
+
+    printf("out0 %d x %d, threshold %.2f, %d iterations, us/decode\n", rows, num, CONF_THRESH, iters);
+
+    bench_clock::time_point t0 = bench_clock::now();
+    for (int it = 0; it < iters; it++) reference(data.data(), rows, num, ref);
+    printf("  %-34s %8.1f  (%zu candidates)\n", "per-proposal loop (Lab5)", ms_since(t0) * 1000 / iters, ref.size());
+
+    t0 = bench_clock::now();
+    for (int it = 0; it < iters; it++) yolo_decode(all, data.data(), num, rows, num, CONF_THRESH);
+    printf("  %-34s %8.1f  (%zu candidates, %s)\n", "row-wise, all classes + filter", ms_since(t0) * 1000 / iters,
+           all.out.size(), same(ref, all.out) ? "identical" : "DIFFERENT");
+
+    t0 = bench_clock::now();
+    for (int it = 0; it < iters; it++) yolo_decode(subset, data.data(), num, rows, num, CONF_THRESH);
+    printf("  %-34s %8.1f  (%zu candidates)\n", "row-wise, 8 target classes only", ms_since(t0) * 1000 / iters,
+           subset.out.size());
+    return same(ref, all.out) ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Camera-buffer conversion benchmark: a synthetic YUYV / NV12 frame goes to
+// grey and onto a memfd framebuffer, directly (yuv_convert + fb_letterbox_yuv)
+// and the old way, through a full BGR frame.
+//
+//   g++ -O2 -std=c++11 bench_yuv.cpp ../yuv_convert.cpp ../fb_letterbox.cpp ../fb_sink.cpp ../fb_format.cpp -o bench_yuv
+//   ./bench_yuv [src_w src_h fb_w fb_h frames]
+//
+// -mavx2 / -mfpu=neon / -DFB_NO_SIMD as for the other benchmarks. With
+// -DWITH_OPENCV the "via BGR" rows use cvtColor like the Lab programs did;
+// without it the BGR frame is made with the same row kernels.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <chrono>
+#include <vector>
+#include "../fb_letterbox.h"
+#include "../fb_sink.h"
+#include "../yuv_convert.h"
+#ifdef WITH_OPENCV
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double ms_since(bench_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+struct yuv_image {
+    yuv_layout layout;
+    int w, h;
+    std::vector<uint8_t> data;      // YUYV, or Y plane followed by UV plane
+    size_t step;
+    const uint8_t *y() const { return data.data(); }
+    const uint8_t *uv() const { return layout == YUV_NV12 ? data.data() + step * h : NULL; }
+};
+
+static yuv_image make_image(yuv_layout layout, int w, int h)
+{
+    yuv_image img;
+    img.layout = layout;
+    img.w = w;
+    img.h = h;
+    img.step = layout == YUV_YUYV ? (size_t)w * 2 : (size_t)w;
+    img.data.resize(layout == YUV_YUYV ? img.step * h : img.step * h * 3 / 2);
+    for (size_t i = 0; i < img.data.size(); i++)
+        img.data[i] = (uint8_t)((i * 7 + (i / img.step) * 3) & 0xff);
+    return img;
+}
+
+static void to_bgr(const yuv_image &img, std::vector<uint8_t> &bgr)
+{
+#ifdef WITH_OPENCV
+    cv::Mat src(img.layout == YUV_YUYV ? img.h : img.h * 3 / 2, img.w,
+                img.layout == YUV_YUYV ? CV_8UC2 : CV_8UC1, (void *)img.y(), img.step);
+    cv::Mat dst(img.h, img.w, CV_8UC3, bgr.data());
+    cv::cvtColor(src, dst, img.layout == YUV_YUYV ? cv::COLOR_YUV2BGR_YUYV : cv::COLOR_YUV2BGR_NV12);
+#else
+    yuv_row_fn row = yuv_row_kernel(img.layout, FB_FMT_RGB888);
+    for (int y = 0; y < img.h; y++)
+        row(img.y() + img.step * y, img.uv() ? img.uv() + img.step * (y / 2) : NULL, 0, img.w,
+            &bgr[(size_t)y * img.w * 3]);
+#endif
+}
+
+static void bgr_to_gray(const std::vector<uint8_t> &bgr, std::vector<uint8_t> &gray, int w, int h)
+{
+#ifdef WITH_OPENCV
+    cv::Mat src(h, w, CV_8UC3, (void *)bgr.data()), dst(h, w, CV_8UC1, gray.data());
+    cv::cvtColor(src, dst, cv::COLOR_BGR2GRAY);
+#else
+    for (size_t i = 0; i < (size_t)w * h; i++)
+        gray[i] = (uint8_t)((29 * bgr[3 * i] + 150 * bgr[3 * i + 1] + 77 * bgr[3 * i + 2] + 128) >> 8);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    int src_w = argc > 1 ? atoi(argv[1]) : 640;
+    int src_h = argc > 2 ? atoi(argv[2]) : 480;
+    int fb_w = argc > 3 ? atoi(argv[3]) : 1920;
+    int fb_h = argc > 4 ? atoi(argv[4]) : 1080;
+    int frames = argc > 5 ? atoi(argv[5]) : 100;
+
+    fb_sink fb;
+    if (!fb_sink_open_fd(fb, memfd_create("fb-bench", 0), fb_w, fb_h, 16))
+        return 1;
+
+    fb_rect copy = {0, 0, src_w, src_h};
+    fb_rect view;
+    view.h = fb_h;
+    view.w = fb_h * 4 / 3;
+    view.x = (fb_w - view.w) / 2;
+    view.y = 0;
+
+    std::vector<uint8_t> bgr((size_t)src_w * src_h * 3), gray((size_t)src_w * src_h);
+    printf("%dx%d camera frame -> grey + %dx%d %s screen, %d frames, ms/frame\n",
+           src_w, src_h, fb_w, fb_h, fb_format_name(fb.format), frames);
+    printf("  %-5s %-9s %8s %8s %8s\n", "input", "path", "grey", "1:1", "scaled");
+
+    const yuv_layout layouts[2] = {YUV_YUYV, YUV_NV12};
+    for (int l = 0; l < 2; l++) {
+        yuv_image img = make_image(layouts[l], src_w, src_h);
+        const char *name = layouts[l] == YUV_YUYV ? "YUYV" : "NV12";
+        fb_letterbox lb;
+
+        // direct: grey from Y, YUV straight into the framebuffer
+        bench_clock::time_point t0 = bench_clock::now();
+        for (int f = 0; f < frames; f++)
+            if (img.layout == YUV_YUYV)
+                yuv_yuyv_to_gray(img.y(), img.step, gray.data(), src_w, src_w, src_h);
+        double gray_ms = ms_since(t0) / frames;     // NV12: the Y plane is used as is
+        double out_ms[2];
+        const fb_rect views[2] = {copy, view};
+        for (int v = 0; v < 2; v++) {
+            t0 = bench_clock::now();
+            for (int f = 0; f < frames; f++) {
+                fb_letterbox_yuv(fb, lb, img.layout, img.y(), img.step, img.uv(), img.step,
+                                 src_w, src_h, views[v], &views[v]);
+                fb_present(fb);
+            }
+            out_ms[v] = ms_since(t0) / frames;
+        }
+        printf("  %-5s %-9s %8.3f %8.3f %8.3f\n", name, "direct", gray_ms, out_ms[0], out_ms[1]);
+
+        // via a full BGR frame: YUV -> BGR once, then BGR -> grey and BGR -> screen
+        t0 = bench_clock::now();
+        for (int f = 0; f < frames; f++) {
+            to_bgr(img, bgr);
+            bgr_to_gray(bgr, gray, src_w, src_h);
+        }
+        gray_ms = ms_since(t0) / frames;
+        for (int v = 0; v < 2; v++) {
+            t0 = bench_clock::now();
+            for (int f = 0; f < frames; f++) {
+                to_bgr(img, bgr);
+                fb_letterbox_bgr(fb, lb, bgr.data(), (size_t)src_w * 3, src_w, src_h, views[v], &views[v]);
+                fb_present(fb);
+            }
+            out_ms[v] = ms_since(t0) / frames;
+        }
+        printf("  %-5s %-9s %8.3f %8.3f %8.3f\n", name, "via BGR", gray_ms, out_ms[0], out_ms[1]);
+    }
+
+    fb_sink_close(fb);
+    return 0;
+}
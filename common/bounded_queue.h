@@ -0,0 +1,110 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// ================== Bounded queue between pipeline stages ==================
+// Fixed-capacity FIFO for handing work from one stage thread to the next.
+// push() blocks while the queue is full, so a slow stage holds back the
+// ones before it instead of letting work pile up; the first stage uses
+// push_latest() instead, which never blocks and drops the oldest entry, so
+// the camera side is never stalled by inference.
+//
+// Entries are moved in and out of a ring of `capacity` T objects that is
+// allocated once. close() ends the stream: pop() still returns what is
+// queued, then false, and the consumer closes its own output in turn, so
+// shutting down the first queue drains the whole pipeline.
+
+template <typename T>
+struct bounded_queue {
+    explicit bounded_queue(size_t capacity)
+        : buf(capacity ? capacity : 1), head(0), count(0), closed(false), pushed(0), dropped(0) {}
+
+    // Wait for room, then append. False if the queue has been closed.
+    bool push(T &&v)
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        not_full.wait(hold, [&] { return count < buf.size() || closed; });
+        if (closed) return false;
+        put(std::move(v));
+        return true;
+    }
+
+    // Append without waiting; when full the oldest entry is thrown away.
+    // False if the queue has been closed.
+    bool push_latest(T &&v)
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        if (closed) return false;
+        if (count == buf.size()) {
+            head = (head + 1) % buf.size();
+            count--;
+            dropped++;
+        }
+        put(std::move(v));
+        return true;
+    }
+
+    // Wait for an entry and move it into v. False once the queue is closed
+    // and empty.
+    bool pop(T &v)
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        not_empty.wait(hold, [&] { return count > 0 || closed; });
+        if (count == 0) return false;
+        v = std::move(buf[head]);
+        head = (head + 1) % buf.size();
+        count--;
+        not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        return count;
+    }
+
+    uint64_t pushed_count()
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        return pushed;
+    }
+
+    uint64_t dropped_count()
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        return dropped;
+    }
+
+private:
+    void put(T &&v)
+    {
+        buf[(head + count) % buf.size()] = std::move(v);
+        count++;
+        pushed++;
+        not_empty.notify_one();
+    }
+
+    std::vector<T> buf;
+    size_t head, count;
+    bool closed;
+    uint64_t pushed, dropped;
+    std::mutex lock;
+    std::condition_variable not_empty, not_full;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "box_tracker.h"
+
+#include <algorithm>
+
+// ---- per-axis Kalman filter ----
+
+static void axis_init(trk_axis &a, float z, const trk_config &cfg)
+{
+    a.p = z;
+    a.v = 0;
+    a.P00 = cfg.meas_noise * cfg.meas_noise;
+    a.P01 = 0;
+    a.P11 = cfg.init_speed * cfg.init_speed;
+}
+
+// state dt seconds later: x' = F x, P' = F P F^T + Q
+static void axis_predict(trk_axis &a, float dt, float q)
+{
+    a.p += a.v * dt;
+    const float P00 = a.P00 + dt * (2 * a.P01 + dt * a.P11);
+    const float P01 = a.P01 + dt * a.P11;
+    a.P00 = P00 + q * dt * dt * dt / 3;
+    a.P01 = P01 + q * dt * dt / 2;
+    a.P11 += q * dt;
+}
+
+// measurement z of the position
+static void axis_correct(trk_axis &a, float z, float r)
+{
+    const float s = a.P00 + r;
+    const float k0 = a.P00 / s, k1 = a.P01 / s;
+    const float y = z - a.p;
+    a.p += k0 * y;
+    a.v += k1 * y;
+    const float P00 = (1 - k0) * a.P00;
+    const float P01 = (1 - k0) * a.P01;
+    const float P11 = a.P11 - k1 * a.P01;
+    a.P00 = P00;
+    a.P01 = P01;
+    a.P11 = P11;
+}
+
+static float axis_at(const trk_axis &a, float dt)
+{
+    return a.p + a.v * dt;
+}
+
+// ---- tracks ----
+
+static trk_box track_box(const trk_track &t, float dt)
+{
+    const float w = std::max(axis_at(t.w, dt), 1.f), h = std::max(axis_at(t.h, dt), 1.f);
+    trk_box b = {axis_at(t.cx, dt) - w / 2, axis_at(t.cy, dt) - h / 2, w, h};
+    return b;
+}
+
+float trk_iou(const trk_box &a, const trk_box &b)
+{
+    const float x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    const float x1 = std::min(a.x + a.w, b.x + b.w), y1 = std::min(a.y + a.h, b.y + b.h);
+    if (x1 <= x0 || y1 <= y0) return 0;
+    const float inter = (x1 - x0) * (y1 - y0);
+    return inter / (a.w * a.h + b.w * b.h - inter);
+}
+
+struct pair_iou {
+    float iou;
+    int track, det;
+};
+
+void tracker_update(box_tracker &tr, const trk_detection *dets, int n, int64_t t_us)
+{
+    const trk_config &cfg = tr.cfg;
+    const float q = cfg.accel_noise * cfg.accel_noise;
+    const float r = cfg.meas_noise * cfg.meas_noise;
+
+    // older than what we already know
+    for (size_t i = 0; i < tr.tracks.size(); i++)
+        if (t_us < tr.tracks[i].t_us) return;
+
+    // bring every track to the detection's time
+    for (size_t i = 0; i < tr.tracks.size(); i++) {
+        trk_track &t = tr.tracks[i];
+        const float dt = (t_us - t.t_us) / 1e6f;
+        axis_predict(t.cx, dt, q);
+        axis_predict(t.cy, dt, q);
+        axis_predict(t.w, dt, q);
+        axis_predict(t.h, dt, q);
+        t.t_us = t_us;
+    }
+
+    // candidate pairs, best IoU first
+    std::vector<pair_iou> pairs;
+    for (size_t i = 0; i < tr.tracks.size(); i++) {
+        const trk_box tb = track_box(tr.tracks[i], 0);
+        for (int d = 0; d < n; d++) {
+            if (dets[d].label != tr.tracks[i].label) continue;
+            const float iou = trk_iou(tb, dets[d].box);
+            if (iou >= cfg.iou_match) {
+                pair_iou p = {iou, (int)i, d};
+                pairs.push_back(p);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const pair_iou &a, const pair_iou &b) { return a.iou > b.iou; });
+
+    std::vector<char> track_used(tr.tracks.size(), 0), det_used(n, 0);
+    for (size_t k = 0; k < pairs.size(); k++) {
+        const pair_iou &p = pairs[k];
+        if (track_used[p.track] || det_used[p.det]) continue;
+        track_used[p.track] = det_used[p.det] = 1;
+
+        trk_track &t = tr.tracks[p.track];
+        const trk_box &b = dets[p.det].box;
+        axis_correct(t.cx, b.x + b.w / 2, r);
+        axis_correct(t.cy, b.y + b.h / 2, r);
+        axis_correct(t.w, b.w, r);
+        axis_correct(t.h, b.h, r);
+        t.score = dets[p.det].score;
+        t.seen_us = t_us;
+        t.hits++;
+    }
+
+    // drop tracks unmatched for too long; the others coast on their velocity
+    size_t keep = 0;
+    for (size_t i = 0; i < tr.tracks.size(); i++) {
+        if (t_us - tr.tracks[i].seen_us > (int64_t)(cfg.max_coast_s * 1e6f)) continue;
+        tr.tracks[keep++] = tr.tracks[i];
+    }
+    tr.tracks.resize(keep);
+
+    for (int d = 0; d < n; d++) {
+        if (det_used[d]) continue;
+        trk_track t;
+        const trk_box &b = dets[d].box;
+        t.id = tr.next_id++;
+        t.label = dets[d].label;
+        t.score = dets[d].score;
+        axis_init(t.cx, b.x + b.w / 2, cfg);
+        axis_init(t.cy, b.y + b.h / 2, cfg);
+        axis_init(t.w, b.w, cfg);
+        axis_init(t.h, b.h, cfg);
+        t.t_us = t.seen_us = t_us;
+        t.hits = 1;
+        tr.tracks.push_back(t);
+    }
+}
+
+void tracker_boxes(const box_tracker &tr, int64_t t_us, int width, int height, std::vector<trk_output> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < tr.tracks.size(); i++) {
+        const trk_track &t = tr.tracks[i];
+        if (t.hits < tr.cfg.min_hits) continue;
+
+        trk_output o;
+        o.id = t.id;
+        o.label = t.label;
+        o.score = t.score;
+        o.box = track_box(t, (t_us - t.t_us) / 1e6f);
+        if (width > 0 && height > 0) {
+            const float x0 = std::max(o.box.x, 0.f), y0 = std::max(o.box.y, 0.f);
+            const float x1 = std::min(o.box.x + o.box.w, (float)width);
+            const float y1 = std::min(o.box.y + o.box.h, (float)height);
+            if (x1 <= x0 || y1 <= y0) continue;        // moved off the frame
+            o.box.x = x0;
+            o.box.y = y0;
+            o.box.w = x1 - x0;
+            o.box.h = y1 - y0;
+        }
+        out.push_back(o);
+    }
+}
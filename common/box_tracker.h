@@ -0,0 +1,85 @@
+#ifndef BOX_TRACKER_H
+#define BOX_TRACKER_H
+
+#include <stdint.h>
+#include <vector>
+
+// ================== Multi-object box tracker ==================
+// Keeps detector boxes on moving objects between detections (SORT-style):
+//   - every track runs a constant-velocity Kalman filter on box centre,
+//     width and height (one [position, velocity] filter per coordinate,
+//     white-noise acceleration model), in pixels and seconds;
+//   - each detection result is associated to the tracks by IoU of the
+//     predicted boxes, greedily best-first and per class; matches update
+//     the filter, leftovers start new tracks, tracks unmatched for
+//     max_coast_s are dropped;
+//   - box positions can be asked for at any time, so every displayed frame
+//     gets boxes extrapolated to its own capture time.
+// Detections usually arrive a few frames late (they belong to an older
+// camera frame); tracker_update() takes the capture time they were made
+// at, so the filter is corrected at the right moment and the velocity
+// carries the box up to the frame on screen.
+//
+// Track ids are stable for the life of a track. Single-threaded: keep the
+// tracker in the thread that draws.
+
+struct trk_box {
+    float x, y, w, h;           // top-left corner + size, pixels
+};
+
+struct trk_detection {
+    trk_box box;
+    int label;
+    float score;
+};
+
+struct trk_config {
+    float iou_match = 0.3f;     // minimum IoU to associate a detection with a track
+    float max_coast_s = 0.5f;   // drop a track this long after its last match
+    int min_hits = 2;           // matches before a track is reported (1 = at once)
+    float accel_noise = 300.f;  // expected acceleration, px/s^2 (process noise)
+    float meas_noise = 4.f;     // detector box jitter, px
+    float init_speed = 200.f;   // velocity uncertainty of a new track, px/s
+};
+
+// [position, velocity] Kalman filter along one coordinate
+struct trk_axis {
+    float p, v;
+    float P00, P01, P11;        // covariance (symmetric)
+};
+
+struct trk_track {
+    int id;
+    int label;
+    float score;                // of the last matched detection
+    trk_axis cx, cy, w, h;
+    int64_t t_us;               // time the filter state refers to (last update)
+    int64_t seen_us;            // last time a detection matched
+    int hits;
+};
+
+struct box_tracker {
+    trk_config cfg;
+    std::vector<trk_track> tracks;
+    int next_id = 1;
+};
+
+// Feed one detection result, made on the camera frame captured at t_us.
+// Results older than the tracker's state are ignored.
+void tracker_update(box_tracker &tr, const trk_detection *dets, int n, int64_t t_us);
+
+// One reported track, extrapolated to time t_us.
+struct trk_output {
+    int id;
+    int label;
+    float score;
+    trk_box box;
+};
+
+// Boxes of all confirmed tracks at t_us (clipped to width x height if
+// those are > 0). out is cleared first.
+void tracker_boxes(const box_tracker &tr, int64_t t_us, int width, int height, std::vector<trk_output> &out);
+
+float trk_iou(const trk_box &a, const trk_box &b);
+
+#endif
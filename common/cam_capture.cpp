@@ -0,0 +1,706 @@
+#include "cam_capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "yuv_convert.h"
+
+static void cam_reset(cam_capture &cam)
+{
+    cam.kind = CAM_V4L2;
+    cam.fd = -1;
+    cam.width = cam.height = 0;
+    cam.fourcc = 0;
+    cam.outputs = 0;
+    cam.stride = cam.frame_size = 0;
+    cam.buffers = 0;
+    for (int i = 0; i < CAM_MAX_BUFFERS; i++) {
+        cam.map[i] = NULL;
+        cam.map_len[i] = 0;
+        cam.held[i] = false;
+        cam.gray_buf[i].release();
+        cam.video_buf[i].release();
+    }
+    cam.streaming = false;
+    cam.file_map = NULL;
+    cam.file_size = cam.file_frames = cam.next_frame = 0;
+    cam.next_buf = 0;
+    cam.jpeg_offsets.clear();
+    cam.frame_interval_us = cam.next_due_us = 0;
+    cam.coded_width = cam.coded_height = 0;
+    cam.decode_denom = 1;
+    cam.jpeg.ready = false;
+    cam.sequence = 0;
+}
+
+int64_t cam_now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ioctl that retries when interrupted by a signal
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+    int r;
+    do {
+        r = ioctl(fd, req, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+const char *cam_default_path(const char *def)
+{
+    const char *env = getenv("CAM_DEVICE");
+    return (env && *env) ? env : def;
+}
+
+const char *cam_fourcc_name(uint32_t fourcc, char buf[5])
+{
+    for (int i = 0; i < 4; i++) buf[i] = (char)((fourcc >> (8 * i)) & 0xff);
+    buf[4] = 0;
+    return buf;
+}
+
+// bytes of one frame and of its first-plane row for the packed / NV12
+// layouts the stand-ins understand; 0 if the format is not one of them
+static size_t frame_bytes(uint32_t fourcc, int w, int h, size_t &stride)
+{
+    switch (fourcc) {
+    case V4L2_PIX_FMT_YUYV:  stride = (size_t)w * 2; return stride * h;
+    case V4L2_PIX_FMT_NV12:  stride = (size_t)w;     return stride * h * 3 / 2;
+    case V4L2_PIX_FMT_BGR24: stride = (size_t)w * 3; return stride * h;
+    default:                 stride = 0;             return 0;
+    }
+}
+
+static uint32_t fourcc_from_extension(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (!dot) return 0;
+    if (!strcasecmp(dot, ".yuyv") || !strcasecmp(dot, ".yuv")) return V4L2_PIX_FMT_YUYV;
+    if (!strcasecmp(dot, ".nv12")) return V4L2_PIX_FMT_NV12;
+    if (!strcasecmp(dot, ".bgr")) return V4L2_PIX_FMT_BGR24;
+    if (!strcasecmp(dot, ".mjpg") || !strcasecmp(dot, ".mjpeg")) return V4L2_PIX_FMT_MJPEG;
+    return 0;
+}
+
+// $CAM_FORMAT: a fourcc name ("YUYV", "NV12", "MJPG", "BGR3"), 0 if unset
+static uint32_t fourcc_from_env()
+{
+    const char *env = getenv("CAM_FORMAT");
+    if (!env || strlen(env) != 4) return 0;
+    if (!strcasecmp(env, "MJPG")) return V4L2_PIX_FMT_MJPEG;
+    return v4l2_fourcc(env[0], env[1], env[2], env[3]);
+}
+
+// ---- V4L2 ----
+
+static bool has_format(int fd, uint32_t fourcc)
+{
+    v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (desc.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0; desc.index++)
+        if (desc.pixelformat == fourcc) return true;
+    return false;
+}
+
+// Capture format for fourcc 0: NV12 makes grey free, YUYV is what every
+// UVC camera has.
+static uint32_t pick_format(int fd, int outputs)
+{
+    if ((outputs & CAM_OUT_GRAY) && has_format(fd, V4L2_PIX_FMT_NV12)) return V4L2_PIX_FMT_NV12;
+    if (has_format(fd, V4L2_PIX_FMT_YUYV)) return V4L2_PIX_FMT_YUYV;
+    if (has_format(fd, V4L2_PIX_FMT_NV12)) return V4L2_PIX_FMT_NV12;
+    return V4L2_PIX_FMT_YUYV;
+}
+
+static bool open_v4l2(cam_capture &cam, const cam_config &cfg, double fps)
+{
+    char name[5];
+
+    v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(cam.fd, VIDIOC_QUERYCAP, &cap) != 0) {
+        std::cerr << "[ERR] " << cfg.path << " is not a V4L2 device\n";
+        return false;
+    }
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+        std::cerr << "[ERR] " << cfg.path << " cannot stream video capture\n";
+        return false;
+    }
+
+    const uint32_t want = cfg.fourcc ? cfg.fourcc : pick_format(cam.fd, cfg.outputs);
+    v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = cam.width;
+    fmt.fmt.pix.height = cam.height;
+    fmt.fmt.pix.pixelformat = want;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(cam.fd, VIDIOC_S_FMT, &fmt) != 0) {
+        std::cerr << "[ERR] VIDIOC_S_FMT failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    // the driver may have picked something else; take what it gives
+    cam.width = fmt.fmt.pix.width;
+    cam.height = fmt.fmt.pix.height;
+    cam.fourcc = fmt.fmt.pix.pixelformat;
+    cam.stride = fmt.fmt.pix.bytesperline;
+    cam.frame_size = fmt.fmt.pix.sizeimage;
+    if (cam.fourcc != want)
+        std::cerr << "[WARN] camera delivers " << cam_fourcc_name(cam.fourcc, name)
+                  << " instead of the requested format\n";
+
+    if (fps > 0) {
+        v4l2_streamparm parm;
+        memset(&parm, 0, sizeof(parm));
+        parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        parm.parm.capture.timeperframe.numerator = 1000;
+        parm.parm.capture.timeperframe.denominator = (uint32_t)(fps * 1000);
+        xioctl(cam.fd, VIDIOC_S_PARM, &parm);   // best effort
+    }
+
+    v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = cam.buffers;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(cam.fd, VIDIOC_REQBUFS, &req) != 0 || req.count < 2) {
+        std::cerr << "[ERR] VIDIOC_REQBUFS failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    cam.buffers = req.count < CAM_MAX_BUFFERS ? (int)req.count : CAM_MAX_BUFFERS;
+
+    for (int i = 0; i < cam.buffers; i++) {
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(cam.fd, VIDIOC_QUERYBUF, &buf) != 0) {
+            std::cerr << "[ERR] VIDIOC_QUERYBUF failed: " << strerror(errno) << "\n";
+            return false;
+        }
+        void *p = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, cam.fd, buf.m.offset);
+        if (p == MAP_FAILED) {
+            std::cerr << "[ERR] camera buffer mmap failed: " << strerror(errno) << "\n";
+            return false;
+        }
+        cam.map[i] = p;
+        cam.map_len[i] = buf.length;
+        if (xioctl(cam.fd, VIDIOC_QBUF, &buf) != 0) {
+            std::cerr << "[ERR] VIDIOC_QBUF failed: " << strerror(errno) << "\n";
+            return false;
+        }
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(cam.fd, VIDIOC_STREAMON, &type) != 0) {
+        std::cerr << "[ERR] VIDIOC_STREAMON failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    cam.streaming = true;
+    return true;
+}
+
+static bool grab_v4l2(cam_capture &cam, cam_frame &frame)
+{
+    for (;;) {
+        pollfd pfd = {cam.fd, POLLIN, 0};
+        int r = poll(&pfd, 1, 2000);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            std::cerr << "[ERR] camera timeout\n";
+            return false;
+        }
+
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(cam.fd, VIDIOC_DQBUF, &buf) != 0) {
+            if (errno == EAGAIN) continue;
+            std::cerr << "[ERR] VIDIOC_DQBUF failed: " << strerror(errno) << "\n";
+            return false;
+        }
+        if (buf.flags & V4L2_BUF_FLAG_ERROR) {     // corrupted frame: hand it straight back
+            xioctl(cam.fd, VIDIOC_QBUF, &buf);
+            continue;
+        }
+
+        frame.index = buf.index;
+        frame.bytes = buf.bytesused ? buf.bytesused : cam.frame_size;
+        frame.sequence = buf.sequence;
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            frame.timestamp_us = (int64_t)buf.timestamp.tv_sec * 1000000 + buf.timestamp.tv_usec;
+        else
+            frame.timestamp_us = cam_now_us();
+        return true;
+    }
+}
+
+// ---- stand-ins ----
+
+static bool open_raw_file(cam_capture &cam, const cam_config &cfg, uint32_t fourcc)
+{
+    struct stat st;
+    cam.fourcc = fourcc;
+    cam.frame_size = frame_bytes(fourcc, cam.width, cam.height, cam.stride);
+    if (fstat(cam.fd, &st) != 0 || (size_t)st.st_size < cam.frame_size) {
+        std::cerr << "[ERR] " << cfg.path << " holds less than one " << cam.width << "x"
+                  << cam.height << " frame\n";
+        return false;
+    }
+    cam.file_size = (size_t)st.st_size;
+    cam.file_frames = cam.file_size / cam.frame_size;
+
+    // private, writable mapping: callers may draw on a frame without
+    // touching the file (pages are copied on write)
+    void *p = mmap(NULL, cam.file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, cam.fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "[ERR] " << cfg.path << " mmap failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    cam.file_map = (uint8_t *)p;
+    return true;
+}
+
+static bool open_mjpeg_file(cam_capture &cam, const cam_config &cfg)
+{
+    struct stat st;
+    cam.fourcc = V4L2_PIX_FMT_MJPEG;
+    if (fstat(cam.fd, &st) != 0 || st.st_size <= 0) {
+        std::cerr << "[ERR] " << cfg.path << " is empty\n";
+        return false;
+    }
+    cam.file_size = (size_t)st.st_size;
+    void *p = mmap(NULL, cam.file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, cam.fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "[ERR] " << cfg.path << " mmap failed: " << strerror(errno) << "\n";
+        return false;
+    }
+    cam.file_map = (uint8_t *)p;
+
+    // index the frames once; anything between them (padding) is skipped
+    size_t pos = 0;
+    while (pos + 4 <= cam.file_size) {
+        size_t n = mjpeg_frame_length(cam.file_map + pos, cam.file_size - pos);
+        if (n) {
+            cam.jpeg_offsets.push_back(pos);
+            cam.frame_size = std::max(cam.frame_size, n);
+            pos += n;
+            continue;
+        }
+        const void *next = memmem(cam.file_map + pos + 1, cam.file_size - pos - 1, "\xff\xd8\xff", 3);
+        if (!next) break;
+        pos = (const uint8_t *)next - cam.file_map;
+    }
+    cam.file_frames = cam.jpeg_offsets.size();
+    if (cam.file_frames == 0) {
+        std::cerr << "[ERR] " << cfg.path << " holds no complete JPEG frame\n";
+        return false;
+    }
+    // the geometry is whatever was recorded
+    mjpeg_decoder probe;
+    bool ok = mjpeg_decoder_init(probe);
+    const size_t first = cam.jpeg_offsets[0];
+    ok = ok && mjpeg_read_header(probe, cam.file_map + first, mjpeg_frame_length(cam.file_map + first, cam.file_size - first),
+                                 1, false, cam.width, cam.height);
+    mjpeg_decoder_free(probe);
+    if (!ok) {
+        std::cerr << "[ERR] " << cfg.path << ": cannot read the first frame\n";
+        return false;
+    }
+    return true;
+}
+
+static bool open_video_file(cam_capture &cam, const cam_config &cfg)
+{
+    close(cam.fd);
+    cam.fd = -1;
+    if (!cam.video.open(cfg.path)) {
+        std::cerr << "[ERR] cannot open " << cfg.path << " as a video file\n";
+        return false;
+    }
+    cam.fourcc = V4L2_PIX_FMT_BGR24;
+    cam.width = (int)cam.video.get(cv::CAP_PROP_FRAME_WIDTH);
+    cam.height = (int)cam.video.get(cv::CAP_PROP_FRAME_HEIGHT);
+    cam.frame_size = frame_bytes(cam.fourcc, cam.width, cam.height, cam.stride);
+    return true;
+}
+
+// Sleep until the next frame is due, like a camera would.
+static void pace(cam_capture &cam)
+{
+    if (cam.frame_interval_us <= 0) return;
+    int64_t now = cam_now_us();
+    if (cam.next_due_us > now) {
+        usleep((useconds_t)(cam.next_due_us - now));
+        now = cam.next_due_us;
+    }
+    cam.next_due_us = now + cam.frame_interval_us;
+}
+
+// Next free stand-in slot (a raw file or video stand-in still honours the
+// buffer count, so callers see the same limits as with a camera).
+static int free_slot(cam_capture &cam)
+{
+    for (int n = 0; n < cam.buffers; n++) {
+        int i = (cam.next_buf + n) % cam.buffers;
+        if (!cam.held[i]) {
+            cam.next_buf = (i + 1) % cam.buffers;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool grab_stand_in(cam_capture &cam, cam_frame &frame)
+{
+    int slot = free_slot(cam);
+    if (slot < 0) {
+        std::cerr << "[ERR] cam_grab: all " << cam.buffers << " buffers are held\n";
+        return false;
+    }
+    pace(cam);
+
+    if (cam.kind == CAM_RAW_FILE && cam.fourcc == V4L2_PIX_FMT_MJPEG) {
+        const size_t at = cam.jpeg_offsets[cam.next_frame];
+        cam.map[slot] = cam.file_map + at;
+        frame.bytes = mjpeg_frame_length(cam.file_map + at, cam.file_size - at);
+        cam.next_frame = (cam.next_frame + 1) % cam.file_frames;
+    } else if (cam.kind == CAM_RAW_FILE) {
+        cam.map[slot] = cam.file_map + cam.next_frame * cam.frame_size;
+        frame.bytes = cam.frame_size;
+        cam.next_frame = (cam.next_frame + 1) % cam.file_frames;
+    } else {
+        cv::Mat &buf = cam.video_buf[slot];
+        if (!cam.video.read(buf) || buf.empty()) {
+            // end of file: start over
+            cam.video.set(cv::CAP_PROP_POS_FRAMES, 0);
+            if (!cam.video.read(buf) || buf.empty()) return false;
+        }
+        cam.map[slot] = buf.data;
+        cam.stride = buf.step;
+        frame.bytes = buf.step * buf.rows;
+    }
+
+    frame.index = slot;
+    frame.sequence = cam.sequence;
+    frame.timestamp_us = cam_now_us();
+    return true;
+}
+
+// ---- public ----
+
+bool cam_open(cam_capture &cam, const cam_config &cfg)
+{
+    cam_reset(cam);
+    cam.width = cfg.width;
+    cam.height = cfg.height;
+    cam.outputs = cfg.outputs;
+    cam.buffers = cfg.buffers < 2 ? 2 : cfg.buffers > CAM_MAX_BUFFERS ? CAM_MAX_BUFFERS : cfg.buffers;
+    double fps = cfg.fps;
+
+    const char *env = getenv("CAM_GEOMETRY");
+    int ew, eh;
+    if (env && sscanf(env, "%dx%d", &ew, &eh) == 2) {
+        cam.width = ew;
+        cam.height = eh;
+    }
+    if ((env = getenv("CAM_FPS")) != NULL && *env) fps = atof(env);
+    if ((env = getenv("CAM_BUFFERS")) != NULL && *env) {
+        int n = atoi(env);
+        cam.buffers = n < 2 ? 2 : n > CAM_MAX_BUFFERS ? CAM_MAX_BUFFERS : n;
+    }
+
+    cam_config c = cfg;
+    if (uint32_t f = fourcc_from_env()) c.fourcc = f;
+
+    cam.fd = open(cfg.path, O_RDWR | O_NONBLOCK);
+    if (cam.fd < 0) cam.fd = open(cfg.path, O_RDONLY);
+    if (cam.fd < 0) {
+        std::cerr << "[ERR] cannot open camera " << cfg.path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat st;
+    bool ok;
+    uint32_t raw_fourcc = fourcc_from_extension(cfg.path);
+    if (fstat(cam.fd, &st) == 0 && S_ISCHR(st.st_mode)) {
+        cam.kind = CAM_V4L2;
+        ok = open_v4l2(cam, c, fps);
+    } else if (raw_fourcc == V4L2_PIX_FMT_MJPEG) {
+        cam.kind = CAM_RAW_FILE;
+        ok = open_mjpeg_file(cam, cfg);
+    } else if (raw_fourcc) {
+        cam.kind = CAM_RAW_FILE;
+        ok = open_raw_file(cam, cfg, raw_fourcc);
+    } else {
+        cam.kind = CAM_VIDEO_FILE;
+        ok = open_video_file(cam, cfg);
+    }
+    if (!ok) {
+        cam_close(cam);
+        return false;
+    }
+
+    if (cam.kind != CAM_V4L2 && fps > 0) cam.frame_interval_us = (int64_t)(1e6 / fps);
+
+    cam.coded_width = cam.width;
+    cam.coded_height = cam.height;
+    if (cam.fourcc == V4L2_PIX_FMT_MJPEG) {
+        // reduce by the long side only: that is what a letterbox scales by
+        const bool wide = cam.width >= cam.height;
+        cam.decode_denom = cfg.decode_size > 0
+            ? mjpeg_pick_denom(cam.width, cam.height, wide ? cfg.decode_size : 0, wide ? 0 : cfg.decode_size)
+            : 1;
+        // same rounding as libjpeg's output size
+        cam.width = (cam.coded_width + cam.decode_denom - 1) / cam.decode_denom;
+        cam.height = (cam.coded_height + cam.decode_denom - 1) / cam.decode_denom;
+        if ((cam.outputs & CAM_OUT_GRAY) && !mjpeg_decoder_init(cam.jpeg)) {
+            std::cerr << "[ERR] cannot create the JPEG decoder\n";
+            cam_close(cam);
+            return false;
+        }
+    }
+
+    char name[5];
+    std::cout << "[cam] " << cfg.path << ": " << cam.coded_width << "x" << cam.coded_height << " "
+              << cam_fourcc_name(cam.fourcc, name) << ", " << cam.buffers << " buffers";
+    if (cam.decode_denom > 1)
+        std::cout << ", decoded at 1/" << cam.decode_denom << " (" << cam.width << "x" << cam.height << ")";
+    std::cout << (cam.kind == CAM_V4L2 ? "" : " (stand-in)") << std::endl;
+    return true;
+}
+
+bool cam_grab(cam_capture &cam, cam_frame &frame)
+{
+    frame.index = -1;
+    bool ok = cam.kind == CAM_V4L2 ? grab_v4l2(cam, frame) : grab_stand_in(cam, frame);
+    if (!ok) return false;
+
+    cam.held[frame.index] = true;
+    cam.sequence++;
+    frame.fourcc = cam.fourcc;
+    frame.width = cam.width;
+    frame.height = cam.height;
+    frame.decode_denom = cam.decode_denom;
+
+    void *data = cam.map[frame.index];
+    switch (cam.fourcc) {
+    case V4L2_PIX_FMT_YUYV:
+        frame.image = cv::Mat(cam.height, cam.width, CV_8UC2, data, cam.stride);
+        break;
+    case V4L2_PIX_FMT_NV12:
+        frame.image = cv::Mat(cam.height * 3 / 2, cam.width, CV_8UC1, data, cam.stride);
+        break;
+    case V4L2_PIX_FMT_BGR24:
+        frame.image = cv::Mat(cam.height, cam.width, CV_8UC3, data, cam.stride);
+        break;
+    default:
+        // compressed or unknown: one row holding the whole payload
+        frame.image = cv::Mat(1, (int)frame.bytes, CV_8UC1, data);
+        break;
+    }
+
+    frame.gray.release();
+    if (cam.outputs & CAM_OUT_GRAY) {
+        cv::Mat &buf = cam.gray_buf[frame.index];
+        switch (cam.fourcc) {
+        case V4L2_PIX_FMT_NV12:
+            // the luma plane already is the grey image
+            frame.gray = cv::Mat(cam.height, cam.width, CV_8UC1, data, cam.stride);
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            buf.create(cam.height, cam.width, CV_8UC1);
+            yuv_yuyv_to_gray((const uint8_t *)data, cam.stride, buf.data, buf.step, cam.width, cam.height);
+            frame.gray = buf;
+            break;
+        case V4L2_PIX_FMT_BGR24:
+            cv::cvtColor(frame.image, buf, cv::COLOR_BGR2GRAY);
+            frame.gray = buf;
+            break;
+        case V4L2_PIX_FMT_MJPEG: {
+            // luma only: no chroma decode or colour conversion at all
+            int w, h;
+            if (mjpeg_read_header(cam.jpeg, frame.image.data, frame.bytes, cam.decode_denom, true, w, h)) {
+                buf.create(h, w, CV_8UC1);
+                if (mjpeg_decode(cam.jpeg, buf.data, buf.step)) frame.gray = buf;
+            }
+            if (frame.gray.empty())
+                std::cerr << "[WARN] corrupt MJPEG frame: " << mjpeg_error(cam.jpeg) << "\n";
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+void cam_release(cam_capture &cam, cam_frame &frame)
+{
+    if (frame.index < 0 || frame.index >= cam.buffers || !cam.held[frame.index]) return;
+
+    if (cam.kind == CAM_V4L2) {
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = frame.index;
+        if (xioctl(cam.fd, VIDIOC_QBUF, &buf) != 0)
+            std::cerr << "[WARN] VIDIOC_QBUF failed: " << strerror(errno) << "\n";
+    }
+    cam.held[frame.index] = false;
+    frame.index = -1;
+    frame.image.release();
+    frame.gray.release();
+}
+
+void cam_close(cam_capture &cam)
+{
+    if (cam.kind == CAM_V4L2) {
+        if (cam.streaming) {
+            v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            xioctl(cam.fd, VIDIOC_STREAMOFF, &type);
+        }
+        for (int i = 0; i < CAM_MAX_BUFFERS; i++)
+            if (cam.map[i]) munmap(cam.map[i], cam.map_len[i]);
+    }
+    if (cam.file_map) munmap(cam.file_map, cam.file_size);
+    mjpeg_decoder_free(cam.jpeg);
+    if (cam.video.isOpened()) cam.video.release();
+    if (cam.fd >= 0) close(cam.fd);
+    cam_reset(cam);
+}
+
+// cam_bgr() may run on any thread (capture or a worker), so each thread
+// keeps its own decoder
+struct thread_jpeg {
+    mjpeg_decoder d;
+    thread_jpeg() { mjpeg_decoder_init(d); }
+    ~thread_jpeg() { mjpeg_decoder_free(d); }
+};
+
+static bool decode_bgr(const cam_frame &frame, cv::Mat &dst)
+{
+    static thread_local thread_jpeg jpeg;
+    int w, h;
+    if (!mjpeg_read_header(jpeg.d, frame.image.data, frame.bytes, frame.decode_denom, false, w, h))
+        return false;
+    dst.create(h, w, CV_8UC3);
+    return mjpeg_decode(jpeg.d, dst.data, dst.step);
+}
+
+void cam_bgr(const cam_frame &frame, cv::Mat &dst)
+{
+    switch (frame.fourcc) {
+    case V4L2_PIX_FMT_YUYV:
+        cv::cvtColor(frame.image, dst, cv::COLOR_YUV2BGR_YUYV);
+        break;
+    case V4L2_PIX_FMT_NV12:
+        cv::cvtColor(frame.image, dst, cv::COLOR_YUV2BGR_NV12);
+        break;
+    case V4L2_PIX_FMT_BGR24:
+        frame.image.copyTo(dst);
+        break;
+    case V4L2_PIX_FMT_MJPEG:
+        if (!decode_bgr(frame, dst)) {
+            std::cerr << "[WARN] corrupt MJPEG frame dropped\n";
+            dst.release();
+        }
+        break;
+    default: {
+        static bool warned = false;
+        char name[5];
+        if (!warned) std::cerr << "[WARN] cam_bgr: no conversion for " << cam_fourcc_name(frame.fourcc, name) << "\n";
+        warned = true;
+        dst.release();
+        break;
+    }
+    }
+}
+
+bool cam_show(fb_sink &fb, fb_letterbox &lb, const cam_frame &frame, fb_rect view, const fb_rect *changed)
+{
+    const cv::Mat &img = frame.image;
+    switch (frame.fourcc) {
+    case V4L2_PIX_FMT_YUYV:
+        return fb_letterbox_yuv(fb, lb, YUV_YUYV, img.data, img.step, NULL, 0,
+                                frame.width, frame.height, view, changed);
+    case V4L2_PIX_FMT_NV12:
+        return fb_letterbox_yuv(fb, lb, YUV_NV12, img.data, img.step, img.data + img.step * frame.height,
+                                img.step, frame.width, frame.height, view, changed);
+    case V4L2_PIX_FMT_BGR24:
+        return fb_letterbox_bgr(fb, lb, img.data, img.step, frame.width, frame.height, view, changed);
+    case V4L2_PIX_FMT_MJPEG: {
+        static thread_local cv::Mat bgr;
+        cam_bgr(frame, bgr);
+        return !bgr.empty() && fb_letterbox_bgr(fb, lb, bgr.data, bgr.step, bgr.cols, bgr.rows, view, changed);
+    }
+    default:
+        return false;
+    }
+}
+
+void cam_roi_bgr(const cam_frame &frame, cv::Rect &roi, cv::Mat &bgr)
+{
+    // whole chroma blocks only, inside the frame
+    int x0 = std::max(roi.x, 0) & ~1, y0 = std::max(roi.y, 0) & ~1;
+    int x1 = std::min(roi.x + roi.width, frame.width), y1 = std::min(roi.y + roi.height, frame.height);
+    x1 = std::min(x1 + (x1 & 1), frame.width & ~1);
+    y1 = std::min(y1 + (y1 & 1), frame.height & ~1);
+    roi = cv::Rect(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+    if (roi.width == 0 || roi.height == 0 || frame.fourcc == V4L2_PIX_FMT_MJPEG) {
+        bgr.release();
+        return;
+    }
+
+    const cv::Mat &img = frame.image;
+    if (frame.fourcc == V4L2_PIX_FMT_BGR24) {
+        img(roi).copyTo(bgr);
+        return;
+    }
+    const bool nv12 = frame.fourcc == V4L2_PIX_FMT_NV12;
+    yuv_row_fn to_bgr = yuv_row_kernel(nv12 ? YUV_NV12 : YUV_YUYV, FB_FMT_RGB888);
+    bgr.create(roi.height, roi.width, CV_8UC3);
+    for (int r = 0; r < roi.height; r++) {
+        const int y = roi.y + r;
+        const uint8_t *uv = nv12 ? img.data + img.step * (frame.height + y / 2) : NULL;
+        to_bgr(img.data + img.step * y, uv, roi.x, roi.width, bgr.ptr(r));
+    }
+}
+
+void cam_roi_store(cam_frame &frame, const cv::Rect &roi, const cv::Mat &bgr)
+{
+    if (bgr.empty() || roi.width != bgr.cols || roi.height != bgr.rows) return;
+
+    cv::Mat &img = frame.image;
+    switch (frame.fourcc) {
+    case V4L2_PIX_FMT_BGR24:
+        bgr.copyTo(img(roi));
+        break;
+    case V4L2_PIX_FMT_YUYV:
+        yuv_store_bgr(YUV_YUYV, bgr.data, bgr.step, img.data, img.step, NULL, 0,
+                      roi.x, roi.y, roi.width, roi.height);
+        break;
+    case V4L2_PIX_FMT_NV12:
+        yuv_store_bgr(YUV_NV12, bgr.data, bgr.step, img.data, img.step,
+                      img.data + img.step * frame.height, img.step, roi.x, roi.y, roi.width, roi.height);
+        break;
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef CAM_CAPTURE_H
+#define CAM_CAPTURE_H
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+#include "fb_letterbox.h"
+#include "mjpeg_decode.h"
+
+// ================== Camera capture ==================
+// Shared camera input for the Lab2 / Lab3 / Lab5 programs, talking to
+// V4L2 directly instead of going through cv::VideoCapture. The driver's
+// buffers are requested with VIDIOC_REQBUFS (V4L2_MEMORY_MMAP), mapped
+// once, and handed out as borrowed cv::Mat headers: cam_grab() dequeues a
+// filled buffer (VIDIOC_DQBUF), cam_release() gives it back (VIDIOC_QBUF).
+// Nothing is copied or converted on the way; cam_bgr() does the one
+// colour conversion straight out of the driver buffer.
+//
+// cam_config::outputs tells the capture what the program's stages consume,
+// so the frame only goes through the conversions it needs:
+//   CAM_OUT_GRAY     frame.gray is filled on grab: the Y plane itself for
+//                    NV12, a SIMD de-interleave for YUYV;
+//   CAM_OUT_DISPLAY  cam_show() writes YUYV / NV12 straight into the
+//                    framebuffer format (no BGR frame in between);
+//   CAM_OUT_BGR      cam_bgr() is going to be called.
+// With fourcc 0 the capture format is picked from these: NV12 when grey is
+// wanted and the driver has it, YUYV otherwise.
+//
+// MJPEG (V4L2_PIX_FMT_MJPEG, asked for explicitly) lets USB cameras run at
+// full rate at sizes where YUYV saturates the bus. Frames arrive
+// compressed and are decoded with DCT-domain scaling (mjpeg_decode.h) to
+// the smallest 1/1, 1/2, 1/4 or 1/8 size whose long side is still at least
+// cam_config::decode_size, so a detector letterboxing to 320 gets a
+// 320x240 frame from a 640x480 camera without a full-size decode. grey
+// (CAM_OUT_GRAY), cam_bgr() and cam_show() all come out at that size.
+//
+// A frame stays valid until it is released. Up to `buffers - 1` frames may
+// be held at once; the driver needs at least one queued buffer to keep
+// capturing.
+//
+// Stand-ins, so the capture path can be run without a camera (chosen by
+// what the path points at):
+//   - a raw file (.yuyv / .yuv = YUYV, .nv12, .bgr = packed BGR24) whose
+//     geometry comes from the config. It is mmap'ed privately and frames
+//     are views straight into it, looping at the end.
+//   - a recorded MJPEG stream (.mjpg / .mjpeg: concatenated JPEG frames,
+//     as written by v4l2-ctl --stream-to); geometry comes from the first
+//     frame.
+//   - anything else that is not a character device is opened as a video
+//     file with cv::VideoCapture and delivered as BGR24 (decoded, so this
+//     one is not zero-copy).
+// Stand-ins are paced to cam_config::fps (0 = as fast as possible).
+// $CAM_DEVICE, $CAM_GEOMETRY ("WIDTHxHEIGHT"), $CAM_FORMAT ("YUYV",
+// "NV12", "MJPG"), $CAM_FPS and $CAM_BUFFERS override the program's
+// settings.
+
+#define CAM_MAX_BUFFERS 8
+
+enum cam_output {
+    CAM_OUT_BGR = 1,
+    CAM_OUT_GRAY = 2,
+    CAM_OUT_DISPLAY = 4
+};
+
+enum cam_kind {
+    CAM_V4L2,
+    CAM_RAW_FILE,
+    CAM_VIDEO_FILE
+};
+
+struct cam_config {
+    const char *path = "/dev/video2";
+    int width = 640;
+    int height = 480;
+    uint32_t fourcc = 0;                    // requested from the driver, 0 = from outputs
+    int outputs = CAM_OUT_BGR | CAM_OUT_DISPLAY;
+    int buffers = 4;                        // 2 .. CAM_MAX_BUFFERS
+    double fps = 30;                        // requested rate / stand-in pacing
+    int decode_size = 0;                    // MJPEG: long side the consumers need, 0 = full size
+};
+
+struct cam_frame {
+    cv::Mat image;              // borrowed view: CV_8UC2 (YUYV), CV_8UC1 h*3/2 rows (NV12), CV_8UC3 (BGR24),
+                                // CV_8UC1 1 x bytes (MJPEG)
+    cv::Mat gray;               // CAM_OUT_GRAY only; also valid until release
+    uint32_t fourcc;
+    int width, height;          // MJPEG: the decoded size, see decode_denom
+    int decode_denom;           // MJPEG: DCT scaling the frame is decoded with (1, 2, 4, 8)
+    size_t bytes;               // payload size (less than the buffer for MJPEG)
+    int index;                  // buffer index, -1 once released
+    uint64_t sequence;          // frame counter from the source
+    int64_t timestamp_us;       // CLOCK_MONOTONIC time the frame was captured
+};
+
+struct cam_capture {
+    cam_kind kind;
+    int fd;
+    int width, height;
+    uint32_t fourcc;            // what the source actually delivers
+    int outputs;
+    size_t stride;              // bytes per line of the first plane
+    size_t frame_size;          // bytes per frame
+    int buffers;
+    void *map[CAM_MAX_BUFFERS];
+    size_t map_len[CAM_MAX_BUFFERS];
+    bool held[CAM_MAX_BUFFERS]; // handed out and not released yet
+    cv::Mat gray_buf[CAM_MAX_BUFFERS];
+    bool streaming;
+
+    // stand-ins
+    uint8_t *file_map;          // raw file, mapped MAP_PRIVATE
+    size_t file_size;
+    size_t file_frames, next_frame;
+    cv::VideoCapture video;
+    cv::Mat video_buf[CAM_MAX_BUFFERS];
+    int next_buf;
+    std::vector<size_t> jpeg_offsets;  // .mjpg stand-in: start of every frame, plus the end
+    int64_t frame_interval_us, next_due_us;
+
+    // MJPEG
+    int coded_width, coded_height;     // size of the JPEG frames themselves
+    int decode_denom;
+    mjpeg_decoder jpeg;                // grey decode in cam_grab()
+
+    uint64_t sequence;
+};
+
+// $CAM_DEVICE if set, otherwise def.
+const char *cam_default_path(const char *def);
+
+// Open the camera or stand-in described by cfg and start streaming.
+// Returns false (and prints the reason) on failure.
+bool cam_open(cam_capture &cam, const cam_config &cfg);
+
+// Wait for the next frame. Returns false on a hard error, or when a
+// video stand-in cannot be read at all.
+bool cam_grab(cam_capture &cam, cam_frame &frame);
+
+// Give the frame's buffer back to the source. Safe to call twice.
+void cam_release(cam_capture &cam, cam_frame &frame);
+
+void cam_close(cam_capture &cam);
+
+// Convert a grabbed frame to BGR24 in dst (reusing dst's allocation).
+// dst always owns its pixels, so the frame can be released right after.
+// MJPEG frames are decoded here (with a per-thread decoder), at the
+// reduced size; dst is left empty if the frame is corrupt.
+void cam_bgr(const cam_frame &frame, cv::Mat &dst);
+
+// Scale / letterbox the frame into view on the framebuffer (see
+// fb_letterbox.h), converting YUYV / NV12 directly (MJPEG goes through
+// cam_bgr()). False for formats it cannot display.
+bool cam_show(fb_sink &fb, fb_letterbox &lb, const cam_frame &frame,
+              fb_rect view, const fb_rect *changed = NULL);
+
+// Overlay drawing on a YUV frame without converting all of it: cam_roi_bgr()
+// converts just roi (widened to even coordinates, clipped to the frame) to
+// BGR24 in bgr, and cam_roi_store() writes the drawn patch back into the
+// frame so cam_show() displays it. Not for MJPEG frames (draw on the
+// cam_bgr() result instead).
+void cam_roi_bgr(const cam_frame &frame, cv::Rect &roi, cv::Mat &bgr);
+void cam_roi_store(cam_frame &frame, const cv::Rect &roi, const cv::Mat &bgr);
+
+// CLOCK_MONOTONIC in microseconds, the clock cam_frame::timestamp_us is in
+// (for measuring how old a frame is when it reaches the screen).
+int64_t cam_now_us();
+
+// "YUYV", "NV12", ... for log messages.
+const char *cam_fourcc_name(uint32_t fourcc, char buf[5]);
+
+#endif
@@ -0,0 +1,100 @@
+#include "cam_ring.h"
+
+#include <chrono>
+#include <iostream>
+
+// give the consumer's finished frames back to the driver (capture thread,
+// lock held)
+static void requeue_returned(cam_ring &ring)
+{
+    for (int i = 0; i < ring.returned_count; i++) cam_release(*ring.cam, ring.returned[i]);
+    ring.returned_count = 0;
+}
+
+static void capture_loop(cam_ring &ring)
+{
+    while (ring.running) {
+        {
+            std::lock_guard<std::mutex> hold(ring.lock);
+            requeue_returned(ring);
+        }
+
+        cam_frame frame;
+        bool ok = cam_grab(*ring.cam, frame);
+
+        std::lock_guard<std::mutex> hold(ring.lock);
+        if (!ok) {
+            ring.failed = true;
+            ring.ready.notify_all();
+            return;
+        }
+        if (ring.count == ring.capacity) {
+            // full: the oldest frame goes straight back to the driver
+            cam_release(*ring.cam, ring.slot[ring.head]);
+            ring.head = (ring.head + 1) % ring.capacity;
+            ring.count--;
+            ring.dropped++;
+        }
+        ring.slot[(ring.head + ring.count) % ring.capacity] = frame;
+        ring.count++;
+        ring.captured++;
+        ring.ready.notify_one();
+    }
+}
+
+bool cam_ring_start(cam_ring &ring, cam_capture &cam, int capacity)
+{
+    const int most = cam.buffers - 2;
+    if (most < 1) {
+        std::cerr << "[ERR] cam_ring needs at least 3 capture buffers, the camera has " << cam.buffers << "\n";
+        return false;
+    }
+    ring.cam = &cam;
+    ring.capacity = capacity <= 0 || capacity > most ? most : capacity;
+    ring.head = ring.count = ring.returned_count = 0;
+    ring.failed = false;
+    ring.captured = ring.dropped = ring.delivered = 0;
+    ring.running = true;
+    ring.thread = std::thread(capture_loop, std::ref(ring));
+    return true;
+}
+
+bool cam_ring_latest(cam_ring &ring, cam_frame &frame, int timeout_ms)
+{
+    std::unique_lock<std::mutex> hold(ring.lock);
+    if (!ring.ready.wait_for(hold, std::chrono::milliseconds(timeout_ms),
+                             [&] { return ring.count > 0 || ring.failed; }))
+        return false;
+    if (ring.count == 0) return false;
+
+    // take the newest; everything older is stale now
+    for (int i = 0; i < ring.count - 1; i++) {
+        ring.returned[ring.returned_count++] = ring.slot[(ring.head + i) % ring.capacity];
+        ring.dropped++;
+    }
+    frame = ring.slot[(ring.head + ring.count - 1) % ring.capacity];
+    ring.head = ring.count = 0;
+    ring.delivered++;
+    return true;
+}
+
+void cam_ring_release(cam_ring &ring, cam_frame &frame)
+{
+    if (frame.index < 0) return;
+    std::lock_guard<std::mutex> hold(ring.lock);
+    ring.returned[ring.returned_count++] = frame;
+    frame.index = -1;
+    frame.image.release();
+    frame.gray.release();
+}
+
+void cam_ring_stop(cam_ring &ring)
+{
+    ring.running = false;
+    if (ring.thread.joinable()) ring.thread.join();   // at most one frame interval
+
+    std::lock_guard<std::mutex> hold(ring.lock);
+    requeue_returned(ring);
+    for (int i = 0; i < ring.count; i++) cam_release(*ring.cam, ring.slot[(ring.head + i) % ring.capacity]);
+    ring.count = 0;
+}
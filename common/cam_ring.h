@@ -0,0 +1,63 @@
+#ifndef CAM_RING_H
+#define CAM_RING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "cam_capture.h"
+
+// ================== Capture thread + frame ring ==================
+// A thread that does nothing but cam_grab(), so the driver's queue is
+// drained as fast as frames arrive no matter how slow the program is.
+// Grabbed frames (still zero-copy driver buffers) go into a fixed ring;
+// when it is full the oldest frame is given back to the driver to make
+// room (drop-oldest). Consumers always take the newest frame, and the
+// older ones still waiting are dropped with it, so what reaches the
+// program is never more than one frame interval old.
+//
+// Frames keep the capture's CLOCK_MONOTONIC timestamp_us; compare it with
+// cam_now_us() after fb_present() to get glass-to-glass latency.
+//
+// One consumer thread, holding one frame at a time: take it with
+// cam_ring_latest(), hand it back with cam_ring_release(). The capture
+// thread is the only one touching the cam_capture once started; released
+// buffers are queued back to the driver from there.
+
+struct cam_ring {
+    cam_capture *cam;
+    int capacity;                       // frames waiting at most
+    cam_frame slot[CAM_MAX_BUFFERS];    // the ring, oldest at head
+    int head, count;
+    cam_frame returned[CAM_MAX_BUFFERS];// done with, to be requeued by the thread
+    int returned_count;
+    bool failed;                        // cam_grab() failed, no more frames
+
+    std::mutex lock;
+    std::condition_variable ready;
+    std::thread thread;
+    std::atomic<bool> running;
+
+    uint64_t captured;                  // frames grabbed
+    uint64_t dropped;                   // never handed to the consumer
+    uint64_t delivered;                 // handed to the consumer
+};
+
+// Start the capture thread on an opened camera. capacity 0 = as many as
+// the camera's buffers allow (buffers - 2: one is the consumer's, one
+// stays with the driver).
+bool cam_ring_start(cam_ring &ring, cam_capture &cam, int capacity = 0);
+
+// Newest frame, waiting up to timeout_ms for one. False on timeout or once
+// the camera has failed.
+bool cam_ring_latest(cam_ring &ring, cam_frame &frame, int timeout_ms = 2000);
+
+// Done with a frame from cam_ring_latest(). Safe to call twice.
+void cam_ring_release(cam_ring &ring, cam_frame &frame);
+
+// Stop the thread and give every frame back. The consumer's frame must
+// have been released.
+void cam_ring_stop(cam_ring &ring);
+
+#endif
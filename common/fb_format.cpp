@@ -0,0 +1,38 @@
+#include "fb_format.h"
+
+static bool field_is(const fb_bitfield &f, unsigned offset, unsigned length)
+{
+    return f.offset == offset && f.length == length;
+}
+
+fb_format fb_detect_format(const fb_var_screeninfo &var)
+{
+    switch (var.bits_per_pixel) {
+    case 16:
+        if (!field_is(var.green, 5, 6)) break;
+        if (field_is(var.red, 11, 5) && field_is(var.blue, 0, 5)) return FB_FMT_RGB565;
+        if (field_is(var.red, 0, 5) && field_is(var.blue, 11, 5)) return FB_FMT_BGR565;
+        break;
+    case 24:
+        if (field_is(var.red, 16, 8) && field_is(var.green, 8, 8) && field_is(var.blue, 0, 8))
+            return FB_FMT_RGB888;
+        break;
+    case 32:
+        if (field_is(var.red, 16, 8) && field_is(var.green, 8, 8) && field_is(var.blue, 0, 8))
+            return field_is(var.transp, 24, 8) ? FB_FMT_ARGB8888 : FB_FMT_XRGB8888;
+        break;
+    }
+    return FB_FMT_UNKNOWN;
+}
+
+const char *fb_format_name(fb_format fmt)
+{
+    switch (fmt) {
+    case FB_FMT_RGB565:   return "RGB565";
+    case FB_FMT_BGR565:   return "BGR565";
+    case FB_FMT_RGB888:   return "RGB888";
+    case FB_FMT_XRGB8888: return "XRGB8888";
+    case FB_FMT_ARGB8888: return "ARGB8888";
+    default:              return "unknown";
+    }
+}
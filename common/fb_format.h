@@ -0,0 +1,28 @@
+#ifndef FB_FORMAT_H
+#define FB_FORMAT_H
+
+#include <linux/fb.h>
+
+// ================== Framebuffer pixel formats ==================
+// Names follow the DRM convention: channels listed from the most to the
+// least significant bits of the little-endian pixel word, so FB_FMT_RGB565
+// is what OpenCV calls BGR565 and FB_FMT_RGB888 / FB_FMT_XRGB8888 are
+// B,G,R(,X) in memory.
+
+enum fb_format {
+    FB_FMT_UNKNOWN = 0,
+    FB_FMT_RGB565,      // 16 bpp, red 11:5  green 5:6  blue 0:5
+    FB_FMT_BGR565,      // 16 bpp, blue 11:5 green 5:6  red 0:5
+    FB_FMT_RGB888,      // 24 bpp, red 16:8  green 8:8  blue 0:8
+    FB_FMT_XRGB8888,    // 32 bpp, as RGB888 + unused top byte
+    FB_FMT_ARGB8888,    // 32 bpp, as RGB888 + alpha 24:8 (written opaque)
+    FB_FMT_COUNT
+};
+
+// Work out the format from bits_per_pixel and the red/green/blue/transp
+// bitfields reported by FBIOGET_VSCREENINFO.
+fb_format fb_detect_format(const fb_var_screeninfo &var);
+
+const char *fb_format_name(fb_format fmt);
+
+#endif
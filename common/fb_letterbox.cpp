@@ -0,0 +1,337 @@
+#include "fb_letterbox.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include "fb_pack.h"
+
+// Where the source rows come from: packed BGR24, or YUV converted on the fly.
+struct lb_source {
+    const uint8_t *y;       // BGR24 / YUYV rows, or the NV12 luma plane
+    size_t y_step;
+    const uint8_t *uv;      // NV12 chroma plane
+    size_t uv_step;
+    yuv_row_fn to_bgr;      // NULL for a BGR24 source
+    yuv_row_fn to_fb;       // YUV straight to the framebuffer format (1:1)
+};
+
+// ---- sampling tables ----
+// Same source positions as cv::resize INTER_LINEAR: s = (d + 0.5) * scale - 0.5,
+// clamped at the borders.
+static void build_taps(int dst_n, int src_n, int step,
+                       std::vector<int> &ofs0, std::vector<int> &ofs1, std::vector<uint8_t> &alpha)
+{
+    ofs0.resize(dst_n);
+    ofs1.resize(dst_n);
+    alpha.resize(dst_n);
+
+    const double scale = (double)src_n / dst_n;
+    for (int d = 0; d < dst_n; d++) {
+        double s = (d + 0.5) * scale - 0.5;
+        int s0 = (int)floor(s);
+        double f = s - s0;
+        if (s0 < 0) {
+            s0 = 0;
+            f = 0.0;
+        }
+        if (s0 >= src_n - 1) {
+            s0 = src_n - 1;
+            f = 0.0;
+        }
+        int s1 = std::min(s0 + 1, src_n - 1);
+
+        ofs0[d] = s0 * step;
+        ofs1[d] = s1 * step;
+        alpha[d] = (uint8_t)lround(f * 128.0);
+    }
+}
+
+// Horizontal pass for one source row, view columns [c0, c1), into planar
+// B|G|R Q7 values (0..32640).
+static void hfilter_row(const fb_letterbox &lb, const uint8_t *row, int c0, int c1, uint16_t *out)
+{
+    const int w = lb.view.w;
+    uint16_t *ob = out, *og = out + w, *orr = out + 2 * w;
+
+    if (lb.src_w == w) {
+        // 1:1 (plain format conversion): just split the channels
+        for (int c = c0; c < c1; c++) {
+            const uint8_t *p = row + 3 * c;
+            ob[c]  = (uint16_t)(p[0] << 7);
+            og[c]  = (uint16_t)(p[1] << 7);
+            orr[c] = (uint16_t)(p[2] << 7);
+        }
+        return;
+    }
+
+    for (int c = c0; c < c1; c++) {
+        const uint8_t *p0 = row + lb.xofs0[c];
+        const uint8_t *p1 = row + lb.xofs1[c];
+        const int a = lb.xalpha[c], ia = 128 - a;
+        ob[c]  = (uint16_t)(p0[0] * ia + p1[0] * a);
+        og[c]  = (uint16_t)(p0[1] * ia + p1[1] * a);
+        orr[c] = (uint16_t)(p0[2] * ia + p1[2] * a);
+    }
+}
+
+// ---- vertical blend + pack ----
+// v = (h0 * w0 + h1 * w1 + 2^13) >> 14, w0 + w1 = 128, result 0..255
+
+#if defined(FB_SIMD_SSE2)
+static inline __m128i vblend_sse2(const uint16_t *p0, const uint16_t *p1, __m128i w, __m128i rnd)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)p0);
+    __m128i b = _mm_loadu_si128((const __m128i *)p1);
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w);
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, rnd), 14);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, rnd), 14);
+    return _mm_packs_epi32(lo, hi);
+}
+#endif
+
+#if defined(FB_SIMD_AVX2)
+static inline __m256i vblend_avx2(const uint16_t *p0, const uint16_t *p1, __m256i w, __m256i rnd)
+{
+    // unpack and pack both work per 128-bit lane, so lane order comes back intact
+    __m256i a = _mm256_loadu_si256((const __m256i *)p0);
+    __m256i b = _mm256_loadu_si256((const __m256i *)p1);
+    __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w);
+    __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w);
+    lo = _mm256_srai_epi32(_mm256_add_epi32(lo, rnd), 14);
+    hi = _mm256_srai_epi32(_mm256_add_epi32(hi, rnd), 14);
+    return _mm256_packs_epi32(lo, hi);
+}
+#endif
+
+#if defined(FB_SIMD_NEON)
+static inline uint16x8_t vblend_neon(const uint16_t *p0, const uint16_t *p1, uint16_t w0, uint16_t w1)
+{
+    uint16x8_t a = vld1q_u16(p0), b = vld1q_u16(p1);
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(a), w0);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(a), w0);
+    lo = vmlal_n_u16(lo, vget_low_u16(b), w1);
+    hi = vmlal_n_u16(hi, vget_high_u16(b), w1);
+    return vcombine_u16(vrshrn_n_u32(lo, 14), vrshrn_n_u32(hi, 14));
+}
+#endif
+
+// One output row: blend the two cached planar rows (plane = distance
+// between the B, G and R planes) and store n pixels of format F.
+template <fb_format F>
+static void vblend_pack(const uint16_t *h0, const uint16_t *h1, int plane, int w1, uint8_t *dst, int n)
+{
+    typedef fb_pack<F> P;
+    const uint16_t *b0 = h0, *g0 = h0 + plane, *r0 = h0 + 2 * plane;
+    const uint16_t *b1 = h1, *g1 = h1 + plane, *r1 = h1 + 2 * plane;
+    const int w0 = 128 - w1;
+    int i = 0;
+
+#if defined(FB_SIMD_AVX2)
+    const __m256i w = _mm256_set1_epi32((w1 << 16) | w0);
+    const __m256i rnd = _mm256_set1_epi32(1 << 13);
+    for (; i + 16 <= n; i += 16)
+        P::put16(dst + i * P::bytes,
+                 vblend_avx2(b0 + i, b1 + i, w, rnd),
+                 vblend_avx2(g0 + i, g1 + i, w, rnd),
+                 vblend_avx2(r0 + i, r1 + i, w, rnd));
+#endif
+
+#if defined(FB_SIMD_SSE2)
+    const __m128i w4 = _mm_set1_epi32((w1 << 16) | w0);
+    const __m128i rnd4 = _mm_set1_epi32(1 << 13);
+    for (; i + 8 <= n; i += 8)
+        P::put8(dst + i * P::bytes,
+                vblend_sse2(b0 + i, b1 + i, w4, rnd4),
+                vblend_sse2(g0 + i, g1 + i, w4, rnd4),
+                vblend_sse2(r0 + i, r1 + i, w4, rnd4));
+#endif
+
+#if defined(FB_SIMD_NEON)
+    for (; i + 8 <= n; i += 8)
+        P::put8(dst + i * P::bytes,
+                vblend_neon(b0 + i, b1 + i, (uint16_t)w0, (uint16_t)w1),
+                vblend_neon(g0 + i, g1 + i, (uint16_t)w0, (uint16_t)w1),
+                vblend_neon(r0 + i, r1 + i, (uint16_t)w0, (uint16_t)w1));
+#endif
+
+    for (; i < n; i++) {
+        int b = (b0[i] * w0 + b1[i] * w1 + (1 << 13)) >> 14;
+        int g = (g0[i] * w0 + g1[i] * w1 + (1 << 13)) >> 14;
+        int r = (r0[i] * w0 + r1[i] * w1 + (1 << 13)) >> 14;
+        P::put(dst + i * P::bytes, b, g, r);
+    }
+}
+
+// one specialisation per format, picked once per geometry / format change
+static const fb_row_kernel row_kernels[FB_FMT_COUNT] = {
+    NULL,
+    &vblend_pack<FB_FMT_RGB565>,
+    &vblend_pack<FB_FMT_BGR565>,
+    &vblend_pack<FB_FMT_RGB888>,
+    &vblend_pack<FB_FMT_XRGB8888>,
+    &vblend_pack<FB_FMT_ARGB8888>,
+};
+
+// Fill n pixels with opaque black.
+static void fill_black(const fb_sink &fb, uint8_t *dst, int n)
+{
+    if (fb.format == FB_FMT_ARGB8888) {
+        const uint32_t black = 0xff000000u;
+        for (int i = 0; i < n; i++) memcpy(dst + 4 * i, &black, 4);
+    } else {
+        memset(dst, 0, (size_t)n * fb.bytes_per_pixel);
+    }
+}
+
+// Black out the part of r that lies outside the picture.
+static void paint_bars(fb_sink &fb, fb_rect r, fb_rect vis)
+{
+    const int bpp = (int)fb.bytes_per_pixel;
+    const int vx1 = vis.x + vis.w, vy1 = vis.y + vis.h;
+    const int rx1 = r.x + r.w;
+    const bool no_pic = vis.w <= 0 || vis.h <= 0;
+
+    for (int y = r.y; y < r.y + r.h; y++) {
+        uint8_t *row = fb_row(fb, y);
+        if (no_pic || y < vis.y || y >= vy1) {
+            fill_black(fb, row + (size_t)r.x * bpp, r.w);
+            fb.bytes_frame += (size_t)r.w * bpp;
+            continue;
+        }
+        if (r.x < vis.x) {
+            int n = std::min(rx1, vis.x) - r.x;
+            fill_black(fb, row + (size_t)r.x * bpp, n);
+            fb.bytes_frame += (size_t)n * bpp;
+        }
+        if (rx1 > vx1) {
+            int x = std::max(r.x, vx1);
+            fill_black(fb, row + (size_t)x * bpp, rx1 - x);
+            fb.bytes_frame += (size_t)(rx1 - x) * bpp;
+        }
+    }
+}
+
+// Source row sy for view columns [c0, c1). A YUV row is converted to BGR24
+// first, only over the source columns those view columns sample.
+static const uint8_t *source_row(fb_letterbox &lb, const lb_source &src, int sy, int c0, int c1)
+{
+    const uint8_t *row = src.y + (size_t)sy * src.y_step;
+    if (!src.to_bgr) return row;
+
+    const int sx0 = lb.xofs0[c0] / 3, sx1 = lb.xofs1[c1 - 1] / 3 + 1;
+    const uint8_t *uv = src.uv ? src.uv + (size_t)(sy / 2) * src.uv_step : NULL;
+    src.to_bgr(row, uv, sx0, sx1 - sx0, lb.src_row.data() + 3 * sx0);
+    return lb.src_row.data();
+}
+
+// Scale + pack the screen rectangle part (inside the view) from src.
+static void render_part(fb_sink &fb, fb_letterbox &lb, const lb_source &src, fb_rect part)
+{
+    const fb_rect &view = lb.view;
+    const int c0 = part.x - view.x, c1 = c0 + part.w;
+    const int w = view.w;
+    lb.hrow_y[0] = lb.hrow_y[1] = -1;   // cached rows only cover [c0, c1)
+
+    if (src.to_fb && lb.src_w == view.w && lb.src_h == view.h) {
+        // 1:1 from YUV: one pass per row, no intermediate at all
+        for (int y = part.y; y < part.y + part.h; y++) {
+            const int r = y - view.y;
+            const uint8_t *uv = src.uv ? src.uv + (size_t)(r / 2) * src.uv_step : NULL;
+            src.to_fb(src.y + (size_t)r * src.y_step, uv, c0, part.w,
+                      fb_row(fb, y) + (size_t)part.x * fb.bytes_per_pixel);
+        }
+        fb.bytes_frame += (size_t)part.w * part.h * fb.bytes_per_pixel;
+        return;
+    }
+
+    for (int y = part.y; y < part.y + part.h; y++) {
+        const int r = y - view.y;
+        const int sy0 = lb.yofs0[r], sy1 = lb.yofs1[r];
+
+        // keep slot 0 = sy0, slot 1 = sy1; moving down usually reuses one row
+        if (lb.hrow_y[0] != sy0) {
+            if (lb.hrow_y[1] == sy0) {
+                lb.hrow[0].swap(lb.hrow[1]);
+                std::swap(lb.hrow_y[0], lb.hrow_y[1]);
+            } else {
+                hfilter_row(lb, source_row(lb, src, sy0, c0, c1), c0, c1, lb.hrow[0].data());
+                lb.hrow_y[0] = sy0;
+            }
+        }
+        if (lb.hrow_y[1] != sy1) {
+            hfilter_row(lb, source_row(lb, src, sy1, c0, c1), c0, c1, lb.hrow[1].data());
+            lb.hrow_y[1] = sy1;
+        }
+
+        uint8_t *dst = fb_row(fb, y) + (size_t)part.x * fb.bytes_per_pixel;
+        lb.kernel(lb.hrow[0].data() + c0, lb.hrow[1].data() + c0, w, lb.yalpha[r], dst, part.w);
+    }
+    fb.bytes_frame += (size_t)part.w * part.h * fb.bytes_per_pixel;
+}
+
+static bool letterbox(fb_sink &fb, fb_letterbox &lb, const lb_source &src, int src_w, int src_h,
+                      fb_rect view, const fb_rect *changed)
+{
+    if (fb.format == FB_FMT_UNKNOWN) {
+        static bool warned = false;
+        if (!warned) std::cerr << "[WARN] fb_letterbox: unsupported framebuffer pixel format ("
+                               << fb.bits_per_pixel << " bpp)\n";
+        warned = true;
+        return false;
+    }
+    if (src_w <= 0 || src_h <= 0 || view.w <= 0 || view.h <= 0) return false;
+
+    const fb_rect screen = {0, 0, (int)fb.width, (int)fb.height};
+
+    if (src_w != lb.src_w || src_h != lb.src_h || fb.format != lb.format ||
+        view.x != lb.view.x || view.y != lb.view.y || view.w != lb.view.w || view.h != lb.view.h) {
+        lb.format = fb.format;
+        lb.kernel = row_kernels[fb.format];
+        lb.src_w = src_w;
+        lb.src_h = src_h;
+        lb.view = view;
+        build_taps(view.w, src_w, 3, lb.xofs0, lb.xofs1, lb.xalpha);
+        build_taps(view.h, src_h, 1, lb.yofs0, lb.yofs1, lb.yalpha);
+        lb.hrow[0].assign((size_t)view.w * 3, 0);
+        lb.hrow[1].assign((size_t)view.w * 3, 0);
+        lb.src_row.clear();
+        fb_damage(fb, screen);      // bars moved: repaint everything
+    }
+
+    if (src.to_bgr && lb.src_row.empty()) lb.src_row.assign((size_t)src_w * 3, 0);
+
+    const fb_rect vis = fb_rect_and(view, screen);
+    fb_damage(fb, changed ? fb_rect_and(*changed, vis) : vis);
+
+    // only what changed here, or in the frames this buffer missed
+    fb_damage_list region;
+    fb_repaint_region(fb, region);
+
+    for (int i = 0; i < region.count; i++) {
+        const fb_rect r = region.rect[i];
+        paint_bars(fb, r, vis);
+        const fb_rect part = fb_rect_and(r, vis);
+        if (part.w > 0 && part.h > 0)
+            render_part(fb, lb, src, part);
+    }
+    return true;
+}
+
+bool fb_letterbox_bgr(fb_sink &fb, fb_letterbox &lb,
+                      const uint8_t *src, size_t src_step, int src_w, int src_h,
+                      fb_rect view, const fb_rect *changed)
+{
+    lb_source s = {src, src_step, NULL, 0, NULL, NULL};
+    return letterbox(fb, lb, s, src_w, src_h, view, changed);
+}
+
+bool fb_letterbox_yuv(fb_sink &fb, fb_letterbox &lb, yuv_layout layout,
+                      const uint8_t *y, size_t y_step, const uint8_t *uv, size_t uv_step,
+                      int src_w, int src_h, fb_rect view, const fb_rect *changed)
+{
+    lb_source s = {y, y_step, layout == YUV_NV12 ? uv : NULL, uv_step,
+                   yuv_row_kernel(layout, FB_FMT_RGB888), yuv_row_kernel(layout, fb.format)};
+    return letterbox(fb, lb, s, src_w, src_h, view, changed);
+}
@@ -0,0 +1,72 @@
+#ifndef FB_LETTERBOX_H
+#define FB_LETTERBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "fb_sink.h"
+#include "yuv_convert.h"
+
+// Blends two planar filtered rows (B, G, R planes `plane` apart) with
+// weight w1 (Q7) for the second and stores n pixels.
+typedef void (*fb_row_kernel)(const uint16_t *h0, const uint16_t *h1, int plane, int w1,
+                              uint8_t *dst, int n);
+
+// ================== Fused letterbox output ==================
+// Replaces cv::resize -> black canvas -> copyTo -> cvtColor(BGR2BGR565) ->
+// blit with a single pass: a BGR888 image is scaled (bilinear, same sample
+// positions as cv::resize INTER_LINEAR), packed to the framebuffer's own
+// pixel format and stored straight into the back buffer. No full-frame
+// temporaries. Passing a view the size of the source turns it into a plain
+// BGR888 -> framebuffer format conversion.
+//
+// Each format (see fb_format.h) has its own compile-time specialised row
+// kernel; the one matching fb.format is looked up once per geometry change,
+// so the per-pixel loop has no format branches.
+//
+// Only the sink's repaint region is written (see fb_sink.h): the black
+// bars once per buffer after the geometry changes, then just the picture,
+// or only the part of it the caller says changed. The vertical blend and
+// pack is vectorised with NEON, AVX2 or SSE2, whichever the compiler
+// targets (-mfpu=neon / -mavx2 / default on x86_64), with a scalar fallback.
+// Defining FB_NO_SIMD forces the scalar path.
+
+struct fb_letterbox {
+    fb_format format = FB_FMT_UNKNOWN;
+    fb_row_kernel kernel = NULL;
+    int src_w = 0, src_h = 0;
+    fb_rect view = fb_rect{0, 0, 0, 0};    // where the picture goes on screen
+
+    // per view column / row: the two source taps and the weight of the
+    // second one (Q7)
+    std::vector<int> xofs0, xofs1;
+    std::vector<uint8_t> xalpha;
+    std::vector<int> yofs0, yofs1;
+    std::vector<uint8_t> yalpha;
+
+    // two horizontally filtered source rows, planar B|G|R, Q7
+    std::vector<uint16_t> hrow[2];
+    int hrow_y[2] = {-1, -1};
+
+    std::vector<uint8_t> src_row;   // one YUV source row as BGR24 (scaled YUV input)
+};
+
+// Scale src (BGR888, src_step bytes per row) into view on the back buffer
+// and make sure everything else on screen is black. The view may extend
+// past the screen; it is clipped. changed (screen coordinates) limits the
+// update to the part of the picture that differs from the last call; NULL
+// means all of it. Returns false if the framebuffer format is unknown.
+bool fb_letterbox_bgr(fb_sink &fb, fb_letterbox &lb,
+                      const uint8_t *src, size_t src_step, int src_w, int src_h,
+                      fb_rect view, const fb_rect *changed = NULL);
+
+// Same for a YUYV or NV12 camera buffer (see yuv_convert.h): y / y_step is
+// the packed or luma plane, uv / uv_step the NV12 chroma plane (ignored for
+// YUYV). At 1:1 each row goes from YUV straight into the framebuffer
+// format; when scaling, only the source rows and columns that are sampled
+// get converted, one row at a time.
+bool fb_letterbox_yuv(fb_sink &fb, fb_letterbox &lb, yuv_layout layout,
+                      const uint8_t *y, size_t y_step, const uint8_t *uv, size_t uv_step,
+                      int src_w, int src_h, fb_rect view, const fb_rect *changed = NULL);
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef FB_PACK_H
+#define FB_PACK_H
+
+#include <stdint.h>
+#include <string.h>
+#include "fb_format.h"
+
+// ================== Pixel packing (internal) ==================
+// Shared by the common/ kernels that produce framebuffer pixels.
+// fb_pack<F> stores B, G, R values (0..255) as format F: put() for one
+// pixel, put8() / put16() for a vector of 16-bit lanes. The SIMD flavour
+// is fixed at compile time (NEON, AVX2 (+SSE2 tails) or SSE2); defining
+// FB_NO_SIMD leaves only the scalar code.
+
+#if !defined(FB_NO_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FB_SIMD_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define FB_SIMD_AVX2 1
+#define FB_SIMD_SSE2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FB_SIMD_SSE2 1
+#endif
+#endif
+
+template <fb_format F> struct fb_pack;
+
+// ---- 16 bpp: hi:5 mid:6 lo:5 ----
+
+static inline uint16_t fb_565(int hi, int mid, int lo)
+{
+    return (uint16_t)(((hi >> 3) << 11) | ((mid >> 2) << 5) | (lo >> 3));
+}
+
+#if defined(FB_SIMD_SSE2)
+static inline __m128i fb_565_sse2(__m128i hi, __m128i mid, __m128i lo)
+{
+    return _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(hi, 3), 11),
+           _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(mid, 2), 5),
+                        _mm_srli_epi16(lo, 3)));
+}
+#endif
+#if defined(FB_SIMD_AVX2)
+static inline __m256i fb_565_avx2(__m256i hi, __m256i mid, __m256i lo)
+{
+    return _mm256_or_si256(_mm256_slli_epi16(_mm256_srli_epi16(hi, 3), 11),
+           _mm256_or_si256(_mm256_slli_epi16(_mm256_srli_epi16(mid, 2), 5),
+                           _mm256_srli_epi16(lo, 3)));
+}
+#endif
+#if defined(FB_SIMD_NEON)
+static inline uint16x8_t fb_565_neon(uint16x8_t hi, uint16x8_t mid, uint16x8_t lo)
+{
+    return vorrq_u16(vshlq_n_u16(vshrq_n_u16(hi, 3), 11),
+           vorrq_u16(vshlq_n_u16(vshrq_n_u16(mid, 2), 5),
+                     vshrq_n_u16(lo, 3)));
+}
+#endif
+
+template <> struct fb_pack<FB_FMT_RGB565> {
+    enum { bytes = 2 };
+    static inline void put(uint8_t *d, int b, int g, int r)
+    {
+        uint16_t v = fb_565(r, g, b);
+        memcpy(d, &v, 2);
+    }
+#if defined(FB_SIMD_SSE2)
+    static inline void put8(uint8_t *d, __m128i b, __m128i g, __m128i r)
+    {
+        _mm_storeu_si128((__m128i *)d, fb_565_sse2(r, g, b));
+    }
+#endif
+#if defined(FB_SIMD_AVX2)
+    static inline void put16(uint8_t *d, __m256i b, __m256i g, __m256i r)
+    {
+        _mm256_storeu_si256((__m256i *)d, fb_565_avx2(r, g, b));
+    }
+#endif
+#if defined(FB_SIMD_NEON)
+    static inline void put8(uint8_t *d, uint16x8_t b, uint16x8_t g, uint16x8_t r)
+    {
+        vst1q_u8(d, vreinterpretq_u8_u16(fb_565_neon(r, g, b)));
+    }
+#endif
+};
+
+template <> struct fb_pack<FB_FMT_BGR565> {
+    enum { bytes = 2 };
+    static inline void put(uint8_t *d, int b, int g, int r)
+    {
+        uint16_t v = fb_565(b, g, r);
+        memcpy(d, &v, 2);
+    }
+#if defined(FB_SIMD_SSE2)
+    static inline void put8(uint8_t *d, __m128i b, __m128i g, __m128i r)
+    {
+        _mm_storeu_si128((__m128i *)d, fb_565_sse2(b, g, r));
+    }
+#endif
+#if defined(FB_SIMD_AVX2)
+    static inline void put16(uint8_t *d, __m256i b, __m256i g, __m256i r)
+    {
+        _mm256_storeu_si256((__m256i *)d, fb_565_avx2(b, g, r));
+    }
+#endif
+#if defined(FB_SIMD_NEON)
+    static inline void put8(uint8_t *d, uint16x8_t b, uint16x8_t g, uint16x8_t r)
+    {
+        vst1q_u8(d, vreinterpretq_u8_u16(fb_565_neon(b, g, r)));
+    }
+#endif
+};
+
+// ---- 24 bpp: B, G, R bytes ----
+// x86 has no cheap 3-way interleave before SSSE3, so the vector variants
+// hand the blended lanes to the scalar store.
+
+template <> struct fb_pack<FB_FMT_RGB888> {
+    enum { bytes = 3 };
+    static inline void put(uint8_t *d, int b, int g, int r)
+    {
+        d[0] = (uint8_t)b;
+        d[1] = (uint8_t)g;
+        d[2] = (uint8_t)r;
+    }
+#if defined(FB_SIMD_SSE2)
+    static inline void put8(uint8_t *d, __m128i b, __m128i g, __m128i r)
+    {
+        uint16_t tb[8], tg[8], tr[8];
+        _mm_storeu_si128((__m128i *)tb, b);
+        _mm_storeu_si128((__m128i *)tg, g);
+        _mm_storeu_si128((__m128i *)tr, r);
+        for (int i = 0; i < 8; i++) put(d + 3 * i, tb[i], tg[i], tr[i]);
+    }
+#endif
+#if defined(FB_SIMD_AVX2)
+    static inline void put16(uint8_t *d, __m256i b, __m256i g, __m256i r)
+    {
+        uint16_t tb[16], tg[16], tr[16];
+        _mm256_storeu_si256((__m256i *)tb, b);
+        _mm256_storeu_si256((__m256i *)tg, g);
+        _mm256_storeu_si256((__m256i *)tr, r);
+        for (int i = 0; i < 16; i++) put(d + 3 * i, tb[i], tg[i], tr[i]);
+    }
+#endif
+#if defined(FB_SIMD_NEON)
+    static inline void put8(uint8_t *d, uint16x8_t b, uint16x8_t g, uint16x8_t r)
+    {
+        uint8x8x3_t px;
+        px.val[0] = vmovn_u16(b);
+        px.val[1] = vmovn_u16(g);
+        px.val[2] = vmovn_u16(r);
+        vst3_u8(d, px);
+    }
+#endif
+};
+
+// ---- 32 bpp: B, G, R, A bytes (A = 0 for XRGB, 0xff for ARGB) ----
+
+template <int A> struct fb_pack_8888 {
+    enum { bytes = 4 };
+    static inline void put(uint8_t *d, int b, int g, int r)
+    {
+        d[0] = (uint8_t)b;
+        d[1] = (uint8_t)g;
+        d[2] = (uint8_t)r;
+        d[3] = (uint8_t)A;
+    }
+#if defined(FB_SIMD_SSE2)
+    static inline void put8(uint8_t *d, __m128i b, __m128i g, __m128i r)
+    {
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i ra = _mm_or_si128(r, _mm_set1_epi16((short)(A << 8)));
+        _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(d + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+#endif
+#if defined(FB_SIMD_AVX2)
+    static inline void put16(uint8_t *d, __m256i b, __m256i g, __m256i r)
+    {
+        __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+        __m256i ra = _mm256_or_si256(r, _mm256_set1_epi16((short)(A << 8)));
+        // unpack works per 128-bit lane: lo = px 0-3 | 8-11, hi = 4-7 | 12-15
+        __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+        __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+        _mm256_storeu_si256((__m256i *)d, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(d + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+#endif
+#if defined(FB_SIMD_NEON)
+    static inline void put8(uint8_t *d, uint16x8_t b, uint16x8_t g, uint16x8_t r)
+    {
+        uint8x8x4_t px;
+        px.val[0] = vmovn_u16(b);
+        px.val[1] = vmovn_u16(g);
+        px.val[2] = vmovn_u16(r);
+        px.val[3] = vdup_n_u8((uint8_t)A);
+        vst4_u8(d, px);
+    }
+#endif
+};
+
+template <> struct fb_pack<FB_FMT_XRGB8888> : fb_pack_8888<0> {};
+template <> struct fb_pack<FB_FMT_ARGB8888> : fb_pack_8888<0xff> {};
+
+#endif
@@ -0,0 +1,383 @@
+#include "fb_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+static void fb_reset(fb_sink &fb)
+{
+    memset(&fb, 0, sizeof(fb));
+    fb.fd = -1;
+    fb.map = NULL;
+    fb.buffers = 1;
+}
+
+const char *fb_default_path()
+{
+    const char *env = getenv("FB_DEVICE");
+    return (env && *env) ? env : "/dev/fb0";
+}
+
+// Fill in a fb_var_screeninfo the way a driver would for a packed
+// little-endian BGR565 / RGB888 / XRGB8888 surface.
+static void fake_screeninfo(fb_var_screeninfo &var, uint32_t w, uint32_t h, uint32_t bpp)
+{
+    memset(&var, 0, sizeof(var));
+    var.xres = var.xres_virtual = w;
+    var.yres = var.yres_virtual = h;
+    var.bits_per_pixel = bpp;
+
+    if (bpp == 16) {
+        var.red.offset = 11;   var.red.length = 5;
+        var.green.offset = 5;  var.green.length = 6;
+        var.blue.offset = 0;   var.blue.length = 5;
+    } else {
+        var.red.offset = 16;   var.red.length = 8;
+        var.green.offset = 8;  var.green.length = 8;
+        var.blue.offset = 0;   var.blue.length = 8;
+    }
+}
+
+static void geometry_from_env(uint32_t &w, uint32_t &h, uint32_t &bpp)
+{
+    const char *env = getenv("FB_GEOMETRY");
+    unsigned ew, eh, ebpp;
+    if (env && sscanf(env, "%ux%ux%u", &ew, &eh, &ebpp) == 3) {
+        w = ew;
+        h = eh;
+        bpp = ebpp;
+    }
+}
+
+bool fb_sink_open_fd(fb_sink &fb, int fd, uint32_t width, uint32_t height, uint32_t bpp)
+{
+    fb_reset(fb);
+    if (fd < 0) return false;
+    fb.fd = fd;
+
+    fb_fix_screeninfo fix;
+    memset(&fix, 0, sizeof(fix));
+
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &fb.var) == 0 &&
+        ioctl(fd, FBIOGET_FSCREENINFO, &fix) == 0) {
+        fb.is_device = true;
+        fb.line_length = fix.line_length;
+        fb.map_size = fix.smem_len;
+    } else {
+        // Not a framebuffer: treat it as a plain memory surface.
+        if (width == 0 || height == 0 || (bpp != 16 && bpp != 24 && bpp != 32)) {
+            std::cerr << "[ERR] fb stand-in needs a WIDTHxHEIGHTxBPP geometry (bpp 16/24/32)\n";
+            fb_sink_close(fb);
+            return false;
+        }
+        fake_screeninfo(fb.var, width, height, bpp);
+        fb.is_device = false;
+        fb.line_length = width * (bpp / 8);
+        fb.map_size = (size_t)fb.line_length * height;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size < fb.map_size &&
+            ftruncate(fd, (off_t)fb.map_size) != 0) {
+            std::cerr << "[ERR] fb stand-in resize failed: " << strerror(errno) << "\n";
+            fb_sink_close(fb);
+            return false;
+        }
+    }
+
+    fb.width = fb.var.xres;
+    fb.height = fb.var.yres;
+    fb.bits_per_pixel = fb.var.bits_per_pixel;
+    fb.bytes_per_pixel = fb.bits_per_pixel / 8;
+    fb.format = fb_detect_format(fb.var);
+    if (fb.line_length == 0)
+        fb.line_length = fb.var.xres_virtual * fb.bytes_per_pixel;
+    if (fb.map_size == 0)
+        fb.map_size = (size_t)fb.line_length * fb.var.yres_virtual;
+
+    void *p = mmap(NULL, fb.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "[ERR] framebuffer mmap failed: " << strerror(errno) << "\n";
+        fb_sink_close(fb);
+        return false;
+    }
+    fb.map = (uint8_t *)p;
+
+    // single buffer: draw into whatever part of yres_virtual is on screen
+    if (fb.height && fb.var.yoffset % fb.height == 0 &&
+        (size_t)(fb.var.yoffset + fb.height) * fb.line_length <= fb.map_size)
+        fb.back = fb.var.yoffset / fb.height;
+    return true;
+}
+
+bool fb_sink_open(fb_sink &fb, const char *path)
+{
+    fb_reset(fb);
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        std::cerr << "[ERR] cannot open framebuffer " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    uint32_t w = 1920, h = 1080, bpp = 16;
+    geometry_from_env(w, h, bpp);
+    return fb_sink_open_fd(fb, fd, w, h, bpp);
+}
+
+static fb_rect screen_rect(const fb_sink &fb)
+{
+    fb_rect r = {0, 0, (int)fb.width, (int)fb.height};
+    return r;
+}
+
+// The new buffers hold garbage: pretend the whole screen changed in every
+// frame they remember.
+static void damage_all_buffers(fb_sink &fb)
+{
+    for (int k = 0; k < FB_MAX_BUFFERS - 1; k++) {
+        fb.history[k].count = 1;
+        fb.history[k].rect[0] = screen_rect(fb);
+    }
+}
+
+void fb_damage_add(fb_damage_list &list, fb_rect r)
+{
+    if (r.w <= 0 || r.h <= 0) return;
+
+    int n = 0;
+    for (int i = 0; i < list.count; i++) {
+        const fb_rect &o = list.rect[i];
+        if (o.x <= r.x && o.y <= r.y && o.x + o.w >= r.x + r.w && o.y + o.h >= r.y + r.h)
+            return;     // already covered
+        bool covered = r.x <= o.x && r.y <= o.y && r.x + r.w >= o.x + o.w && r.y + r.h >= o.y + o.h;
+        if (!covered) list.rect[n++] = o;
+    }
+    list.count = n;
+
+    if (list.count == FB_MAX_DAMAGE) {
+        // out of slots: collapse everything into one bounding box
+        int x0 = r.x, y0 = r.y, x1 = r.x + r.w, y1 = r.y + r.h;
+        for (int i = 0; i < list.count; i++) {
+            const fb_rect &o = list.rect[i];
+            if (o.x < x0) x0 = o.x;
+            if (o.y < y0) y0 = o.y;
+            if (o.x + o.w > x1) x1 = o.x + o.w;
+            if (o.y + o.h > y1) y1 = o.y + o.h;
+        }
+        fb_rect box = {x0, y0, x1 - x0, y1 - y0};
+        list.count = 1;
+        list.rect[0] = box;
+        return;
+    }
+    list.rect[list.count++] = r;
+}
+
+void fb_damage(fb_sink &fb, fb_rect r)
+{
+    fb_damage_add(fb.damage, fb_rect_and(r, screen_rect(fb)));
+}
+
+void fb_repaint_region(const fb_sink &fb, fb_damage_list &out)
+{
+    out = fb.damage;
+    // a buffer is rewritten every `buffers` frames; it missed the damage of
+    // the buffers-1 frames drawn in between
+    for (int k = 0; k < fb.buffers - 1; k++)
+        for (int i = 0; i < fb.history[k].count; i++)
+            fb_damage_add(out, fb.history[k].rect[i]);
+}
+
+bool fb_enable_flip(fb_sink &fb, int buffers)
+{
+    if (buffers < 2) buffers = 2;
+    if (buffers > 3) buffers = 3;
+    const uint32_t need = fb.height * buffers;
+    const size_t need_bytes = (size_t)fb.line_length * need;
+
+    if (!fb.is_device) {
+        // stand-in: just make the file tall enough, panning is bookkeeping only
+        if (need_bytes > fb.map_size) {
+            if (ftruncate(fb.fd, (off_t)need_bytes) != 0) {
+                std::cerr << "[WARN] fb stand-in resize failed, single buffer\n";
+                return false;
+            }
+            void *p = mmap(NULL, need_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fb.fd, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "[WARN] fb stand-in remap failed, single buffer\n";
+                return false;
+            }
+            munmap(fb.map, fb.map_size);
+            fb.map = (uint8_t *)p;
+            fb.map_size = need_bytes;
+        }
+        fb.var.yres_virtual = need;
+        fb.buffers = buffers;
+        fb.back = 1;
+        damage_all_buffers(fb);
+        return true;
+    }
+
+    // the mapping can't grow: don't touch the mode if the buffers can't fit
+    if (need_bytes > fb.map_size) {
+        std::cerr << "[WARN] not enough video memory for " << buffers << " buffers, single buffer\n";
+        return false;
+    }
+
+    // from here on a failure puts the original mode back, so the caller is
+    // single-buffered against the mode it opened with
+    const fb_var_screeninfo orig_var = fb.var;
+    const uint32_t orig_line_length = fb.line_length;
+    fb_var_screeninfo var = fb.var;
+    bool ok = true, mode_changed = false;
+    if (var.yres_virtual < need) {
+        var.yres_virtual = need;
+        var.xoffset = 0;
+        var.yoffset = 0;
+        mode_changed = ioctl(fb.fd, FBIOPUT_VSCREENINFO, &var) == 0;
+        if (!mode_changed ||
+            ioctl(fb.fd, FBIOGET_VSCREENINFO, &var) != 0 ||
+            var.yres_virtual < need) {
+            std::cerr << "[WARN] driver refused yres_virtual=" << need << ", single buffer\n";
+            ok = false;
+        } else {
+            fb_fix_screeninfo fix;
+            if (ioctl(fb.fd, FBIOGET_FSCREENINFO, &fix) == 0 && fix.line_length)
+                fb.line_length = fix.line_length;
+            fb.var = var;
+            // the driver may have padded the lines
+            if ((size_t)fb.line_length * need > fb.map_size) {
+                std::cerr << "[WARN] not enough video memory for " << buffers << " buffers, single buffer\n";
+                ok = false;
+            }
+        }
+    }
+
+    // make sure panning works before relying on it
+    if (ok) {
+        var.xoffset = 0;
+        var.yoffset = 0;
+        if (ioctl(fb.fd, FBIOPAN_DISPLAY, &var) != 0) {
+            std::cerr << "[WARN] FBIOPAN_DISPLAY not supported, single buffer\n";
+            ok = false;
+        }
+    }
+    if (!ok) {
+        if (mode_changed) {
+            fb_var_screeninfo restore = orig_var;
+            if (ioctl(fb.fd, FBIOPUT_VSCREENINFO, &restore) != 0)
+                std::cerr << "[WARN] could not restore the framebuffer mode: " << strerror(errno) << "\n";
+        }
+        fb.var = orig_var;
+        fb.line_length = orig_line_length;
+        return false;
+    }
+    fb.var = var;
+
+    __u32 crtc = 0;
+    fb.vsync = ioctl(fb.fd, FBIO_WAITFORVSYNC, &crtc) == 0;
+
+    fb.buffers = buffers;
+    fb.back = 1;    // buffer 0 is on screen
+    damage_all_buffers(fb);
+    return true;
+}
+
+// Close the frame: remember its damage and roll the byte counters.
+static void end_frame(fb_sink &fb)
+{
+    for (int k = FB_MAX_BUFFERS - 2; k > 0; k--)
+        fb.history[k] = fb.history[k - 1];
+    fb.history[0] = fb.damage;
+    fb.damage.count = 0;
+
+    fb.bytes_last = fb.bytes_frame;
+    fb.bytes_total += fb.bytes_frame;
+    fb.bytes_frame = 0;
+    fb.frames++;
+}
+
+void fb_present(fb_sink &fb)
+{
+    end_frame(fb);
+    if (fb.buffers < 2) return;
+
+    if (fb.is_device) {
+        fb_var_screeninfo var = fb.var;
+        var.xoffset = 0;
+        var.yoffset = fb.back * fb.height;
+        if (ioctl(fb.fd, FBIOPAN_DISPLAY, &var) != 0) {
+            // keep drawing into whatever is on screen from now on
+            std::cerr << "[WARN] FBIOPAN_DISPLAY failed, falling back to single buffer\n";
+            fb.back = fb.var.yoffset / fb.height;
+            fb.buffers = 1;
+            fb.vsync = false;
+            fb_damage(fb, screen_rect(fb));
+            return;
+        }
+        fb.var = var;
+
+        if (fb.vsync) {
+            __u32 crtc = 0;
+            ioctl(fb.fd, FBIO_WAITFORVSYNC, &crtc);
+        }
+    } else {
+        fb.var.yoffset = fb.back * fb.height;
+    }
+
+    fb.back = (fb.back + 1) % fb.buffers;
+}
+
+void fb_sink_close(fb_sink &fb)
+{
+    if (fb.map) munmap(fb.map, fb.map_size);
+    if (fb.fd >= 0) close(fb.fd);
+    fb_reset(fb);
+}
+
+void fb_blit(fb_sink &fb, const void *src, size_t src_step, int x, int y, int w, int h)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    const int bpp = (int)fb.bytes_per_pixel;
+
+    // clip to the visible area
+    if (x < 0) { s += (size_t)(-x) * bpp; w += x; x = 0; }
+    if (y < 0) { s += (size_t)(-y) * src_step; h += y; y = 0; }
+    if (x + w > (int)fb.width)  w = (int)fb.width - x;
+    if (y + h > (int)fb.height) h = (int)fb.height - y;
+    if (w <= 0 || h <= 0) return;
+
+    const size_t row_bytes = (size_t)w * bpp;
+    uint8_t *d = fb_row(fb, y) + (size_t)x * bpp;
+
+    fb_rect r = {x, y, w, h};
+    fb_damage(fb, r);
+    fb.bytes_frame += row_bytes * h;
+
+    if (row_bytes == fb.line_length && src_step == fb.line_length) {
+        memcpy(d, s, row_bytes * h);
+        return;
+    }
+    for (int row = 0; row < h; row++) {
+        memcpy(d, s, row_bytes);
+        d += fb.line_length;
+        s += src_step;
+    }
+}
+
+void fb_clear(fb_sink &fb)
+{
+    const size_t row_bytes = (size_t)fb.width * fb.bytes_per_pixel;
+    for (uint32_t y = 0; y < fb.height * fb.buffers; y++)
+        memset(fb.map + (size_t)y * fb.line_length, 0, row_bytes);
+    fb.bytes_frame += row_bytes * fb.height * fb.buffers;
+
+    // every buffer changed behind the producers' backs
+    damage_all_buffers(fb);
+    fb_damage(fb, screen_rect(fb));
+}
@@ -0,0 +1,129 @@
+#ifndef FB_SINK_H
+#define FB_SINK_H
+
+#include <linux/fb.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fb_format.h"
+
+// ================== Framebuffer sink ==================
+// Shared display output for the Lab2 / Lab3 / Lab5 programs.
+// The device is opened and mmap'ed once, rows are addressed with the real
+// stride (line_length), and a frame is pushed with memcpy instead of one
+// seekp() + write() syscall pair per scanline.
+//
+// Anything that is not a framebuffer (regular file, memfd) is accepted as a
+// stand-in so the display path can be benchmarked on a host without HDMI.
+// Its geometry comes from $FB_GEOMETRY ("WIDTHxHEIGHTxBPP", default
+// 1920x1080x16) and the file is grown to fit (it must already exist).
+//
+// Page flipping: fb_enable_flip() stacks 2 or 3 screens in yres_virtual.
+// Drawing (fb_row / fb_blit / fb_clear) then always targets the hidden back
+// buffer and fb_present() pans it onto the screen with FBIOPAN_DISPLAY,
+// waiting for vsync when the driver supports FBIO_WAITFORVSYNC. Without
+// fb_enable_flip(), or when the driver refuses, there is one buffer and
+// fb_present() only does the per-frame bookkeeping below.
+//
+// Damage tracking: whatever changed this frame is reported with
+// fb_damage() (fb_blit / fb_clear do it themselves). fb_repaint_region()
+// tells a producer which part of the back buffer it must rewrite: this
+// frame's damage plus the damage of the frames drawn into the other
+// buffers since this one was last on screen. Everything else already holds
+// the right pixels. bytes_frame / bytes_last count what was actually written.
+
+#define FB_MAX_BUFFERS 3
+#define FB_MAX_DAMAGE  8
+
+struct fb_rect {
+    int x, y, w, h;
+};
+
+// A few rectangles; past FB_MAX_DAMAGE they collapse into their bounding box.
+struct fb_damage_list {
+    int count;
+    fb_rect rect[FB_MAX_DAMAGE];
+};
+
+struct fb_sink {
+    int fd;
+    uint8_t *map;               // start of the mmap'ed video memory
+    size_t map_size;
+    fb_var_screeninfo var;      // FBIOGET_VSCREENINFO (synthesised for stand-ins)
+    uint32_t width;             // visible resolution (xres / yres)
+    uint32_t height;
+    uint32_t bits_per_pixel;
+    uint32_t bytes_per_pixel;
+    fb_format format;           // from the var bitfields; FB_FMT_UNKNOWN if unsupported
+    uint32_t line_length;       // bytes from one row to the next
+    bool is_device;             // false for file / memfd stand-ins
+    int buffers;                // screens stacked in yres_virtual (1 = no flipping)
+    int back;                   // screen currently drawn into
+    bool vsync;                 // fb_present() waits for vertical blank
+
+    fb_damage_list damage;                          // changed this frame
+    fb_damage_list history[FB_MAX_BUFFERS - 1];     // previous frames, newest first
+    uint64_t bytes_frame;       // written into the back buffer this frame
+    uint64_t bytes_last;        // written during the last presented frame
+    uint64_t bytes_total;
+    uint64_t frames;            // fb_present() calls
+};
+
+// $FB_DEVICE if set, otherwise "/dev/fb0".
+const char *fb_default_path();
+
+// Open and map a framebuffer device or stand-in file. Returns false (and
+// prints the reason) on failure; fb is left closed in that case.
+bool fb_sink_open(fb_sink &fb, const char *path);
+
+// Same, for an already-open descriptor (e.g. memfd_create). The sink takes
+// ownership of fd. width / height / bpp are only used when fd is not a
+// framebuffer device.
+bool fb_sink_open_fd(fb_sink &fb, int fd, uint32_t width, uint32_t height, uint32_t bpp);
+
+void fb_sink_close(fb_sink &fb);
+
+// Switch to page flipping with 2 or 3 buffers, growing yres_virtual if
+// needed. Returns false and stays single-buffered if the driver refuses.
+bool fb_enable_flip(fb_sink &fb, int buffers);
+
+// Show the back buffer and move drawing to the next one. Also closes the
+// frame for damage tracking and the byte counters.
+void fb_present(fb_sink &fb);
+
+// Mark r (screen coordinates, clipped) as changed this frame.
+void fb_damage(fb_sink &fb, fb_rect r);
+
+// Everything that has to be rewritten in the current back buffer.
+void fb_repaint_region(const fb_sink &fb, fb_damage_list &out);
+
+// Add r to list, dropping rectangles it covers (and skipping r if an
+// existing one covers it). Shared by the producers that build their own lists.
+void fb_damage_add(fb_damage_list &list, fb_rect r);
+
+// Intersection of a and b (w / h <= 0 when they don't overlap).
+inline fb_rect fb_rect_and(fb_rect a, fb_rect b)
+{
+    int x0 = a.x > b.x ? a.x : b.x;
+    int y0 = a.y > b.y ? a.y : b.y;
+    int x1 = (a.x + a.w) < (b.x + b.w) ? (a.x + a.w) : (b.x + b.w);
+    int y1 = (a.y + a.h) < (b.y + b.h) ? (a.y + a.h) : (b.y + b.h);
+    fb_rect r = {x0, y0, x1 - x0, y1 - y0};
+    return r;
+}
+
+// Pointer to the first pixel of row y of the back buffer.
+inline uint8_t *fb_row(fb_sink &fb, int y)
+{
+    return fb.map + ((size_t)fb.back * fb.height + y) * fb.line_length;
+}
+
+// Copy a w x h block of already-converted pixels (same format as the
+// framebuffer) to (x, y). src_step is the source row pitch in bytes.
+// The block is clipped to the visible area; a full-width block whose pitch
+// matches line_length is copied with a single memcpy.
+void fb_blit(fb_sink &fb, const void *src, size_t src_step, int x, int y, int w, int h);
+
+// Zero every buffer (black for every supported format).
+void fb_clear(fb_sink &fb);
+
+#endif
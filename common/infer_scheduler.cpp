@@ -0,0 +1,104 @@
+#include "infer_scheduler.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+static const double EWMA = 0.2;         // weight of a new sample
+
+static double ewma(double avg, double sample)
+{
+    return avg <= 0 ? sample : avg + EWMA * (sample - avg);
+}
+
+void infer_sched_init(infer_scheduler &s, const infer_sched_config &cfg)
+{
+    s.cfg = cfg;
+    s.extract_ms = s.frame_interval_ms = 0;
+    s.display_fps = s.detect_fps = 0;
+    s.gap_ms = 1000.0 / cfg.detect_fps_ceiling;
+    s.last_frame_us = s.last_launch_us = s.window_start_us = 0;
+    s.window_displayed = s.window_launched = 0;
+    s.frames = s.launched = s.displayed = 0;
+    s.backoffs = s.speedups = 0;
+}
+
+// end of a window: measure what was achieved and move the gap (lock held)
+static void retune(infer_scheduler &s, int64_t t_us)
+{
+    const double dt = (t_us - s.window_start_us) / 1e6;
+    s.display_fps = s.window_displayed / dt;
+    s.detect_fps = s.window_launched / dt;
+
+    // the camera itself may be slower than the floor; don't chase it
+    const double camera_fps = s.frame_interval_ms > 0 ? 1000.0 / s.frame_interval_ms : 0;
+    const double floor = std::min(s.cfg.display_fps_floor, camera_fps * 0.95);
+    const double min_gap = std::max(1000.0 / s.cfg.detect_fps_ceiling, s.extract_ms);
+
+    const char *why;
+    if (s.display_fps < floor) {
+        s.gap_ms = std::min(s.gap_ms * 1.5, s.cfg.max_gap_ms);
+        s.backoffs++;
+        why = "display below floor, backing off";
+    } else if (s.gap_ms > min_gap) {
+        s.gap_ms = std::max(s.gap_ms * 0.8, min_gap);
+        s.speedups++;
+        why = "display ok, detecting more";
+    } else {
+        s.gap_ms = min_gap;
+        why = s.extract_ms > 1000.0 / s.cfg.detect_fps_ceiling ? "limited by extract" : "at ceiling";
+    }
+
+    if (s.cfg.log)
+        printf("[SCHED] display %.1f fps (floor %.1f)  detect %.1f/s (ceiling %.1f)  extract %.1f ms  "
+               "camera %.1f ms -> gap %.0f ms: %s\n",
+               s.display_fps, floor, s.detect_fps, s.cfg.detect_fps_ceiling, s.extract_ms,
+               s.frame_interval_ms, s.gap_ms, why);
+
+    s.window_start_us = t_us;
+    s.window_displayed = s.window_launched = 0;
+}
+
+bool infer_sched_frame(infer_scheduler &s, int64_t t_us)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    s.frames++;
+    if (s.last_frame_us) s.frame_interval_ms = ewma(s.frame_interval_ms, (t_us - s.last_frame_us) / 1000.0);
+    s.last_frame_us = t_us;
+
+    if (!s.window_start_us) s.window_start_us = t_us;
+    else if (t_us - s.window_start_us >= (int64_t)(s.cfg.window_s * 1e6)) retune(s, t_us);
+
+    // launch on the frame closest to when the gap runs out: one that is
+    // at most half a frame early counts
+    const double since_ms = (t_us - s.last_launch_us) / 1000.0;
+    if (s.last_launch_us && since_ms + s.frame_interval_ms / 2 < s.gap_ms) return false;
+
+    s.last_launch_us = t_us;
+    s.launched++;
+    s.window_launched++;
+    return true;
+}
+
+void infer_sched_extract_done(infer_scheduler &s, int64_t extract_us)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    s.extract_ms = ewma(s.extract_ms, extract_us / 1000.0);
+}
+
+void infer_sched_displayed(infer_scheduler &s)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    s.displayed++;
+    s.window_displayed++;
+}
+
+void infer_sched_report(infer_scheduler &s)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    printf("[SCHED] %llu of %llu frames sent to detection (%.0f%%), gap backed off %llu times, shortened %llu times\n",
+           (unsigned long long)s.launched, (unsigned long long)s.frames,
+           s.frames ? 100.0 * s.launched / s.frames : 0.0, (unsigned long long)s.backoffs,
+           (unsigned long long)s.speedups);
+    printf("[SCHED] last window: display %.1f fps, detect %.1f/s, extract %.1f ms, gap %.0f ms\n",
+           s.display_fps, s.detect_fps, s.extract_ms, s.gap_ms);
+}
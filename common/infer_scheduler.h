@@ -0,0 +1,67 @@
+#ifndef INFER_SCHEDULER_H
+#define INFER_SCHEDULER_H
+
+#include <stdint.h>
+#include <mutex>
+
+// ================== Adaptive inference scheduling ==================
+// Decides per camera frame whether to start a detection, instead of a
+// fixed "every Nth frame". It keeps rolling measurements of
+//   - the ncnn extract latency (the pipeline cannot take work faster),
+//   - the camera frame interval,
+//   - the rate frames actually reach the screen,
+// and holds a minimum gap between launches:
+//   - never below 1 / detect_fps_ceiling or the extract latency;
+//   - every window_s it is re-tuned: when the display drops below
+//     display_fps_floor (inference is starving it of CPU) the gap grows
+//     by half, otherwise it shrinks by a fifth back towards the minimum.
+// A frame is launched once the gap has (almost) passed, rounded to the
+// camera's cadence. Each re-tune prints one "[SCHED]" line with the
+// achieved rates and the reason, so decisions can be followed in the log.
+//
+// infer_sched_frame() is called from the capture side, the two _done /
+// _displayed reports from the stage and display threads; a mutex keeps
+// them apart (a few dozen calls a second).
+
+struct infer_sched_config {
+    double display_fps_floor = 20;      // keep the screen at least this smooth
+    double detect_fps_ceiling = 15;     // never detect more often than this
+    double window_s = 1.0;              // re-tune period
+    double max_gap_ms = 1000;           // detect at least this often regardless
+    bool log = true;                    // print a [SCHED] line per window
+};
+
+struct infer_scheduler {
+    infer_sched_config cfg;
+    std::mutex lock;
+
+    // rolling measurements (EWMA)
+    double extract_ms;
+    double frame_interval_ms;
+    double display_fps, detect_fps;     // over the last window
+
+    double gap_ms;                      // current minimum gap between launches
+    int64_t last_frame_us, last_launch_us;
+    int64_t window_start_us;
+    uint64_t window_displayed, window_launched;
+
+    // totals
+    uint64_t frames, launched, displayed;
+    uint64_t backoffs, speedups;
+};
+
+void infer_sched_init(infer_scheduler &s, const infer_sched_config &cfg);
+
+// A camera frame captured at t_us: start a detection on it?
+bool infer_sched_frame(infer_scheduler &s, int64_t t_us);
+
+// The extract stage finished one detection in extract_us.
+void infer_sched_extract_done(infer_scheduler &s, int64_t extract_us);
+
+// A frame reached the screen.
+void infer_sched_displayed(infer_scheduler &s);
+
+// Totals: frames seen / launched, re-tune decisions, last rates.
+void infer_sched_report(infer_scheduler &s);
+
+#endif
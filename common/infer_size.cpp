@@ -0,0 +1,150 @@
+#include "infer_size.h"
+
+#include <stdio.h>
+
+static const double EWMA = 0.2;         // weight of a new sample
+
+void infer_size_init(infer_size_selector &s, const infer_size_config &cfg)
+{
+    s.cfg = cfg;
+    s.current = 0;
+    for (int i = 0; i < cfg.n_sizes; i++)
+        if (cfg.sizes[i] <= cfg.initial) s.current = i;
+    for (int i = 0; i < INFER_SIZE_MAX; i++) {
+        s.extract_ms[i] = 0;
+        s.launched[i] = 0;
+    }
+    s.min_object = 0;
+    s.objects = 0;
+    s.pending = 0;
+    s.pending_why = "";
+    s.pending_since_us = s.last_switch_us = 0;
+    s.ups = s.downs = 0;
+}
+
+// extract latency at size i: measured, or scaled by area from the nearest
+// measured size; < 0 when nothing has been measured yet
+static double predicted_ms(const infer_size_selector &s, int i)
+{
+    if (s.extract_ms[i] > 0) return s.extract_ms[i];
+    for (int d = 1; d < s.cfg.n_sizes; d++) {
+        for (int j = i - d; j <= i + d; j += 2 * d) {
+            if (j < 0 || j >= s.cfg.n_sizes || s.extract_ms[j] <= 0) continue;
+            const double r = (double)s.cfg.sizes[i] / s.cfg.sizes[j];
+            return s.extract_ms[j] * r * r;
+        }
+    }
+    return -1;
+}
+
+// which way the size should go now, and why (lock held)
+static int wanted(const infer_size_selector &s, const char *&why, bool &overload)
+{
+    const infer_size_config &c = s.cfg;
+    const int i = s.current;
+    overload = false;
+
+    if (i > 0 && predicted_ms(s, i) > c.budget_ms * c.down_margin) {
+        overload = true;
+        why = "extract over budget";
+        return -1;
+    }
+    const double up_ms = i + 1 < c.n_sizes ? predicted_ms(s, i + 1) : -1;
+    const bool up_fits = up_ms > 0 && up_ms <= c.budget_ms * c.up_margin;
+
+    if (s.objects > 0) {
+        if (s.min_object * c.sizes[i] < c.min_object_px && up_fits) {
+            why = "smallest object too small";
+            return 1;
+        }
+        if (i > 0 && s.min_object * c.sizes[i - 1] >= c.large_object_px) {
+            why = "objects large enough for a smaller input";
+            return -1;
+        }
+    } else {
+        if (c.sizes[i] > c.initial) {
+            why = "nothing tracked, back towards the initial size";
+            return -1;
+        }
+        if (c.sizes[i] < c.initial && up_fits) {
+            why = "nothing tracked, back towards the initial size";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int infer_size_pick(infer_size_selector &s, int64_t t_us)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+
+    const char *why = "";
+    bool overload = false;
+    const int dir = wanted(s, why, overload);
+    if (dir != s.pending) {
+        s.pending = dir;
+        s.pending_why = why;
+        s.pending_since_us = t_us;
+    }
+
+    const bool held = t_us - s.pending_since_us >= (int64_t)(s.cfg.hold_s * 1e6);
+    const bool dwelt = !s.last_switch_us || t_us - s.last_switch_us >= (int64_t)(s.cfg.min_dwell_s * 1e6);
+    if (dir != 0 && held && (dwelt || overload)) {
+        const int from = s.cfg.sizes[s.current];
+        s.current += dir;
+        if (dir > 0) s.ups++;
+        else s.downs++;
+        if (s.cfg.log) {
+            if (s.objects > 0)
+                printf("[SIZE] input %d -> %d: %s (smallest of %d objects %.0f px at %d, extract %.1f ms, budget %.0f ms)\n",
+                       from, s.cfg.sizes[s.current], s.pending_why, s.objects, s.min_object * from, from,
+                       predicted_ms(s, s.current - dir), s.cfg.budget_ms);
+            else
+                printf("[SIZE] input %d -> %d: %s (extract %.1f ms, budget %.0f ms)\n", from,
+                       s.cfg.sizes[s.current], s.pending_why, predicted_ms(s, s.current - dir), s.cfg.budget_ms);
+        }
+        s.pending = 0;
+        s.pending_since_us = t_us;
+        s.last_switch_us = t_us;
+    }
+
+    s.launched[s.current]++;
+    return s.cfg.sizes[s.current];
+}
+
+void infer_size_extract_done(infer_size_selector &s, int size, int64_t extract_us)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    for (int i = 0; i < s.cfg.n_sizes; i++) {
+        if (s.cfg.sizes[i] != size) continue;
+        const double ms = extract_us / 1000.0;
+        s.extract_ms[i] = s.extract_ms[i] <= 0 ? ms : s.extract_ms[i] + EWMA * (ms - s.extract_ms[i]);
+    }
+}
+
+void infer_size_objects(infer_size_selector &s, int count, float min_side_frac)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    s.objects = count;
+    s.min_object = min_side_frac;
+}
+
+int infer_size_current(infer_size_selector &s)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    return s.cfg.sizes[s.current];
+}
+
+void infer_size_report(infer_size_selector &s)
+{
+    std::lock_guard<std::mutex> hold(s.lock);
+    printf("[SIZE] input size switched %llu times up, %llu down; now %d\n", (unsigned long long)s.ups,
+           (unsigned long long)s.downs, s.cfg.sizes[s.current]);
+    for (int i = 0; i < s.cfg.n_sizes; i++) {
+        if (s.extract_ms[i] > 0)
+            printf("[SIZE]   %3d: %llu detections, extract %.1f ms\n", s.cfg.sizes[i],
+                   (unsigned long long)s.launched[i], s.extract_ms[i]);
+        else
+            printf("[SIZE]   %3d: %llu detections\n", s.cfg.sizes[i], (unsigned long long)s.launched[i]);
+    }
+}
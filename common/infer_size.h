@@ -0,0 +1,82 @@
+#ifndef INFER_SIZE_H
+#define INFER_SIZE_H
+
+#include <stdint.h>
+#include <mutex>
+
+// ================== Network input size selection ==================
+// Picks the detector's input size (e.g. 224 / 320 / 416 from one YOLOv8
+// export; ncnn takes any multiple of 32) while the program runs, from two
+// measurements:
+//   - load: the extract latency at each size (EWMA; sizes not tried yet are
+//     predicted from a measured one by input area). Above
+//     budget_ms * down_margin the size steps down; a step up is only taken
+//     when the bigger size is predicted within budget_ms * up_margin;
+//   - scene: the smallest tracked object, as a fraction of the frame's long
+//     side, i.e. its size in input pixels at every candidate size. Below
+//     min_object_px at the current size the detector starts missing it, so
+//     the size steps up; when it would still be large_object_px at the
+//     next smaller size, the size steps down. With nothing tracked the size
+//     returns to `initial`.
+// Hysteresis: the margins and the gap between min_object_px and
+// large_object_px keep the two directions apart, a reason must hold for
+// hold_s before it counts, and after a switch the size stays for
+// min_dwell_s (an overload only waits hold_s). One step per switch.
+// Each switch prints one "[SIZE]" line with the reason.
+//
+// infer_size_pick() is called where detections are launched, the two
+// reports from the extract and display threads; a mutex keeps them apart.
+
+#define INFER_SIZE_MAX 8
+
+struct infer_size_config {
+    int sizes[INFER_SIZE_MAX] = {224, 320, 416};    // ascending
+    int n_sizes = 3;
+    int initial = 320;
+    double budget_ms = 80;          // extract latency to stay under
+    double up_margin = 0.85;        // bigger size: predicted under budget * this
+    double down_margin = 1.1;       // smaller size: measured over budget * this
+    float min_object_px = 24;       // smallest object wants at least this (input pixels)
+    float large_object_px = 48;     // ... and is still this at the smaller size: step down
+    double hold_s = 1.0;
+    double min_dwell_s = 3.0;
+    bool log = true;                // print a [SIZE] line per switch
+};
+
+struct infer_size_selector {
+    infer_size_config cfg;
+    std::mutex lock;
+
+    int current;                            // index into cfg.sizes
+    double extract_ms[INFER_SIZE_MAX];      // EWMA per size, 0 = not measured
+    float min_object;                       // smallest tracked side / frame long side
+    int objects;                            // tracked objects (0: min_object unused)
+
+    int pending;                            // -1 / 0 / +1: direction wanted
+    const char *pending_why;
+    int64_t pending_since_us, last_switch_us;
+
+    // totals
+    uint64_t launched[INFER_SIZE_MAX];
+    uint64_t ups, downs;
+};
+
+void infer_size_init(infer_size_selector &s, const infer_size_config &cfg);
+
+// Input size for a detection launched at t_us (switches when due).
+int infer_size_pick(infer_size_selector &s, int64_t t_us);
+
+// The extract stage ran one detection at `size` in extract_us.
+void infer_size_extract_done(infer_size_selector &s, int size, int64_t extract_us);
+
+// The tracked objects now: how many and the smallest one's shorter side
+// divided by the frame's longer side.
+void infer_size_objects(infer_size_selector &s, int count, float min_side_frac);
+
+// Current size as a number (for the periodic stats line).
+int infer_size_current(infer_size_selector &s);
+
+// Totals: detections per size, switches, latency per size.
+void infer_size_report(infer_size_selector &s);
+
+#endif
@@ -0,0 +1,49 @@
+#include "latency_stats.h"
+
+#include <stdio.h>
+
+void latency_reset(latency_stats &st)
+{
+    st.bucket.assign(LATENCY_BUCKETS + 1, 0);
+    st.count = 0;
+    st.sum_us = st.max_us = 0;
+}
+
+void latency_record(latency_stats &st, int64_t us)
+{
+    if (st.bucket.empty()) latency_reset(st);
+    if (us < 0) us = 0;
+    int64_t b = us / LATENCY_BUCKET_US;
+    st.bucket[b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS]++;
+    st.count++;
+    st.sum_us += us;
+    if (us > st.max_us) st.max_us = us;
+}
+
+int64_t latency_percentile(const latency_stats &st, double p)
+{
+    if (st.count == 0) return 0;
+    uint64_t rank = (uint64_t)(p * st.count + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += st.bucket[b];
+        // upper edge of the bucket, but never above what was really seen
+        if (seen >= rank) {
+            int64_t us = (int64_t)(b + 1) * LATENCY_BUCKET_US;
+            return us < st.max_us ? us : st.max_us;
+        }
+    }
+    return st.max_us;
+}
+
+void latency_report(const latency_stats &st, const char *name)
+{
+    if (st.count == 0) {
+        printf("[LAT] %s: no samples\n", name);
+        return;
+    }
+    printf("[LAT] %s: n=%llu, mean %.1f  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f ms\n", name,
+           (unsigned long long)st.count, st.sum_us / 1000.0 / st.count, latency_percentile(st, 0.50) / 1000.0,
+           latency_percentile(st, 0.95) / 1000.0, latency_percentile(st, 0.99) / 1000.0, st.max_us / 1000.0);
+}
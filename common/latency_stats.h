@@ -0,0 +1,32 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <vector>
+
+// ================== Latency percentiles ==================
+// Fixed-size histogram of latency samples (0.1 ms buckets up to 2 s, one
+// overflow bucket), so a run of any length costs the same memory and each
+// sample is O(1). Percentiles are exact to the bucket width. Not thread
+// safe: record from one thread, report after it has stopped.
+
+#define LATENCY_BUCKET_US 100
+#define LATENCY_BUCKETS 20000
+
+struct latency_stats {
+    std::vector<uint32_t> bucket;       // LATENCY_BUCKETS + 1 (overflow), allocated on first use
+    uint64_t count = 0;
+    int64_t sum_us = 0, max_us = 0;
+};
+
+void latency_reset(latency_stats &st);
+void latency_record(latency_stats &st, int64_t us);
+
+// Latency (us) below which a fraction p (0..1) of the samples fall;
+// 0 without samples.
+int64_t latency_percentile(const latency_stats &st, double p);
+
+// "[LAT] name: n=..., mean .. p50 .. p95 .. p99 .. max .. ms"
+void latency_report(const latency_stats &st, const char *name);
+
+#endif
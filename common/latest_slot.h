@@ -0,0 +1,66 @@
+#ifndef LATEST_SLOT_H
+#define LATEST_SLOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// ================== Latest-value slot ==================
+// Lock-free hand-over between exactly one producer thread and one consumer
+// thread where only the newest value matters (camera frames, detection
+// results). It is a triple buffer: the producer fills back(), publish()
+// swaps it with the shared middle entry; the consumer's fetch() swaps the
+// middle entry with front() if something new arrived. Nobody ever waits on
+// the other side, and a slow consumer just skips stale values.
+//
+// The three T objects are reused, so a cv::Mat or std::vector keeps its
+// allocation from one round to the next (cam.read(slot.back()) writes
+// straight into it).
+//
+// back() belongs to the producer, front() to the consumer; neither may be
+// touched from the other thread.
+
+template <typename T>
+struct latest_slot {
+    latest_slot() : state(1), back_idx(0), front_idx(2), published(0), dropped(0) {}
+
+    // ---- producer side ----
+    T &back() { return buf[back_idx]; }
+
+    // Hand back() over to the consumer; returns the fresh back().
+    T &publish()
+    {
+        int old = state.exchange(back_idx | FRESH, std::memory_order_acq_rel);
+        if (old & FRESH) dropped++;     // the consumer never saw that one
+        back_idx = old & INDEX;
+        published++;
+        return buf[back_idx];
+    }
+
+    // ---- consumer side ----
+    // Move the newest published value into front(). False if there is
+    // nothing newer than what front() already holds.
+    bool fetch()
+    {
+        if (!(state.load(std::memory_order_relaxed) & FRESH)) return false;
+        int old = state.exchange(front_idx, std::memory_order_acq_rel);
+        front_idx = old & INDEX;
+        return true;
+    }
+
+    T &front() { return buf[front_idx]; }
+
+    // producer-side counters (read them from another thread only after it
+    // has stopped)
+    uint64_t published_count() const { return published; }
+    uint64_t dropped_count() const { return dropped; }
+
+private:
+    enum { INDEX = 3, FRESH = 4 };
+
+    T buf[3];
+    std::atomic<int> state;     // middle index | FRESH
+    int back_idx, front_idx;
+    uint64_t published, dropped;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "mjpeg_decode.h"
+
+#include <string.h>
+
+// libjpeg reports errors through error_exit, which must not return
+static void on_error(j_common_ptr cinfo)
+{
+    mjpeg_decoder::err_mgr *err = (mjpeg_decoder::err_mgr *)cinfo->err;
+    (*cinfo->err->format_message)(cinfo, err->msg);
+    longjmp(err->jump, 1);
+}
+
+// corrupt-data warnings are common with USB cameras; don't spam stderr
+static void on_message(j_common_ptr)
+{
+}
+
+bool mjpeg_decoder_init(mjpeg_decoder &d)
+{
+    memset(&d.cinfo, 0, sizeof(d.cinfo));
+    d.cinfo.err = jpeg_std_error(&d.err.pub);
+    d.err.pub.error_exit = on_error;
+    d.err.pub.output_message = on_message;
+    d.err.msg[0] = 0;
+    d.in_frame = false;
+    if (setjmp(d.err.jump)) {
+        d.ready = false;
+        return false;
+    }
+    jpeg_create_decompress(&d.cinfo);
+    d.ready = true;
+    return true;
+}
+
+void mjpeg_decoder_free(mjpeg_decoder &d)
+{
+    if (d.ready) jpeg_destroy_decompress(&d.cinfo);
+    d.ready = false;
+    d.in_frame = false;
+}
+
+int mjpeg_pick_denom(int w, int h, int need_w, int need_h)
+{
+    int denom = 1;
+    while (denom < 8 && w / (denom * 2) >= need_w && h / (denom * 2) >= need_h)
+        denom *= 2;
+    return denom;
+}
+
+bool mjpeg_read_header(mjpeg_decoder &d, const uint8_t *jpg, size_t len, int denom, bool gray,
+                       int &out_w, int &out_h)
+{
+    if (!d.ready) return false;
+    if (setjmp(d.err.jump)) {
+        jpeg_abort_decompress(&d.cinfo);
+        d.in_frame = false;
+        return false;
+    }
+    if (d.in_frame) jpeg_abort_decompress(&d.cinfo);
+
+    jpeg_mem_src(&d.cinfo, (unsigned char *)jpg, (unsigned long)len);
+    jpeg_read_header(&d.cinfo, TRUE);
+
+    d.cinfo.scale_num = 1;
+    d.cinfo.scale_denom = denom;
+    d.cinfo.dct_method = JDCT_IFAST;
+    d.cinfo.do_fancy_upsampling = FALSE;
+    d.cinfo.do_block_smoothing = FALSE;
+    if (gray) {
+        d.cinfo.out_color_space = JCS_GRAYSCALE;
+    } else {
+#ifdef JCS_EXTENSIONS
+        d.cinfo.out_color_space = JCS_EXT_BGR;
+#else
+        d.cinfo.out_color_space = JCS_RGB;     // swapped to BGR after decoding
+#endif
+    }
+    jpeg_calc_output_dimensions(&d.cinfo);
+    out_w = (int)d.cinfo.output_width;
+    out_h = (int)d.cinfo.output_height;
+    d.in_frame = true;
+    return true;
+}
+
+bool mjpeg_decode(mjpeg_decoder &d, uint8_t *dst, size_t dst_step)
+{
+    if (!d.in_frame) return false;
+    if (setjmp(d.err.jump)) {
+        jpeg_abort_decompress(&d.cinfo);
+        d.in_frame = false;
+        return false;
+    }
+
+    jpeg_start_decompress(&d.cinfo);
+    while (d.cinfo.output_scanline < d.cinfo.output_height) {
+        JSAMPROW rows[4];
+        int n = 0;
+        for (; n < 4 && d.cinfo.output_scanline + n < d.cinfo.output_height; n++)
+            rows[n] = dst + (size_t)(d.cinfo.output_scanline + n) * dst_step;
+        jpeg_read_scanlines(&d.cinfo, rows, n);
+    }
+#ifndef JCS_EXTENSIONS
+    if (d.cinfo.out_color_space == JCS_RGB) {
+        for (JDIMENSION y = 0; y < d.cinfo.output_height; y++) {
+            uint8_t *p = dst + (size_t)y * dst_step;
+            for (JDIMENSION x = 0; x < d.cinfo.output_width; x++, p += 3) {
+                uint8_t t = p[0];
+                p[0] = p[2];
+                p[2] = t;
+            }
+        }
+    }
+#endif
+    jpeg_finish_decompress(&d.cinfo);
+    d.in_frame = false;
+    return true;
+}
+
+// Walks the marker segments, so bytes inside them (an EXIF thumbnail) are
+// not taken for the end of the frame.
+size_t mjpeg_frame_length(const uint8_t *p, size_t len)
+{
+    if (len < 4 || p[0] != 0xff || p[1] != 0xd8) return 0;
+    size_t i = 2;
+    while (i + 2 <= len) {
+        if (p[i] != 0xff) return 0;
+        uint8_t m = p[i + 1];
+        if (m == 0xff) { i++; continue; }                   // fill byte
+        if (m == 0xd9) return i + 2;                        // EOI
+        if (m == 0x01 || (m >= 0xd0 && m <= 0xd7)) { i += 2; continue; }
+        if (i + 4 > len) return 0;
+        size_t seg = ((size_t)p[i + 2] << 8) | p[i + 3];
+        i += 2 + seg;
+        if (m != 0xda) continue;
+        // entropy-coded data after SOS runs to the next real marker
+        while (i + 1 < len && !(p[i] == 0xff && p[i + 1] != 0 && (p[i + 1] < 0xd0 || p[i + 1] > 0xd7)))
+            i++;
+    }
+    return 0;
+}
+
+const char *mjpeg_error(const mjpeg_decoder &d)
+{
+    return d.err.msg;
+}
@@ -0,0 +1,56 @@
+#ifndef MJPEG_DECODE_H
+#define MJPEG_DECODE_H
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <jpeglib.h>
+
+// ================== MJPEG frame decoder ==================
+// Decodes one camera JPEG at a time with libjpeg(-turbo), using its
+// DCT-domain scaling (scale_num / scale_denom = 1/1, 1/2, 1/4, 1/8): at
+// 1/2 only a 4x4 IDCT per block is done and the full-size image never
+// exists. Output is packed BGR24 (or grey, which skips chroma entirely).
+// The libjpeg object is created once and reused for every frame.
+//
+// Fast settings (JDCT_IFAST, no fancy upsampling) are used; UVC cameras
+// often leave the Huffman tables out of each frame, which libjpeg-turbo
+// fills in with the standard ones.
+
+struct mjpeg_decoder {
+    jpeg_decompress_struct cinfo;
+    struct err_mgr {
+        jpeg_error_mgr pub;
+        jmp_buf jump;
+        char msg[JMSG_LENGTH_MAX];
+    } err;
+    bool ready;
+    bool in_frame;      // between mjpeg_read_header() and mjpeg_decode()
+};
+
+bool mjpeg_decoder_init(mjpeg_decoder &d);
+void mjpeg_decoder_free(mjpeg_decoder &d);
+
+// Largest power-of-two reduction (1, 2, 4 or 8) that keeps a w x h image
+// at least need_w x need_h.
+int mjpeg_pick_denom(int w, int h, int need_w, int need_h);
+
+// Parse the frame header and set up decoding at 1/denom, grey or BGR.
+// out_w / out_h receive the decoded size. False (and a message) on a
+// broken frame.
+bool mjpeg_read_header(mjpeg_decoder &d, const uint8_t *jpg, size_t len, int denom, bool gray,
+                       int &out_w, int &out_h);
+
+// Decode the frame set up by mjpeg_read_header() into dst (dst_step bytes
+// per row, out_w * 3 or out_w bytes wide).
+bool mjpeg_decode(mjpeg_decoder &d, uint8_t *dst, size_t dst_step);
+
+// Bytes from the SOI at jpg up to and including the EOI, 0 if there is no
+// complete frame there. Used to split recorded MJPEG streams.
+size_t mjpeg_frame_length(const uint8_t *jpg, size_t len);
+
+// Last error message.
+const char *mjpeg_error(const mjpeg_decoder &d);
+
+#endif
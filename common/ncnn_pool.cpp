@@ -0,0 +1,84 @@
+#include "ncnn_pool.h"
+
+#include <iostream>
+
+ncnn_pool::ncnn_pool(bool locked_, size_t reserve_slots) : locked(locked_)
+{
+    slots.reserve(reserve_slots);
+}
+
+ncnn_pool::~ncnn_pool()
+{
+    clear();
+    if (!slots.empty())
+        std::cerr << "[ERR] ncnn_pool destroyed with " << slots.size()
+                  << " buffers still in use (destroy the Net and its Mats first)\n";
+}
+
+void *ncnn_pool::fastMalloc(size_t size)
+{
+    std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+    if (locked) guard.lock();
+
+    int best = -1, biggest = -1;
+    for (size_t i = 0; i < slots.size(); i++) {
+        const slot &s = slots[i];
+        if (s.used) continue;
+        if (s.size >= size && (best < 0 || s.size < slots[best].size)) best = (int)i;
+        if (biggest < 0 || s.size > slots[biggest].size) biggest = (int)i;
+    }
+    if (best >= 0) {
+        slots[best].used = true;
+        return slots[best].ptr;
+    }
+
+    // nothing free is big enough: grow the biggest free buffer, or add one
+    if (biggest >= 0) {
+        ncnn::fastFree(slots[biggest].ptr);
+        bytes -= slots[biggest].size;
+    }
+    void *ptr = ncnn::fastMalloc(size);
+    if (!ptr) {
+        if (biggest >= 0) slots.erase(slots.begin() + biggest);
+        return 0;
+    }
+    allocations++;
+    bytes += size;
+
+    slot s = {ptr, size, true};
+    if (biggest >= 0) slots[biggest] = s;
+    else slots.push_back(s);
+    return ptr;
+}
+
+void ncnn_pool::fastFree(void *ptr)
+{
+    std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+    if (locked) guard.lock();
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i].ptr == ptr) {
+            slots[i].used = false;
+            return;
+        }
+    }
+    std::cerr << "[WARN] ncnn_pool: freeing a buffer that is not from this pool\n";
+    ncnn::fastFree(ptr);
+}
+
+void ncnn_pool::clear()
+{
+    std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+    if (locked) guard.lock();
+
+    size_t n = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i].used) {
+            slots[n++] = slots[i];
+        } else {
+            ncnn::fastFree(slots[i].ptr);
+            bytes -= slots[i].size;
+        }
+    }
+    slots.resize(n);
+}
@@ -0,0 +1,51 @@
+#ifndef NCNN_POOL_H
+#define NCNN_POOL_H
+
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+#include <ncnn/mat.h>
+
+// ================== Blob / workspace memory pool for ncnn ==================
+// An ncnn::Allocator that keeps every buffer it has handed out and gives
+// it out again, for net.opt.blob_allocator / workspace_allocator (or
+// Extractor::set_*_allocator). It plays the part of ncnn::PoolAllocator
+// (locked) and ncnn::UnlockedPoolAllocator (locked = false). Those keep
+// their free and used buffers in std::lists, so every fastMalloc and
+// fastFree also allocates or frees a list node. Here the bookkeeping is a
+// vector of slots reserved up front, so a repeated inference makes no heap
+// allocation once the pool has warmed up.
+//
+// A request takes the smallest free buffer that is big enough. When none
+// is, the biggest free buffer is reallocated at the new size; a buffer is
+// only added when all of them are in use. Buffers never shrink and there
+// are never more than were in use at once, so with a fixed input size (or a
+// few of them) the pool stops allocating after a few runs.
+//
+// Use locked = true when Mats from the pool are released on another thread
+// (the extract output decoded in the next pipeline stage). The pool has to
+// outlive the Net and every Mat allocated from it.
+
+struct ncnn_pool : public ncnn::Allocator {
+    explicit ncnn_pool(bool locked = true, size_t reserve_slots = 64);
+    virtual ~ncnn_pool();
+
+    virtual void *fastMalloc(size_t size);
+    virtual void fastFree(void *ptr);
+
+    // Free all buffers not in use.
+    void clear();
+
+    struct slot {
+        void *ptr;
+        size_t size;
+        bool used;
+    };
+    bool locked;
+    std::mutex lock;
+    std::vector<slot> slots;
+    size_t allocations = 0;     // buffers allocated (or reallocated) from the heap
+    size_t bytes = 0;           // held in all buffers
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "net_letterbox.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Same source positions as cv::resize INTER_LINEAR: s = (d + 0.5) * scale - 0.5,
+// clamped at the borders (see fb_letterbox.cpp).
+static void build_taps(int dst_n, int src_n, int step,
+                       std::vector<int> &ofs0, std::vector<int> &ofs1, std::vector<float> &alpha)
+{
+    ofs0.resize(dst_n);
+    ofs1.resize(dst_n);
+    alpha.resize(dst_n);
+
+    const double scale = (double)src_n / dst_n;
+    for (int d = 0; d < dst_n; d++) {
+        double s = (d + 0.5) * scale - 0.5;
+        int s0 = (int)floor(s);
+        double f = s - s0;
+        if (s0 < 0) {
+            s0 = 0;
+            f = 0.0;
+        }
+        if (s0 >= src_n - 1) {
+            s0 = src_n - 1;
+            f = 0.0;
+        }
+        int s1 = std::min(s0 + 1, src_n - 1);
+
+        ofs0[d] = s0 * step;
+        ofs1[d] = s1 * step;
+        alpha[d] = (float)f;
+    }
+}
+
+bool net_letterbox_geometry(net_letterbox &lb, int src_w, int src_h, int target)
+{
+    if (lb.src_w == src_w && lb.src_h == src_h && lb.target == target) return false;
+
+    lb.src_w = src_w;
+    lb.src_h = src_h;
+    lb.target = target;
+    lb.scale = std::min((float)target / src_w, (float)target / src_h);
+    lb.w = (int)round(src_w * lb.scale);
+    lb.h = (int)round(src_h * lb.scale);
+    lb.pad_x = (target - lb.w) / 2;
+    lb.pad_y = (target - lb.h) / 2;
+
+    build_taps(lb.w, src_w, 3, lb.xofs0, lb.xofs1, lb.xalpha);
+    build_taps(lb.h, src_h, 1, lb.yofs0, lb.yofs1, lb.yalpha);
+    for (int i = 0; i < 2; i++) {
+        lb.hrow[i].resize(3 * (size_t)lb.w);
+        lb.hrow_y[i] = -1;
+    }
+    return true;
+}
+
+void net_letterbox_pad(const net_letterbox &lb, float *planes, size_t cstep)
+{
+    const int t = lb.target, x1 = lb.pad_x + lb.w, y1 = lb.pad_y + lb.h;
+    const size_t ts = lb.stride ? lb.stride : t;
+    for (int c = 0; c < 3; c++) {
+        const float black = -lb.mean[c] * lb.norm[c];
+        float *plane = planes + c * cstep;
+        for (int y = 0; y < t; y++) {
+            float *row = plane + y * ts;
+            if (y < lb.pad_y || y >= y1) {
+                std::fill(row, row + t, black);
+            } else {
+                std::fill(row, row + lb.pad_x, black);
+                std::fill(row + x1, row + t, black);
+            }
+        }
+    }
+}
+
+// Horizontal pass for one source row into planar B|G|R floats (0..255).
+static void hfilter_row(const net_letterbox &lb, const uint8_t *row, float *out)
+{
+    const int w = lb.w;
+    float *ob = out, *og = out + w, *orr = out + 2 * w;
+    for (int x = 0; x < w; x++) {
+        const uint8_t *p0 = row + lb.xofs0[x];
+        const uint8_t *p1 = row + lb.xofs1[x];
+        const float a = lb.xalpha[x];
+        ob[x] = p0[0] + (p1[0] - p0[0]) * a;
+        og[x] = p0[1] + (p1[1] - p0[1]) * a;
+        orr[x] = p0[2] + (p1[2] - p0[2]) * a;
+    }
+}
+
+// the filtered source row sy, from the cache when the last rows used it
+static const float *filtered_row(net_letterbox &lb, const uint8_t *src, size_t src_step, int sy)
+{
+    for (int i = 0; i < 2; i++)
+        if (lb.hrow_y[i] == sy) return lb.hrow[i].data();
+    // replace the one not used by the current output row (the older one)
+    const int i = lb.hrow_y[0] < lb.hrow_y[1] ? 0 : 1;
+    hfilter_row(lb, src + (size_t)sy * src_step, lb.hrow[i].data());
+    lb.hrow_y[i] = sy;
+    return lb.hrow[i].data();
+}
+
+void net_letterbox_run(net_letterbox &lb, const uint8_t *src, size_t src_step, float *planes, size_t cstep)
+{
+    const size_t t = lb.stride ? lb.stride : lb.target;
+    const int w = lb.w;
+    // per source channel (B, G, R): output plane, scale and offset
+    float k[3], bias[3];
+    float *dst_c[3];
+    for (int c = 0; c < 3; c++) {
+        const int plane = lb.rgb ? 2 - c : c;
+        k[c] = lb.norm[plane];
+        bias[c] = -lb.mean[plane] * lb.norm[plane];
+        dst_c[c] = planes + plane * cstep + lb.pad_y * t + lb.pad_x;
+    }
+    float *dst_b = dst_c[0], *dst_g = dst_c[1], *dst_r = dst_c[2];
+
+    if (w == lb.src_w && lb.h == lb.src_h) {
+        // 1:1: split and normalise only
+        for (int y = 0; y < lb.h; y++) {
+            const uint8_t *p = src + (size_t)y * src_step;
+            float *b = dst_b + y * t, *g = dst_g + y * t, *r = dst_r + y * t;
+            for (int x = 0; x < w; x++) {
+                b[x] = p[3 * x] * k[0] + bias[0];
+                g[x] = p[3 * x + 1] * k[1] + bias[1];
+                r[x] = p[3 * x + 2] * k[2] + bias[2];
+            }
+        }
+        return;
+    }
+
+    // the cache refers to the previous image
+    lb.hrow_y[0] = lb.hrow_y[1] = -1;
+    for (int y = 0; y < lb.h; y++) {
+        const float a = lb.yalpha[y];
+        const float *h0 = filtered_row(lb, src, src_step, lb.yofs0[y]);
+        const float *h1 = a != 0 ? filtered_row(lb, src, src_step, lb.yofs1[y]) : h0;
+        float *dst[3] = {dst_b + y * t, dst_g + y * t, dst_r + y * t};   // B, G, R
+
+        // vertical blend and normalisation in one: d = h0 * k0 + h1 * k1 + bias
+        for (int c = 0; c < 3; c++) {
+            const float *r0 = h0 + c * w, *r1 = h1 + c * w;
+            const float k0 = (1 - a) * k[c], k1 = a * k[c], bc = bias[c];
+            float *d = dst[c];
+            for (int x = 0; x < w; x++) d[x] = r0[x] * k0 + r1[x] * k1 + bc;
+        }
+    }
+}
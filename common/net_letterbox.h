@@ -0,0 +1,63 @@
+#ifndef NET_LETTERBOX_H
+#define NET_LETTERBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ================== Fused letterbox into a network input ==================
+// The detector input counterpart of fb_letterbox: replaces cv::resize ->
+// black canvas -> copyTo -> ncnn::Mat::from_pixels ->
+// substract_mean_normalize (four passes, two full-size temporaries per
+// call) with one pass. A BGR888 image is scaled bilinearly (same sample
+// positions as cv::resize INTER_LINEAR, float weights), split into B, G, R
+// (or R, G, B) planes, normalised as (v - mean) * norm and stored straight
+// into the target x target float planes of the caller's buffer.
+//
+// The padding does not depend on the picture, so it is written separately
+// (net_letterbox_pad) and only when a buffer is new or the geometry
+// changed; net_letterbox_run touches just the picture area. Each source
+// row is filtered horizontally once and kept while the next output rows
+// still need it. Sizes equal to the source (the MJPEG decoder already
+// delivers 320x240 for a 320 input) skip the filtering.
+//
+// Planes are `target` floats per row, plane c at planes + c * cstep (the
+// layout of an ncnn::Mat(target, target, 3)). With `stride` set, the
+// target x target square is one cell of wider planes (a mosaic of crops):
+// rows are `stride` floats apart and planes points at the cell's corner.
+
+struct net_letterbox {
+    bool rgb = false;       // planes R, G, B (ncnn PIXEL_BGR2RGB) instead of B, G, R
+    float mean[3] = {0, 0, 0};                      // per output plane
+    float norm[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+    int stride = 0;         // floats per output row, 0 = target
+
+    // geometry: src_w x src_h scaled by `scale` to w x h at (pad_x, pad_y)
+    int src_w = 0, src_h = 0, target = 0;
+    float scale = 1;
+    int w = 0, h = 0, pad_x = 0, pad_y = 0;
+
+    // per picture column / row: the two source taps and the second's weight
+    std::vector<int> xofs0, xofs1;
+    std::vector<float> xalpha;
+    std::vector<int> yofs0, yofs1;
+    std::vector<float> yalpha;
+
+    // two horizontally filtered source rows, planar B|G|R
+    std::vector<float> hrow[2];
+    int hrow_y[2] = {-1, -1};
+};
+
+// Set up for a src_w x src_h image into a target x target input; returns
+// true when the geometry differs from the previous call (pads must be
+// rewritten).
+bool net_letterbox_geometry(net_letterbox &lb, int src_w, int src_h, int target);
+
+// Fill everything outside the picture with the normalised value of black.
+void net_letterbox_pad(const net_letterbox &lb, float *planes, size_t cstep);
+
+// Scale and normalise the picture (src: BGR888, src_step bytes per row, the
+// size given to net_letterbox_geometry) into its place in the planes.
+void net_letterbox_run(net_letterbox &lb, const uint8_t *src, size_t src_step, float *planes, size_t cstep);
+
+#endif
@@ -0,0 +1,384 @@
+#include "nms.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// cells per side at most; with fewer boxes than this squared the grid is
+// mostly empty anyway
+static const int MAX_GRID = 64;
+
+// groups this small are scanned linearly, the grid would not pay for itself
+static const int MIN_GRID_BOXES = 32;
+
+enum { PENDING, TAKEN, DROPPED };
+
+float nms_iou(const nms_box &a, const nms_box &b)
+{
+    const float iw = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
+    const float ih = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
+    if (iw <= 0 || ih <= 0) return 0;
+    const float inter = iw * ih;
+    const float uni = (a.x1 - a.x0) * (a.y1 - a.y0) + (b.x1 - b.x0) * (b.y1 - b.y0) - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+static inline float iou_soa(float ax0, float ay0, float ax1, float ay1, float aarea,
+                            float bx0, float by0, float bx1, float by1, float barea)
+{
+    const float iw = std::min(ax1, bx1) - std::max(ax0, bx0);
+    const float ih = std::min(ay1, by1) - std::max(ay0, by0);
+    if (iw <= 0 || ih <= 0) return 0;
+    const float inter = iw * ih;
+    const float uni = aarea + barea - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+// ---- candidates: top-K, processing order, SoA copy ----
+
+// score bits as an unsigned key that sorts ascending for descending scores
+static inline uint32_t desc_key(float score)
+{
+    uint32_t u;
+    memcpy(&u, &score, sizeof(u));
+    u ^= (uint32_t)((int32_t)u >> 31) | 0x80000000u;
+    return ~u;
+}
+
+// Stable LSD radix sort by score, best first, 3 passes of 11 bits; equal
+// scores keep their (index) order. Replaces a comparison sort that took
+// about half of the whole NMS on a few thousand proposals.
+static void sort_by_score(std::vector<nms_sort_key> &keys, std::vector<nms_sort_key> &tmp,
+                          std::vector<uint32_t> &hist)
+{
+    const size_t n = keys.size();
+    if (n < 256) {      // the histograms would cost more than the sort
+        std::sort(keys.begin(), keys.end(), [](const nms_sort_key &a, const nms_sort_key &b) {
+            return a.score > b.score || (a.score == b.score && a.i < b.i);
+        });
+        return;
+    }
+    static const int BITS = 11, BUCKETS = 1 << BITS;
+    hist.assign(3 * BUCKETS, 0);
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t k = desc_key(keys[i].score);
+        hist[k & (BUCKETS - 1)]++;
+        hist[BUCKETS + ((k >> BITS) & (BUCKETS - 1))]++;
+        hist[2 * BUCKETS + (k >> (2 * BITS))]++;
+    }
+    tmp.resize(n);
+    for (int pass = 0; pass < 3; pass++) {
+        uint32_t *h = &hist[pass * BUCKETS];
+        uint32_t sum = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            const uint32_t c = h[b];
+            h[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t d = (desc_key(keys[i].score) >> (pass * BITS)) & (BUCKETS - 1);
+            tmp[h[d]++] = keys[i];
+        }
+        keys.swap(tmp);
+    }
+}
+
+// stable counting sort by label (order within a label kept)
+static void sort_by_label(std::vector<nms_sort_key> &keys, std::vector<nms_sort_key> &tmp)
+{
+    const size_t n = keys.size();
+    if (n == 0) return;
+    int lo = keys[0].label, hi = lo;
+    for (size_t i = 1; i < n; i++) {
+        lo = std::min(lo, keys[i].label);
+        hi = std::max(hi, keys[i].label);
+    }
+    if (lo == hi) return;
+    if (hi - lo > 65535) {      // not class ids
+        std::stable_sort(keys.begin(), keys.end(),
+                         [](const nms_sort_key &a, const nms_sort_key &b) { return a.label < b.label; });
+        return;
+    }
+    std::vector<uint32_t> start(hi - lo + 2, 0);
+    for (size_t i = 0; i < n; i++) start[keys[i].label - lo + 1]++;
+    for (size_t b = 1; b < start.size(); b++) start[b] += start[b - 1];
+    tmp.resize(n);
+    for (size_t i = 0; i < n; i++) tmp[start[keys[i].label - lo]++] = keys[i];
+    keys.swap(tmp);
+}
+
+static void prepare(nms_workspace &ws, const nms_box *boxes, int n, const nms_config &cfg)
+{
+    // by score (best first, earlier box on ties), cut to top_k, then
+    // grouped by class keeping that order
+    std::vector<nms_sort_key> &order = ws.keys;
+    order.resize(n);
+    for (int i = 0; i < n; i++) {
+        nms_sort_key k = {boxes[i].label, boxes[i].score, i};
+        order[i] = k;
+    }
+    sort_by_score(order, ws.keys_tmp, ws.hist);
+    if (cfg.top_k > 0 && cfg.top_k < n) order.resize(cfg.top_k);
+    if (cfg.per_class) sort_by_label(order, ws.keys_tmp);
+
+    const size_t m = order.size();
+    ws.src.resize(m);
+    ws.x0.resize(m);
+    ws.y0.resize(m);
+    ws.x1.resize(m);
+    ws.y1.resize(m);
+    ws.area.resize(m);
+    ws.score.resize(m);
+    ws.label.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        const nms_box &b = boxes[order[i].i];
+        ws.src[i] = order[i].i;
+        ws.x0[i] = b.x0;
+        ws.y0[i] = b.y0;
+        ws.x1[i] = b.x1;
+        ws.y1[i] = b.y1;
+        ws.area[i] = (b.x1 - b.x0) * (b.y1 - b.y0);
+        ws.score[i] = b.score;
+        ws.label[i] = b.label;
+    }
+}
+
+// ---- grid over candidates [g0, g1) ----
+
+static void grid_clear(nms_workspace &ws)
+{
+    for (size_t i = 0; i < ws.touched.size(); i++) ws.cells[ws.touched[i]].clear();
+    ws.touched.clear();
+}
+
+static void grid_begin(nms_workspace &ws, int g0, int g1)
+{
+    grid_clear(ws);
+    float bx0 = ws.x0[g0], by0 = ws.y0[g0], bx1 = ws.x1[g0], by1 = ws.y1[g0];
+    double sum_w = 0, sum_h = 0;
+    for (int i = g0; i < g1; i++) {
+        bx0 = std::min(bx0, ws.x0[i]);
+        by0 = std::min(by0, ws.y0[i]);
+        bx1 = std::max(bx1, ws.x1[i]);
+        by1 = std::max(by1, ws.y1[i]);
+        sum_w += ws.x1[i] - ws.x0[i];
+        sum_h += ws.y1[i] - ws.y0[i];
+    }
+    const int n = g1 - g0;
+    const float ext_w = std::max(bx1 - bx0, 1e-3f), ext_h = std::max(by1 - by0, 1e-3f);
+    // about one average box per cell, at most MAX_GRID cells per side
+    ws.cell_w = std::max((float)(sum_w / n), ext_w / MAX_GRID);
+    ws.cell_h = std::max((float)(sum_h / n), ext_h / MAX_GRID);
+    ws.cols = std::min(MAX_GRID, (int)(ext_w / ws.cell_w) + 1);
+    ws.rows = std::min(MAX_GRID, (int)(ext_h / ws.cell_h) + 1);
+    ws.gx = bx0;
+    ws.gy = by0;
+    if (ws.cells.size() < (size_t)(ws.cols * ws.rows)) ws.cells.resize(ws.cols * ws.rows);
+}
+
+static inline void grid_span(const nms_workspace &ws, float x0, float y0, float x1, float y1,
+                             int &c0, int &r0, int &c1, int &r1)
+{
+    c0 = std::max(0, std::min(ws.cols - 1, (int)((x0 - ws.gx) / ws.cell_w)));
+    c1 = std::max(c0, std::min(ws.cols - 1, (int)((x1 - ws.gx) / ws.cell_w)));
+    r0 = std::max(0, std::min(ws.rows - 1, (int)((y0 - ws.gy) / ws.cell_h)));
+    r1 = std::max(r0, std::min(ws.rows - 1, (int)((y1 - ws.gy) / ws.cell_h)));
+}
+
+static void grid_insert(nms_workspace &ws, int id, float x0, float y0, float x1, float y1)
+{
+    int c0, r0, c1, r1;
+    grid_span(ws, x0, y0, x1, y1, c0, r0, c1, r1);
+    for (int r = r0; r <= r1; r++)
+        for (int c = c0; c <= c1; c++) {
+            std::vector<int> &cell = ws.cells[r * ws.cols + c];
+            if (cell.empty()) ws.touched.push_back(r * ws.cols + c);
+            cell.push_back(id);
+        }
+}
+
+// ---- hard NMS ----
+
+// is candidate i suppressed by a kept box of its group?
+static bool suppressed(nms_workspace &ws, int i, bool grid, float thr)
+{
+    const float x0 = ws.x0[i], y0 = ws.y0[i], x1 = ws.x1[i], y1 = ws.y1[i], a = ws.area[i];
+    if (!grid) {
+        for (size_t k = 0; k < ws.kx0.size(); k++)
+            if (iou_soa(x0, y0, x1, y1, a, ws.kx0[k], ws.ky0[k], ws.kx1[k], ws.ky1[k], ws.karea[k]) > thr)
+                return true;
+        return false;
+    }
+
+    int c0, r0, c1, r1;
+    grid_span(ws, x0, y0, x1, y1, c0, r0, c1, r1);
+    for (int r = r0; r <= r1; r++)
+        for (int c = c0; c <= c1; c++) {
+            const std::vector<int> &cell = ws.cells[r * ws.cols + c];
+            for (size_t j = 0; j < cell.size(); j++) {
+                const int k = cell[j];
+                if (ws.stamp[k] == i) continue;     // already compared via another cell
+                ws.stamp[k] = i;
+                if (iou_soa(x0, y0, x1, y1, a, ws.kx0[k], ws.ky0[k], ws.kx1[k], ws.ky1[k], ws.karea[k]) > thr)
+                    return true;
+            }
+        }
+    return false;
+}
+
+static void hard_group(nms_workspace &ws, int g0, int g1, const nms_config &cfg)
+{
+    const bool grid = cfg.use_grid && g1 - g0 >= MIN_GRID_BOXES;
+    if (grid) grid_begin(ws, g0, g1);
+    ws.kx0.clear();
+    ws.ky0.clear();
+    ws.kx1.clear();
+    ws.ky1.clear();
+    ws.karea.clear();
+    ws.stamp.clear();
+
+    for (int i = g0; i < g1; i++) {
+        if (suppressed(ws, i, grid, cfg.iou_thresh)) continue;
+        const int k = (int)ws.kx0.size();
+        ws.kx0.push_back(ws.x0[i]);
+        ws.ky0.push_back(ws.y0[i]);
+        ws.kx1.push_back(ws.x1[i]);
+        ws.ky1.push_back(ws.y1[i]);
+        ws.karea.push_back(ws.area[i]);
+        ws.stamp.push_back(-1);
+        if (grid) grid_insert(ws, k, ws.x0[i], ws.y0[i], ws.x1[i], ws.y1[i]);
+        ws.keep.push_back(ws.src[i]);
+        ws.keep_score.push_back(ws.score[i]);
+    }
+}
+
+// ---- soft-NMS ----
+
+static inline bool heap_less(const nms_heap_entry &a, const nms_heap_entry &b)
+{
+    return a.score < b.score || (a.score == b.score && a.i > b.i);
+}
+
+static void soft_decay(nms_workspace &ws, int m, int j, const nms_config &cfg)
+{
+    if (ws.state[j] != PENDING) return;
+    const float iou = iou_soa(ws.x0[m], ws.y0[m], ws.x1[m], ws.y1[m], ws.area[m],
+                              ws.x0[j], ws.y0[j], ws.x1[j], ws.y1[j], ws.area[j]);
+    if (iou <= 0) return;
+    float s = ws.score[j];
+    if (cfg.method == NMS_SOFT_LINEAR) {
+        if (iou <= cfg.iou_thresh) return;
+        s *= 1 - iou;
+    } else {
+        s *= expf(-iou * iou / cfg.soft_sigma);
+    }
+    ws.score[j] = s;
+    if (s < cfg.soft_min_score) {
+        ws.state[j] = DROPPED;
+        return;
+    }
+    // the old heap entry goes stale (score no longer matches)
+    nms_heap_entry e = {s, j};
+    ws.heap.push_back(e);
+    std::push_heap(ws.heap.begin(), ws.heap.end(), heap_less);
+}
+
+static void soft_group(nms_workspace &ws, int g0, int g1, const nms_config &cfg)
+{
+    const bool grid = cfg.use_grid && g1 - g0 >= MIN_GRID_BOXES;
+    if (grid) {
+        grid_begin(ws, g0, g1);
+        for (int i = g0; i < g1; i++) grid_insert(ws, i, ws.x0[i], ws.y0[i], ws.x1[i], ws.y1[i]);
+    }
+
+    ws.heap.clear();
+    for (int i = g0; i < g1; i++) {
+        ws.state[i] = ws.score[i] < cfg.soft_min_score ? DROPPED : PENDING;
+        ws.stamp[i] = -1;
+        if (ws.state[i] != PENDING) continue;
+        nms_heap_entry e = {ws.score[i], i};
+        ws.heap.push_back(e);
+    }
+    std::make_heap(ws.heap.begin(), ws.heap.end(), heap_less);
+
+    while (!ws.heap.empty()) {
+        std::pop_heap(ws.heap.begin(), ws.heap.end(), heap_less);
+        const nms_heap_entry top = ws.heap.back();
+        ws.heap.pop_back();
+        const int m = top.i;
+        if (ws.state[m] != PENDING || top.score != ws.score[m]) continue;   // taken, dropped or stale
+
+        ws.state[m] = TAKEN;
+        ws.keep.push_back(ws.src[m]);
+        ws.keep_score.push_back(ws.score[m]);
+
+        if (!grid) {
+            for (int j = g0; j < g1; j++) soft_decay(ws, m, j, cfg);
+            continue;
+        }
+        int c0, r0, c1, r1;
+        grid_span(ws, ws.x0[m], ws.y0[m], ws.x1[m], ws.y1[m], c0, r0, c1, r1);
+        for (int r = r0; r <= r1; r++)
+            for (int c = c0; c <= c1; c++) {
+                const std::vector<int> &cell = ws.cells[r * ws.cols + c];
+                for (size_t k = 0; k < cell.size(); k++) {
+                    const int j = cell[k];
+                    if (ws.stamp[j] == m) continue;
+                    ws.stamp[j] = m;
+                    soft_decay(ws, m, j, cfg);
+                }
+            }
+    }
+}
+
+int nms_run(nms_workspace &ws, const nms_box *boxes, int n, const nms_config &cfg)
+{
+    ws.keep.clear();
+    ws.keep_score.clear();
+    if (n <= 0) return 0;
+
+    prepare(ws, boxes, n, cfg);
+    const int m = (int)ws.src.size();
+    const bool soft = cfg.method != NMS_HARD;
+    if (soft) {
+        ws.state.resize(m);
+        ws.stamp.resize(m);
+    }
+
+    // one group per class (or a single group)
+    for (int g0 = 0; g0 < m;) {
+        int g1 = g0 + 1;
+        if (cfg.per_class)
+            while (g1 < m && ws.label[g1] == ws.label[g0]) g1++;
+        else
+            g1 = m;
+        if (soft)
+            soft_group(ws, g0, g1, cfg);
+        else
+            hard_group(ws, g0, g1, cfg);
+        g0 = g1;
+    }
+    grid_clear(ws);
+
+    // best score first over all classes
+    const size_t k = ws.keep.size();
+    if (cfg.per_class || soft) {
+        std::vector<int> &idx = ws.order;
+        idx.resize(k);
+        for (size_t i = 0; i < k; i++) idx[i] = (int)i;
+        std::sort(idx.begin(), idx.end(), [&ws](int a, int b) {
+            const float sa = ws.keep_score[a], sb = ws.keep_score[b];
+            return sa > sb || (sa == sb && ws.keep[a] < ws.keep[b]);
+        });
+        // permute through the (now unused) SoA score / src scratch
+        ws.src.resize(k);
+        ws.score.resize(k);
+        for (size_t i = 0; i < k; i++) {
+            ws.src[i] = ws.keep[idx[i]];
+            ws.score[i] = ws.keep_score[idx[i]];
+        }
+        ws.keep.swap(ws.src);
+        ws.keep_score.swap(ws.score);
+    }
+    return (int)k;
+}
@@ -0,0 +1,95 @@
+#ifndef NMS_H
+#define NMS_H
+
+#include <stdint.h>
+#include <vector>
+
+// ================== Non-maximum suppression ==================
+// Shared by the Lab5 detectors. Compared to the plain "every candidate
+// against every kept box" loop:
+//   - boxes are suppressed per class by default (a cup no longer removes
+//     the bottle behind it), each class on its own;
+//   - kept boxes are bucketed in a uniform grid over the candidates'
+//     extent (cell about the average box size), so a candidate is only
+//     compared with kept boxes in the cells it covers; boxes that do not
+//     share a cell cannot overlap;
+//   - coordinates and areas are copied once into flat arrays (SoA), so
+//     no area is recomputed per comparison;
+//   - candidates are ordered with a radix sort on the score bits (linear,
+//     stable) and top_k keeps only the k best of them;
+//   - soft-NMS (linear or Gaussian) lowers the scores of overlapping
+//     boxes instead of dropping them; the best remaining box is taken
+//     from a heap, so it also stays close to n log n.
+// Hard NMS keeps exactly the boxes the plain loop keeps (IoU > iou_thresh
+// suppresses, ties in score go to the earlier candidate).
+//
+// The workspace keeps its buffers between calls; one per thread.
+
+struct nms_box {
+    float x0, y0, x1, y1;
+    float score;
+    int label;
+};
+
+enum nms_method {
+    NMS_HARD,
+    NMS_SOFT_LINEAR,        // score *= 1 - IoU when IoU > iou_thresh
+    NMS_SOFT_GAUSSIAN       // score *= exp(-IoU^2 / sigma)
+};
+
+struct nms_config {
+    float iou_thresh = 0.45f;
+    bool per_class = true;          // false: any class suppresses any other
+    int top_k = 0;                  // candidates kept before NMS (0 = all)
+    nms_method method = NMS_HARD;
+    float soft_sigma = 0.5f;        // NMS_SOFT_GAUSSIAN
+    float soft_min_score = 0.001f;  // soft-NMS drops boxes that decay below this
+    bool use_grid = true;           // false: compare with every kept box (benchmarks)
+};
+
+struct nms_heap_entry {
+    float score;
+    int i;
+};
+
+// sorted without going back to the boxes
+struct nms_sort_key {
+    int label;
+    float score;
+    int i;
+};
+
+struct nms_workspace {
+    std::vector<nms_sort_key> keys, keys_tmp;   // top-K / ordering
+    std::vector<uint32_t> hist;
+    // candidates after top-K, in processing order (SoA)
+    std::vector<int> src;               // index into the caller's boxes
+    std::vector<float> x0, y0, x1, y1, area, score;
+    std::vector<int> label;
+
+    // kept boxes of the current class (SoA, hard NMS)
+    std::vector<float> kx0, ky0, kx1, ky1, karea;
+
+    // grid: indices of boxes per cell, cells touched (to clear)
+    std::vector<std::vector<int> > cells;
+    std::vector<int> touched;
+    std::vector<int> stamp;
+    float gx, gy, cell_w, cell_h;
+    int cols, rows;
+
+    std::vector<int> order;             // scratch
+    std::vector<char> state;            // soft-NMS: pending / taken / dropped
+    std::vector<nms_heap_entry> heap;
+
+    // result of the last nms_run(): indices into boxes, best score first,
+    // and the scores they ended with (lowered by soft-NMS)
+    std::vector<int> keep;
+    std::vector<float> keep_score;
+};
+
+// Suppress n boxes; returns keep.size().
+int nms_run(nms_workspace &ws, const nms_box *boxes, int n, const nms_config &cfg);
+
+float nms_iou(const nms_box &a, const nms_box &b);
+
+#endif
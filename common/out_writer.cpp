@@ -0,0 +1,153 @@
+#include "out_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+typedef std::chrono::steady_clock out_clock;
+
+static int64_t us_since(out_clock::time_point t0)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(out_clock::now() - t0).count();
+}
+
+static std::string dir_of(const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+bool durable_write_file(const std::string &path, const void *data, size_t len, std::string &dir)
+{
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[ERR] open " << tmp << ": " << strerror(errno) << "\n";
+        return false;
+    }
+
+    const char *p = (const char *)data;
+    size_t left = len;
+    bool ok = true;
+    while (left > 0) {
+        const ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "[ERR] write " << tmp << ": " << strerror(n < 0 ? errno : EIO) << "\n";
+            ok = false;
+            break;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    // data and size only: the file's other metadata doesn't matter here
+    if (ok && ::fdatasync(fd) != 0) {
+        std::cerr << "[ERR] fdatasync " << tmp << ": " << strerror(errno) << "\n";
+        ok = false;
+    }
+    if (::close(fd) != 0 && ok) {
+        std::cerr << "[ERR] close " << tmp << ": " << strerror(errno) << "\n";
+        ok = false;
+    }
+    if (ok && ::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "[ERR] rename " << tmp << ": " << strerror(errno) << "\n";
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    dir = dir_of(path);
+    return true;
+}
+
+bool durable_sync_dir(const std::string &dir)
+{
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[ERR] open " << dir << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    if (!ok) std::cerr << "[ERR] fsync " << dir << ": " << strerror(errno) << "\n";
+    ::close(fd);
+    return ok;
+}
+
+static void sync_dirty_dirs(out_writer &w)
+{
+    if (w.dirty_dirs.empty()) return;
+    out_clock::time_point t0 = out_clock::now();
+    for (const std::string &dir : w.dirty_dirs) durable_sync_dir(dir);
+    w.stats.dir_sync_us += us_since(t0);
+    w.stats.dir_syncs += w.dirty_dirs.size();
+    w.dirty_dirs.clear();
+    w.dirty_files = 0;
+}
+
+static void writer_loop(out_writer *w)
+{
+    std::vector<unsigned char> bytes;
+    std::string dir;
+    out_job job;
+    while (w->queue.pop(job)) {
+        out_clock::time_point t0 = out_clock::now();
+        bytes.clear();
+        const bool encoded = job.encode(bytes);
+        w->stats.encode_us += us_since(t0);
+        job.encode = nullptr;       // drop what the callback holds (the image) now
+
+        out_clock::time_point t1 = out_clock::now();
+        if (encoded && durable_write_file(job.path, bytes.data(), bytes.size(), dir)) {
+            w->stats.files++;
+            w->stats.bytes += bytes.size();
+            if (std::find(w->dirty_dirs.begin(), w->dirty_dirs.end(), dir) == w->dirty_dirs.end())
+                w->dirty_dirs.push_back(dir);
+            w->dirty_files++;
+        } else {
+            if (!encoded) std::cerr << "[ERR] encode failed: " << job.path << "\n";
+            w->stats.failed++;
+        }
+        w->stats.write_us += us_since(t1);
+
+        // nothing else waiting, or enough renames piled up: make them durable
+        if (w->dirty_files >= w->cfg.dir_sync_files || w->queue.size() == 0) sync_dirty_dirs(*w);
+    }
+    sync_dirty_dirs(*w);
+}
+
+void out_writer_start(out_writer &w)
+{
+    w.thread = std::thread(writer_loop, &w);
+}
+
+bool out_writer_submit(out_writer &w, const std::string &path, out_encode_fn encode)
+{
+    out_job job;
+    job.path = path;
+    job.encode = std::move(encode);
+    return w.queue.push(std::move(job));
+}
+
+void out_writer_stop(out_writer &w)
+{
+    w.queue.close();
+    if (w.thread.joinable()) w.thread.join();
+}
+
+void out_writer_report(const out_writer &w, const char *tag)
+{
+    const out_writer_stats &s = w.stats;
+    const uint64_t n = s.files + s.failed;
+    if (!n) return;
+    printf("[%s] %llu files written (%llu failed), %.1f MB; per file: encode %.1f ms, write+fdatasync %.1f ms; "
+           "%llu directory fsyncs (%.1f ms total)\n",
+           tag, (unsigned long long)s.files, (unsigned long long)s.failed, s.bytes / 1e6, s.encode_us / 1000.0 / n,
+           s.write_us / 1000.0 / n, (unsigned long long)s.dir_syncs, s.dir_sync_us / 1000.0);
+}
@@ -0,0 +1,81 @@
+#ifndef OUT_WRITER_H
+#define OUT_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+
+// ================== Durable output writer ==================
+// Result files (JPEGs) written from a worker thread so the caller never
+// waits on the encoder or the disk. Each file is encoded on that thread,
+// written to `<path>.tmp`, fdatasync()ed and renamed over `path`: a
+// reader or a power cut sees the old file or the whole new one, never a
+// torn one, and only this file's pages are flushed (a global sync()
+// writes back every dirty page in the system and can stall for seconds).
+//
+// The rename itself is durable only once the directory is fsync()ed.
+// That is done for all directories touched since the last time, every
+// dir_sync_files files and whenever the queue runs empty, so a batch
+// pays one directory flush per dir_sync_files images instead of one each.
+//
+// submit() blocks while `queue` files are waiting (back-pressure on the
+// producer, like the pipeline queues). stop() writes out what is queued
+// and does the last directory flush; the stats are read after it.
+
+struct out_writer_config {
+    size_t queue = 8;               // files waiting to be encoded / written
+    int dir_sync_files = 32;        // directory fsync at least every this many files (1: each file)
+};
+
+// Fills the file's bytes; false: encoding failed, nothing is written.
+typedef std::function<bool(std::vector<unsigned char> &out)> out_encode_fn;
+
+struct out_writer_stats {
+    uint64_t files = 0, failed = 0, bytes = 0;
+    uint64_t dir_syncs = 0;
+    int64_t encode_us = 0;          // encode callbacks
+    int64_t write_us = 0;           // temp file write + fdatasync + rename
+    int64_t dir_sync_us = 0;
+};
+
+struct out_job {
+    std::string path;
+    out_encode_fn encode;
+};
+
+struct out_writer {
+    explicit out_writer(const out_writer_config &cfg = out_writer_config()) : cfg(cfg), queue(cfg.queue) {}
+
+    out_writer_config cfg;
+    bounded_queue<out_job> queue;
+    std::thread thread;
+    std::vector<std::string> dirty_dirs;    // renamed into, not fsync()ed yet
+    int dirty_files = 0;
+    out_writer_stats stats;                 // writer thread only until stop()
+};
+
+void out_writer_start(out_writer &w);
+
+// Queue one file; false once the writer has been stopped.
+bool out_writer_submit(out_writer &w, const std::string &path, out_encode_fn encode);
+
+// Write everything queued, flush the directories and join the thread.
+void out_writer_stop(out_writer &w);
+
+// "[<tag>]" line: files, failures, MB written, mean encode / write time
+// and directory flushes.
+void out_writer_report(const out_writer &w, const char *tag);
+
+// The synchronous path of one file (temp, fdatasync, rename), without the
+// directory flush; the directory is returned in dir. Prints [ERR] and
+// returns false on failure.
+bool durable_write_file(const std::string &path, const void *data, size_t len, std::string &dir);
+
+// fsync() a directory so renames into it survive a power cut.
+bool durable_sync_dir(const std::string &dir);
+
+#endif
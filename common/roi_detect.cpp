@@ -0,0 +1,133 @@
+#include "roi_detect.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+struct roi_square {
+    float x0, y0, side;
+};
+
+// a square of `side` centred on (cx, cy), moved inside the frame
+static roi_square place(float cx, float cy, float side, int frame_w, int frame_h)
+{
+    roi_square s;
+    s.side = side;
+    s.x0 = std::min(std::max(cx - side / 2, 0.f), frame_w - side);
+    s.y0 = std::min(std::max(cy - side / 2, 0.f), frame_h - side);
+    return s;
+}
+
+static bool overlap(const roi_square &a, const roi_square &b)
+{
+    return a.x0 < b.x0 + b.side && b.x0 < a.x0 + a.side && a.y0 < b.y0 + b.side && b.y0 < a.y0 + a.side;
+}
+
+bool roi_plan_make(const roi_config &cfg, const trk_box *boxes, int n, int frame_w, int frame_h,
+                   int64_t t_us, int64_t last_full_us, roi_plan &plan)
+{
+    if (n <= 0 || !last_full_us || t_us - last_full_us >= (int64_t)(cfg.full_interval_s * 1e6)) return false;
+
+    // crops can't be bigger than the frame's shorter side (they are square)
+    const float max_side = (float)std::min(frame_w, frame_h);
+    const float min_side = std::min(cfg.min_crop * std::max(frame_w, frame_h), max_side);
+
+    // one square per box, then merge overlapping ones until none overlap
+    // (more than ROI_MAX kept apart: a full pass is cheaper anyway)
+    roi_square sq[ROI_MAX];
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        const trk_box &b = boxes[i];
+        if (b.w <= 0 || b.h <= 0) continue;
+        const float side = std::min(std::max(std::max(b.w, b.h) * cfg.expand, min_side), max_side);
+        roi_square s = place(b.x + b.w / 2, b.y + b.h / 2, side, frame_w, frame_h);
+
+        for (int j = 0; j < count;) {
+            if (!overlap(s, sq[j])) {
+                j++;
+                continue;
+            }
+            const float x0 = std::min(s.x0, sq[j].x0), y0 = std::min(s.y0, sq[j].y0);
+            const float x1 = std::max(s.x0 + s.side, sq[j].x0 + sq[j].side);
+            const float y1 = std::max(s.y0 + s.side, sq[j].y0 + sq[j].side);
+            const float side = std::max(x1 - x0, y1 - y0);
+            if (side > max_side) return false;
+            s = place((x0 + x1) / 2, (y0 + y1) / 2, side, frame_w, frame_h);
+            sq[j] = sq[--count];        // merged into s; check s against all again
+            j = 0;
+        }
+        if (count == ROI_MAX) return false;
+        sq[count++] = s;
+    }
+    if (count == 0) return false;
+
+    float area = 0;
+    for (int i = 0; i < count; i++) area += sq[i].side * sq[i].side;
+    if (area > cfg.max_cover * frame_w * frame_h) return false;
+
+    const int cols = count > 1 ? 2 : 1, rows = count > 2 ? 2 : 1;
+    plan.n = count;
+    plan.cell = cfg.cell;
+    plan.cols = cols;
+    plan.rows = rows;
+    plan.in_w = cols * cfg.cell;
+    plan.in_h = rows * cfg.cell;
+    for (int i = 0; i < count; i++) {
+        roi_tile &t = plan.tile[i];
+        t.x = (int)lroundf(sq[i].x0);
+        t.y = (int)lroundf(sq[i].y0);
+        t.w = t.h = std::min((int)lroundf(sq[i].side), std::min(frame_w - t.x, frame_h - t.y));
+        t.cell_x = i % cols * cfg.cell;
+        t.cell_y = i / cols * cfg.cell;
+        t.scale = 1;
+        t.pad_x = t.pad_y = 0;
+    }
+    return true;
+}
+
+bool roi_map_box(const roi_plan &plan, float &x0, float &y0, float &x1, float &y1)
+{
+    const float cx = (x0 + x1) / 2, cy = (y0 + y1) / 2;
+    for (int i = 0; i < plan.n; i++) {
+        const roi_tile &t = plan.tile[i];
+        const float px0 = (float)(t.cell_x + t.pad_x), py0 = (float)(t.cell_y + t.pad_y);
+        const float px1 = px0 + t.w * t.scale, py1 = py0 + t.h * t.scale;
+        if (cx < px0 || cx >= px1 || cy < py0 || cy >= py1) continue;
+
+        x0 = (std::max(x0, px0) - px0) / t.scale + t.x;
+        y0 = (std::max(y0, py0) - py0) / t.scale + t.y;
+        x1 = (std::min(x1, px1) - px0) / t.scale + t.x;
+        y1 = (std::min(y1, py1) - py0) / t.scale + t.y;
+        return true;
+    }
+    return false;
+}
+
+void roi_record(roi_stats &st, bool roi, int64_t extract_us)
+{
+    if (roi) {
+        st.roi++;
+        st.roi_us += extract_us;
+    } else {
+        st.full++;
+        st.full_us += extract_us;
+    }
+}
+
+void roi_report(const roi_stats &st)
+{
+    const uint64_t total = st.full + st.roi;
+    if (!total) return;
+    const double full_ms = st.full ? st.full_us / 1000.0 / st.full : 0;
+    const double roi_ms = st.roi ? st.roi_us / 1000.0 / st.roi : 0;
+    printf("[ROI] %llu of %llu detections from ROI passes (%.0f%%); extract mean: full frame %.1f ms, ROI %.1f ms\n",
+           (unsigned long long)st.roi, (unsigned long long)total, 100.0 * st.roi / total, full_ms, roi_ms);
+
+    // what the ROI passes would have cost as full passes
+    if (st.full && st.roi) {
+        const double all_full_ms = full_ms * total;
+        const double spent_ms = (st.full_us + st.roi_us) / 1000.0;
+        printf("[ROI] extract CPU %.0f ms instead of ~%.0f ms all full-frame: %.0f%% saved\n", spent_ms,
+               all_full_ms, 100.0 * (1 - spent_ms / all_full_ms));
+    }
+}
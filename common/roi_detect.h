@@ -0,0 +1,70 @@
+#ifndef ROI_DETECT_H
+#define ROI_DETECT_H
+
+#include <stdint.h>
+#include "box_tracker.h"
+
+// ================== Region-of-interest re-detection ==================
+// Between full-frame detections, run the detector only on crops around
+// the objects already tracked. Each track's box is expanded (motion since
+// the last detection, context for the detector) into a square crop;
+// overlapping crops are merged. Up to ROI_MAX crops are letterboxed into
+// the cells of one mosaic input (1: 1x1, 2: 2x1, 3-4: 2x2 cells of `cell`
+// pixels), so a frame with one or two objects costs a 160x160 or 320x160
+// extract instead of a full 320x320 one. Detections found in a cell are
+// mapped back into frame coordinates.
+//
+// A full frame is still needed to find new objects: roi_plan_make()
+// declines (returns false) when a full pass is due (full_interval_s),
+// nothing is tracked, there are more crops than ROI_MAX, or the crops
+// would cover more than max_cover of the frame.
+
+#define ROI_MAX 4
+
+struct roi_config {
+    int cell = 160;                 // input pixels per crop (multiple of 32)
+    float expand = 1.6f;            // crop side = longer box side * expand
+    float min_crop = 0.15f;         // ... and at least this part of the frame's longer side
+    float max_cover = 0.5f;         // crops covering more of the frame: full frame instead
+    double full_interval_s = 1.0;   // full-frame pass at least this often
+};
+
+// One crop: where it is in the frame and where it went in the input.
+struct roi_tile {
+    int x, y, w, h;                 // crop in the frame
+    int cell_x, cell_y;             // cell corner in the input
+    float scale;                    // frame -> input, set by the letterbox
+    int pad_x, pad_y;               // picture inside the cell, set by the letterbox
+};
+
+struct roi_plan {
+    int n;
+    roi_tile tile[ROI_MAX];
+    int cell, cols, rows;           // cols x rows cells of cell x cell
+    int in_w, in_h;                 // mosaic input size
+};
+
+// Plan an ROI pass around boxes (frame coordinates) of a frame_w x frame_h
+// frame launched at t_us; false when this frame should be a full pass.
+// last_full_us: launch time of the previous full pass (0: none yet).
+bool roi_plan_make(const roi_config &cfg, const trk_box *boxes, int n, int frame_w, int frame_h,
+                   int64_t t_us, int64_t last_full_us, roi_plan &plan);
+
+// Map a box from input coordinates of an ROI pass back into the frame.
+// The box goes to the cell holding its centre and is clipped to that
+// cell's picture; false when the centre is on no picture (padding).
+bool roi_map_box(const roi_plan &plan, float &x0, float &y0, float &x1, float &y1);
+
+// Full vs ROI passes and their extract time, from the extract thread.
+struct roi_stats {
+    uint64_t full = 0, roi = 0;
+    int64_t full_us = 0, roi_us = 0;
+};
+
+void roi_record(roi_stats &st, bool roi, int64_t extract_us);
+
+// "[ROI]" lines: share of detections from ROI passes, mean extract time
+// of each kind and the extract time saved against all-full-frame.
+void roi_report(const roi_stats &st);
+
+#endif
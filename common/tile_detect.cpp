@@ -0,0 +1,76 @@
+#include "tile_detect.h"
+
+#include <math.h>
+#include <algorithm>
+
+// tile origins along one side of `len` pixels, spread evenly so that
+// neighbours share at least the requested overlap
+static void tile_origins(int len, int tile, float overlap, std::vector<int> &at)
+{
+    at.clear();
+    if (len <= tile) {
+        at.push_back(0);
+        return;
+    }
+    const float step = std::max(1.f, tile * (1 - overlap));
+    const int count = (int)ceilf((len - tile) / step) + 1;
+    for (int i = 0; i < count; i++) at.push_back((int)lroundf((float)i * (len - tile) / (count - 1)));
+}
+
+int tile_grid(const tile_config &cfg, int img_w, int img_h, std::vector<tile_rect> &tiles)
+{
+    std::vector<int> xs, ys;
+    tile_origins(img_w, cfg.tile, cfg.overlap, xs);
+    tile_origins(img_h, cfg.tile, cfg.overlap, ys);
+
+    tiles.clear();
+    for (size_t j = 0; j < ys.size(); j++) {
+        for (size_t i = 0; i < xs.size(); i++) {
+            tile_rect t = {xs[i], ys[j], std::min(cfg.tile, img_w), std::min(cfg.tile, img_h)};
+            tiles.push_back(t);
+        }
+    }
+    return (int)tiles.size();
+}
+
+bool tile_box_keep(const tile_config &cfg, const tile_rect &t, int img_w, int img_h, const nms_box &b)
+{
+    const float ov = cfg.tile * cfg.overlap, m = cfg.edge_margin;
+    const bool small_w = b.x1 - b.x0 <= ov, small_h = b.y1 - b.y0 <= ov;
+
+    if (small_w && t.x > 0 && b.x0 <= t.x + m) return false;
+    if (small_w && t.x + t.w < img_w && b.x1 >= t.x + t.w - m) return false;
+    if (small_h && t.y > 0 && b.y0 <= t.y + m) return false;
+    if (small_h && t.y + t.h < img_h && b.y1 >= t.y + t.h - m) return false;
+    return true;
+}
+
+// intersection over the smaller of the two areas
+static float ios(const nms_box &a, const nms_box &b)
+{
+    const float w = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
+    const float h = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
+    if (w <= 0 || h <= 0) return 0;
+    const float area_a = (a.x1 - a.x0) * (a.y1 - a.y0), area_b = (b.x1 - b.x0) * (b.y1 - b.y0);
+    return w * h / std::min(area_a, area_b);
+}
+
+int tile_merge(nms_workspace &ws, const tile_config &cfg, const nms_box *boxes, int n, std::vector<int> &keep)
+{
+    nms_config nc;
+    nc.iou_thresh = cfg.iou_thresh;
+    const int k = nms_run(ws, boxes, n, nc);
+
+    // the NMS survivors are few: plain loop, best first
+    keep.clear();
+    for (int i = 0; i < k; i++) {
+        const nms_box &b = boxes[ws.keep[i]];
+        bool covered = false;
+        for (size_t j = 0; j < keep.size() && !covered; j++) {
+            const nms_box &a = boxes[keep[j]];
+            covered = a.label == b.label && ios(a, b) > cfg.ios_thresh;
+        }
+        if (!covered) keep.push_back(ws.keep[i]);
+    }
+    return (int)keep.size();
+}
@@ -0,0 +1,47 @@
+#ifndef TILE_DETECT_H
+#define TILE_DETECT_H
+
+#include <vector>
+#include "nms.h"
+
+// ================== Tiled (sliced) inference ==================
+// For small objects in big images: instead of scaling the whole image down
+// to one large network input, cut it into overlapping tile x tile slices
+// at the model's own input size (1:1, no downscaling), detect on each and
+// merge the results (SAHI-style slicing).
+//
+// The grid covers the image with `overlap` (a fraction of the tile) shared
+// between neighbours; the last row / column is moved back inside the image
+// rather than padded. An object cut by a tile border lies whole in the
+// neighbouring tile when it is smaller than the overlap, so boxes touching
+// an inner border (within edge_margin) and no larger than the overlap are
+// dropped. What is left is merged across tiles with NMS (nms.h, per class)
+// and then by intersection over the smaller box (ios_thresh): a piece of
+// an object cut by one tile inside the full box from another has a low IoU
+// but an IoS near 1.
+
+struct tile_config {
+    int tile = 640;                 // tile side, the model's input size
+    float overlap = 0.2f;           // part of a tile shared with the neighbour
+    float edge_margin = 2;          // pixels: a box this close to an inner border touches it
+    float iou_thresh = 0.45f;       // cross-tile NMS
+    float ios_thresh = 0.6f;        // cross-tile intersection over the smaller box
+};
+
+struct tile_rect {
+    int x, y, w, h;
+};
+
+// Tiles covering an img_w x img_h image (one tile of the whole image when
+// it is not bigger than a tile). Returns the count.
+int tile_grid(const tile_config &cfg, int img_w, int img_h, std::vector<tile_rect> &tiles);
+
+// Keep a box found in tile t (image coordinates)? False when it touches a
+// border shared with another tile and would fit inside the overlap there.
+bool tile_box_keep(const tile_config &cfg, const tile_rect &t, int img_w, int img_h, const nms_box &b);
+
+// Merge boxes from all tiles (and an optional whole-image pass): NMS, then
+// the IoS pass. Indices of the kept boxes, best first, end up in keep.
+int tile_merge(nms_workspace &ws, const tile_config &cfg, const nms_box *boxes, int n, std::vector<int> &keep);
+
+#endif
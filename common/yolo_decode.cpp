@@ -0,0 +1,139 @@
+#include "yolo_decode.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include "fb_pack.h"    // SIMD flavour selection (FB_SIMD_*, FB_NO_SIMD)
+
+// proposals per block: best / best_cls of a block stay in L1 while all the
+// class rows go past
+static const int BLOCK = 1024;
+
+void yolo_decoder_init(yolo_decoder &d, int num_classes, const int *classes, int n_classes, yolo_subset_mode mode)
+{
+    d.num_classes = num_classes;
+    d.mode = mode;
+    d.rows.clear();
+    d.wanted.assign(num_classes, classes && n_classes > 0 ? 0 : 1);
+    for (int i = 0; classes && i < n_classes; i++)
+        if (classes[i] >= 0 && classes[i] < num_classes) d.wanted[classes[i]] = 1;
+    for (int c = 0; c < num_classes; c++)
+        if (d.wanted[c] || mode == YOLO_SUBSET_FILTER) d.rows.push_back(c);
+    d.out.clear();
+}
+
+// best[i] / cls[i] = max / argmax so far; strictly greater wins, so the
+// lowest class id is kept on ties (as the scalar loop does)
+static void row_argmax(const float *row, float *best, int32_t *cls, int32_t c, int n)
+{
+    int i = 0;
+#if defined(FB_SIMD_AVX2)
+    const __m256i vc8 = _mm256_set1_epi32(c);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(row + i), m = _mm256_loadu_ps(best + i);
+        __m256 gt = _mm256_cmp_ps(v, m, _CMP_GT_OQ);
+        _mm256_storeu_ps(best + i, _mm256_blendv_ps(m, v, gt));
+        __m256 k = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(cls + i)));
+        k = _mm256_blendv_ps(k, _mm256_castsi256_ps(vc8), gt);
+        _mm256_storeu_si256((__m256i *)(cls + i), _mm256_castps_si256(k));
+    }
+#endif
+#if defined(FB_SIMD_SSE2)
+    const __m128i vc = _mm_set1_epi32(c);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(row + i), m = _mm_loadu_ps(best + i);
+        __m128 gt = _mm_cmpgt_ps(v, m);
+        _mm_storeu_ps(best + i, _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, m)));
+        __m128i g = _mm_castps_si128(gt);
+        __m128i k = _mm_loadu_si128((const __m128i *)(cls + i));
+        _mm_storeu_si128((__m128i *)(cls + i), _mm_or_si128(_mm_and_si128(g, vc), _mm_andnot_si128(g, k)));
+    }
+#endif
+#if defined(FB_SIMD_NEON)
+    const int32x4_t vc = vdupq_n_s32(c);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vld1q_f32(row + i), m = vld1q_f32(best + i);
+        uint32x4_t gt = vcgtq_f32(v, m);
+        vst1q_f32(best + i, vbslq_f32(gt, v, m));
+        vst1q_s32(cls + i, vbslq_s32(gt, vc, vld1q_s32(cls + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        if (row[i] > best[i]) {
+            best[i] = row[i];
+            cls[i] = c;
+        }
+    }
+}
+
+int yolo_decode(yolo_decoder &d, const float *data, size_t row_step, int rows, int num, float conf_thresh)
+{
+    d.out.clear();
+    const bool has_obj = rows == 5 + d.num_classes;
+    const int cls_start = has_obj ? 5 : 4;
+    if (rows < cls_start + d.num_classes || num <= 0) return 0;
+
+    d.best.resize(num);
+    d.best_cls.resize(num);
+    float *best = d.best.data();
+    int32_t *cls = d.best_cls.data();
+
+    for (int b0 = 0; b0 < num; b0 += BLOCK) {
+        const int n = std::min(BLOCK, num - b0);
+        std::fill(best + b0, best + b0 + n, 0.f);
+        std::fill(cls + b0, cls + b0 + n, -1);
+        for (size_t r = 0; r < d.rows.size(); r++) {
+            const int c = d.rows[r];
+            row_argmax(data + (cls_start + c) * row_step + b0, best + b0, cls + b0, c, n);
+        }
+    }
+
+    const float *cx = data, *cy = data + row_step, *w = data + 2 * row_step, *h = data + 3 * row_step;
+    const float *obj = has_obj ? data + 4 * row_step : NULL;
+    for (int i = 0; i < num; i++) {
+        if (cls[i] < 0) continue;
+        float score = best[i];
+        if (obj) {
+            if (obj[i] < conf_thresh) continue;
+            score *= obj[i];
+        }
+        if (score < conf_thresh) continue;
+        if (d.mode == YOLO_SUBSET_FILTER && !d.wanted[cls[i]]) continue;
+
+        yolo_candidate c;
+        c.x0 = cx[i] - w[i] / 2;
+        c.y0 = cy[i] - h[i] / 2;
+        c.x1 = cx[i] + w[i] / 2;
+        c.y1 = cy[i] + h[i] / 2;
+        c.score = score;
+        c.label = cls[i];
+        d.out.push_back(c);
+    }
+    return (int)d.out.size();
+}
+
+bool yolo_save_tensor(const char *path, const float *data, size_t row_step, int rows, int num)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    int32_t dims[2] = {rows, num};
+    bool ok = fwrite(dims, sizeof(dims), 1, f) == 1;
+    for (int r = 0; ok && r < rows; r++)
+        ok = fwrite(data + r * row_step, sizeof(float), num, f) == (size_t)num;
+    return fclose(f) == 0 && ok;
+}
+
+bool yolo_load_tensor(const char *path, std::vector<float> &data, int &rows, int &num)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    int32_t dims[2];
+    bool ok = fread(dims, sizeof(dims), 1, f) == 1 && dims[0] > 0 && dims[1] > 0;
+    if (ok) {
+        rows = dims[0];
+        num = dims[1];
+        data.resize((size_t)rows * num);
+        ok = fread(data.data(), sizeof(float), data.size(), f) == data.size();
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,62 @@
+#ifndef YOLO_DECODE_H
+#define YOLO_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ================== YOLOv8 output decoding ==================
+// Turns the detector's "out0" tensor into candidate boxes. The tensor is
+// rows x num floats, one row per attribute and one column per proposal:
+// cx, cy, w, h, [objectness (YOLOv5-style exports)], then one score row
+// per class. Instead of visiting every row for each proposal (a stride of
+// num floats per read), the decoder walks each class row contiguously and
+// keeps a running max / argmax for all proposals at once, 4 or 8 lanes per
+// instruction (NEON / SSE2 / AVX2, FB_NO_SIMD for scalar as elsewhere).
+// Only proposals that pass the threshold are then looked at one by one.
+//
+// A class subset can be given in two ways:
+//   - YOLO_SUBSET_ONLY: only the subset's rows are read at all, so the
+//     other classes cost nothing. A proposal is scored by its best class
+//     within the subset (an object that is more "person" than "bottle"
+//     can still come out as a bottle if it clears the threshold);
+//   - YOLO_SUBSET_FILTER: every class row is scanned and proposals whose
+//     overall best class is outside the subset are dropped, exactly like
+//     the original per-proposal loop.
+// Buffers are kept in the decoder and reused from call to call.
+
+enum yolo_subset_mode {
+    YOLO_SUBSET_ONLY,
+    YOLO_SUBSET_FILTER
+};
+
+struct yolo_candidate {
+    float x0, y0, x1, y1;       // network input pixels (letterboxed)
+    float score;
+    int label;
+};
+
+struct yolo_decoder {
+    int num_classes;
+    yolo_subset_mode mode;
+    std::vector<int> rows;              // class ids whose rows are scanned, ascending
+    std::vector<char> wanted;           // per class id, for YOLO_SUBSET_FILTER
+    std::vector<float> best;            // per proposal, reused
+    std::vector<int32_t> best_cls;
+    std::vector<yolo_candidate> out;    // result of the last yolo_decode()
+};
+
+// classes / n_classes: the subset (NULL / 0 = all classes).
+void yolo_decoder_init(yolo_decoder &d, int num_classes, const int *classes, int n_classes,
+                       yolo_subset_mode mode = YOLO_SUBSET_ONLY);
+
+// Decode a rows x num tensor whose row k starts at data + k * row_step.
+// Candidates with score >= conf_thresh end up in d.out; returns how many.
+int yolo_decode(yolo_decoder &d, const float *data, size_t row_step, int rows, int num, float conf_thresh);
+
+// Raw tensor files for benchmarks: int32 rows, int32 num, then rows * num
+// floats.
+bool yolo_save_tensor(const char *path, const float *data, size_t row_step, int rows, int num);
+bool yolo_load_tensor(const char *path, std::vector<float> &data, int &rows, int &num);
+
+#endif
@@ -0,0 +1,174 @@
+#include "yolo_model.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <opencv2/imgproc/imgproc.hpp>
+
+const char *yolo_precision_name(yolo_precision p)
+{
+    switch (p) {
+        case YOLO_FP32: return "fp32";
+        case YOLO_FP16: return "fp16";
+        case YOLO_INT8: return "int8";
+    }
+    return "?";
+}
+
+bool yolo_precision_parse(const char *name, yolo_precision &p)
+{
+    if (!name) return false;
+    if (strcmp(name, "fp32") == 0) p = YOLO_FP32;
+    else if (strcmp(name, "fp16") == 0) p = YOLO_FP16;
+    else if (strcmp(name, "int8") == 0) p = YOLO_INT8;
+    else return false;
+    return true;
+}
+
+void yolo_model_paths(const std::string &base, yolo_precision p, std::string &param, std::string &bin)
+{
+    const std::string stem = p == YOLO_INT8 ? base + "-int8" : base;
+    param = stem + ".ncnn.param";
+    bin = stem + ".ncnn.bin";
+}
+
+bool yolo_model_load(ncnn::Net &net, const std::string &base, yolo_precision p, int num_threads)
+{
+    net.opt.num_threads = num_threads;
+    net.opt.use_vulkan_compute = false;
+    net.opt.use_fp16_storage = p != YOLO_FP32;
+    net.opt.use_fp16_packed = p != YOLO_FP32;
+    net.opt.use_fp16_arithmetic = p != YOLO_FP32;
+    net.opt.use_int8_inference = p == YOLO_INT8;
+
+    std::string param, bin;
+    yolo_model_paths(base, p, param, bin);
+    if (net.load_param(param.c_str()) != 0 || net.load_model(bin.c_str()) != 0) {
+        std::cerr << "[ERR] load " << yolo_precision_name(p) << " model failed: " << param << " / " << bin << "\n";
+        return false;
+    }
+    return true;
+}
+
+cv::Mat yolo_letterbox_bgr(const cv::Mat &img, int target, float &scale, int &pad_x, int &pad_y)
+{
+    const int w = img.cols, h = img.rows;
+    const float r = std::min((float)target / w, (float)target / h);
+    const int nw = (int)round(w * r), nh = (int)round(h * r);
+
+    scale = r;
+    pad_x = (target - nw) / 2;
+    pad_y = (target - nh) / 2;
+
+    cv::Mat resized;
+    cv::resize(img, resized, cv::Size(nw, nh));
+
+    cv::Mat canvas(target, target, CV_8UC3, cv::Scalar(0, 0, 0));
+    resized.copyTo(canvas(cv::Rect(pad_x, pad_y, nw, nh)));
+    return canvas;
+}
+
+// a buffer only this pool references, or not allocated yet (ncnn updates
+// refcount atomically)
+static bool buffer_free(const ncnn::Mat &m)
+{
+    return !m.refcount || __atomic_load_n(m.refcount, __ATOMIC_ACQUIRE) == 1;
+}
+
+// A free w x h buffer; its index in i. Buffers keep their size: a free one
+// of the same size is preferred (one whose padding is already written for
+// `geometry`, if any), otherwise a new buffer is added, so inputs of
+// different sizes (full passes at 224 / 320 / 416, ROI mosaics) each keep
+// their own instead of reallocating one another's. Only past
+// YOLO_INPUT_MAX_BUFS is a free buffer of another size recreated.
+static ncnn::Mat &take_buffer(yolo_input &in, int w, int h, int geometry, size_t &i)
+{
+    const size_t none = in.bufs.size();
+    size_t same = none, other = none;
+    for (size_t k = 0; k < in.bufs.size(); k++) {
+        const ncnn::Mat &m = in.bufs[k];
+        if (!buffer_free(m)) continue;
+        if (m.w == w && m.h == h) {
+            if (same == none || in.buf_geometry[k] == geometry) same = k;
+            if (in.buf_geometry[k] == geometry) break;
+        } else if (other == none) {
+            other = k;
+        }
+    }
+
+    i = same;
+    if (i == none) {
+        if (other != none && in.bufs.size() >= YOLO_INPUT_MAX_BUFS) {
+            i = other;                          // too many sizes in use: recreate one
+        } else {
+            i = in.bufs.size();
+            in.bufs.push_back(ncnn::Mat());
+            in.buf_geometry.push_back(-1);
+        }
+        in.bufs[i].create(w, h, 3);
+        in.buf_geometry[i] = -1;
+        in.allocations++;
+    }
+    return in.bufs[i];
+}
+
+ncnn::Mat yolo_letterbox(yolo_input &in, const cv::Mat &img, int target, float &scale, int &pad_x, int &pad_y)
+{
+    if (net_letterbox_geometry(in.lb, img.cols, img.rows, target)) in.geometry++;
+
+    size_t i;
+    ncnn::Mat &m = take_buffer(in, target, target, in.geometry, i);
+    float *planes = (float *)m.data;
+    if (in.buf_geometry[i] != in.geometry) {
+        net_letterbox_pad(in.lb, planes, m.cstep);
+        in.buf_geometry[i] = in.geometry;
+    }
+    net_letterbox_run(in.lb, img.data, img.step, planes, m.cstep);
+
+    scale = in.lb.scale;
+    pad_x = in.lb.pad_x;
+    pad_y = in.lb.pad_y;
+    return m;
+}
+
+ncnn::Mat yolo_mosaic(yolo_input &in, const cv::Mat &img, roi_plan &plan)
+{
+    size_t i;
+    ncnn::Mat &m = take_buffer(in, plan.in_w, plan.in_h, -1, i);
+    in.buf_geometry[i] = -1;                   // padding is per crop: the next full pass rewrites it
+    float *planes = (float *)m.data;
+
+    // cells without a crop (3 crops in 2x2) stay black
+    const int cell = plan.cell;
+    for (int k = plan.n; k < plan.cols * plan.rows; k++) {
+        const int x0 = k % plan.cols * cell, y0 = k / plan.cols * cell;
+        for (int c = 0; c < 3; c++) {
+            const float black = -in.lb.mean[c] * in.lb.norm[c];
+            float *plane = planes + c * m.cstep;
+            for (int y = y0; y < y0 + cell; y++) {
+                float *row = plane + (size_t)y * plan.in_w + x0;
+                std::fill(row, row + cell, black);
+            }
+        }
+    }
+
+    for (int t = 0; t < plan.n; t++) {
+        roi_tile &tile = plan.tile[t];
+        net_letterbox &lb = in.tile_lb[t];
+        lb.rgb = in.lb.rgb;
+        std::copy(in.lb.mean, in.lb.mean + 3, lb.mean);
+        std::copy(in.lb.norm, in.lb.norm + 3, lb.norm);
+        lb.stride = plan.in_w;
+
+        float *cell_planes = planes + (size_t)tile.cell_y * plan.in_w + tile.cell_x;
+        net_letterbox_geometry(lb, tile.w, tile.h, cell);
+        net_letterbox_pad(lb, cell_planes, m.cstep);
+        net_letterbox_run(lb, img.data + (size_t)tile.y * img.step + tile.x * 3, img.step, cell_planes, m.cstep);
+
+        tile.scale = lb.scale;
+        tile.pad_x = lb.pad_x;
+        tile.pad_y = lb.pad_y;
+    }
+    return m;
+}
@@ -0,0 +1,77 @@
+#ifndef YOLO_MODEL_H
+#define YOLO_MODEL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <ncnn/net.h>
+#include "net_letterbox.h"
+#include "roi_detect.h"
+
+// ================== YOLO model loading ==================
+// One place for how the Lab5 detectors load an ncnn YOLOv8 export and
+// feed it, so the live program and the INT8 tooling run the exact same
+// model setup and preprocessing.
+//
+// A model is named by its base path, e.g. "./yolov8n320":
+//   YOLO_FP32 / YOLO_FP16   base.ncnn.param / base.ncnn.bin
+//   YOLO_INT8               base-int8.ncnn.param / base-int8.ncnn.bin,
+//                           made by ncnn2int8 from base.ncnn.* and the
+//                           calibration table (Lab5/part1/yolo_int8)
+// FP16 stores weights and activations as half floats (fp16 arithmetic
+// where the CPU has it); INT8 runs the quantized layers in int8
+// (use_int8_inference) and the rest like FP16.
+
+enum yolo_precision {
+    YOLO_FP32,
+    YOLO_FP16,
+    YOLO_INT8
+};
+
+const char *yolo_precision_name(yolo_precision p);
+
+// "fp32" / "fp16" / "int8"; false for anything else.
+bool yolo_precision_parse(const char *name, yolo_precision &p);
+
+void yolo_model_paths(const std::string &base, yolo_precision p, std::string &param, std::string &bin);
+
+// Set net.opt for p and load the model files. Prints [ERR] and returns
+// false when they cannot be loaded.
+bool yolo_model_load(ncnn::Net &net, const std::string &base, yolo_precision p, int num_threads);
+
+// Reusable network inputs: the letterbox geometry plus a few
+// w x h x 3 ncnn::Mat buffers. A buffer is handed out again once nobody
+// else holds a reference to it (the extractor and the Job have released
+// it), and only for an input of its own size: a pipeline keeps as many
+// per input size as it has inputs of that size in flight, and allocates
+// nothing after the first frames even when sizes alternate (ROI mosaics
+// between full passes). The padding of a buffer is written when it is
+// created or the geometry changes.
+#define YOLO_INPUT_MAX_BUFS 16
+
+struct yolo_input {
+    net_letterbox lb;
+    net_letterbox tile_lb[ROI_MAX];     // yolo_mosaic cells
+    std::vector<ncnn::Mat> bufs;
+    std::vector<int> buf_geometry;      // geometry serial the padding was written for
+    int geometry = 0;
+    uint64_t allocations = 0;           // buffers created
+};
+
+// Letterbox a BGR image (black padding, 0..1 floats) into a target x target
+// network input taken from in, in one pass (net_letterbox.h). scale /
+// pad_x / pad_y map input pixels back: image = (input - pad) / scale.
+// One thread per yolo_input.
+ncnn::Mat yolo_letterbox(yolo_input &in, const cv::Mat &img, int target, float &scale, int &pad_x, int &pad_y);
+
+// An ROI pass input (roi_detect.h): each crop of the plan letterboxed
+// into its cell of a plan.in_w x plan.in_h input, unused cells black.
+// Fills in the tiles' scale / pad_x / pad_y. Same buffers as
+// yolo_letterbox; normalisation and plane order from in.lb.
+ncnn::Mat yolo_mosaic(yolo_input &in, const cv::Mat &img, roi_plan &plan);
+
+// The same geometry as 8-bit BGR pixels via cv::resize (calibration images).
+cv::Mat yolo_letterbox_bgr(const cv::Mat &img, int target, float &scale, int &pad_x, int &pad_y);
+
+#endif
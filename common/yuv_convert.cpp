@@ -0,0 +1,264 @@
+#include "yuv_convert.h"
+
+#include "fb_pack.h"
+
+// ---- BT.601 limited range, Q6 ----
+// c = 1.164 * (Y - 16)       = (Y - 16) * 74.5
+// R = c + 1.596 * (V - 128)  ~ 102 / 64
+// G = c - 0.391 * (U - 128) - 0.813 * (V - 128)  ~ 25 / 64, 52 / 64
+// B = c + 2.018 * (U - 128)  ~ 129 / 64
+// Only B can leave the int16 range, and only above 255; the SIMD code
+// saturates there, which clamps to the same result.
+
+static inline int clamp255(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline void yuv_px(int Y, int U, int V, int &b, int &g, int &r)
+{
+    const int yy = Y - 16, up = U - 128, vp = V - 128;
+    const int c = yy * 74 + (yy >> 1);
+    r = clamp255((c + 102 * vp + 32) >> 6);
+    g = clamp255((c - (25 * up + 52 * vp) + 32) >> 6);
+    b = clamp255((c + 129 * up + 32) >> 6);
+}
+
+#if defined(FB_SIMD_SSE2)
+// 8 pixels, 16-bit lanes in, 16-bit lanes 0..255 out
+static inline void yuv8_sse2(__m128i y, __m128i u, __m128i v, __m128i &b, __m128i &g, __m128i &r)
+{
+    const __m128i k128 = _mm_set1_epi16(128), rnd = _mm_set1_epi16(32);
+    const __m128i zero = _mm_setzero_si128(), k255 = _mm_set1_epi16(255);
+    const __m128i yy = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    const __m128i c = _mm_add_epi16(_mm_mullo_epi16(yy, _mm_set1_epi16(74)), _mm_srai_epi16(yy, 1));
+    const __m128i up = _mm_sub_epi16(u, k128), vp = _mm_sub_epi16(v, k128);
+
+    __m128i rr = _mm_adds_epi16(c, _mm_mullo_epi16(vp, _mm_set1_epi16(102)));
+    __m128i gg = _mm_subs_epi16(c, _mm_add_epi16(_mm_mullo_epi16(up, _mm_set1_epi16(25)),
+                                                 _mm_mullo_epi16(vp, _mm_set1_epi16(52))));
+    __m128i bb = _mm_adds_epi16(c, _mm_mullo_epi16(up, _mm_set1_epi16(129)));
+
+    r = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(rr, rnd), 6), zero), k255);
+    g = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(gg, rnd), 6), zero), k255);
+    b = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(bb, rnd), 6), zero), k255);
+}
+
+// U0 V0 U1 V1 ... (16-bit lanes) -> U0 U0 U1 U1 ... and V0 V0 V1 V1 ...
+static inline void split_uv_sse2(__m128i uv, __m128i &u, __m128i &v)
+{
+    u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+}
+#endif
+
+#if defined(FB_SIMD_NEON)
+static inline void yuv8_neon(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8,
+                             uint16x8_t &b, uint16x8_t &g, uint16x8_t &r)
+{
+    const int16x8_t k128 = vdupq_n_s16(128);
+    const int16x8_t yy = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)), vdupq_n_s16(16));
+    const int16x8_t c = vaddq_s16(vmulq_n_s16(yy, 74), vshrq_n_s16(yy, 1));
+    const int16x8_t up = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), k128);
+    const int16x8_t vp = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), k128);
+
+    int16x8_t rr = vqaddq_s16(c, vmulq_n_s16(vp, 102));
+    int16x8_t gg = vqsubq_s16(c, vaddq_s16(vmulq_n_s16(up, 25), vmulq_n_s16(vp, 52)));
+    int16x8_t bb = vqaddq_s16(c, vmulq_n_s16(up, 129));
+
+    // (x + 32) >> 6, clamped to 0..255
+    r = vmovl_u8(vqrshrun_n_s16(rr, 6));
+    g = vmovl_u8(vqrshrun_n_s16(gg, 6));
+    b = vmovl_u8(vqrshrun_n_s16(bb, 6));
+}
+
+// even / odd pixel results -> two vectors of 8 pixels in order
+template <fb_format F>
+static inline void put_even_odd_neon(uint8_t *dst,
+                                     uint16x8_t be, uint16x8_t ge, uint16x8_t re,
+                                     uint16x8_t bo, uint16x8_t go, uint16x8_t ro)
+{
+    typedef fb_pack<F> P;
+    uint16x8x2_t b = vzipq_u16(be, bo), g = vzipq_u16(ge, go), r = vzipq_u16(re, ro);
+    P::put8(dst, b.val[0], g.val[0], r.val[0]);
+    P::put8(dst + 8 * P::bytes, b.val[1], g.val[1], r.val[1]);
+}
+#endif
+
+// ---- row kernels ----
+
+template <fb_format F>
+static void yuyv_row(const uint8_t *row, const uint8_t *, int x0, int n, uint8_t *dst)
+{
+    typedef fb_pack<F> P;
+    int b, g, r, i = 0;
+
+    // SIMD below needs to start on a pixel pair
+    if ((x0 & 1) && n > 0) {
+        const uint8_t *p = row + 2 * (x0 - 1);
+        yuv_px(p[2], p[1], p[3], b, g, r);
+        P::put(dst, b, g, r);
+        i = 1;
+    }
+
+#if defined(FB_SIMD_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x8x4_t q = vld4_u8(row + 2 * (x0 + i));   // Y0 U Y1 V
+        uint16x8_t be, ge, re, bo, go, ro;
+        yuv8_neon(q.val[0], q.val[1], q.val[3], be, ge, re);
+        yuv8_neon(q.val[2], q.val[1], q.val[3], bo, go, ro);
+        put_even_odd_neon<F>(dst + i * P::bytes, be, ge, re, bo, go, ro);
+    }
+#elif defined(FB_SIMD_SSE2)
+    const __m128i lo8 = _mm_set1_epi16(0x00ff);
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(row + 2 * (x0 + i)));
+        __m128i y = _mm_and_si128(s, lo8), u, v, bb, gg, rr;
+        split_uv_sse2(_mm_srli_epi16(s, 8), u, v);
+        yuv8_sse2(y, u, v, bb, gg, rr);
+        P::put8(dst + i * P::bytes, bb, gg, rr);
+    }
+#endif
+
+    for (; i < n; i++) {
+        const int x = x0 + i;
+        const uint8_t *p = row + 2 * (x & ~1);
+        yuv_px(row[2 * x], p[1], p[3], b, g, r);
+        P::put(dst + i * P::bytes, b, g, r);
+    }
+}
+
+template <fb_format F>
+static void nv12_row(const uint8_t *yrow, const uint8_t *uvrow, int x0, int n, uint8_t *dst)
+{
+    typedef fb_pack<F> P;
+    int b, g, r, i = 0;
+
+    if ((x0 & 1) && n > 0) {
+        yuv_px(yrow[x0], uvrow[x0 - 1], uvrow[x0], b, g, r);
+        P::put(dst, b, g, r);
+        i = 1;
+    }
+
+#if defined(FB_SIMD_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x8x2_t y = vld2_u8(yrow + x0 + i);     // even / odd pixels
+        uint8x8x2_t c = vld2_u8(uvrow + x0 + i);    // U / V
+        uint16x8_t be, ge, re, bo, go, ro;
+        yuv8_neon(y.val[0], c.val[0], c.val[1], be, ge, re);
+        yuv8_neon(y.val[1], c.val[0], c.val[1], bo, go, ro);
+        put_even_odd_neon<F>(dst + i * P::bytes, be, ge, re, bo, go, ro);
+    }
+#elif defined(FB_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(yrow + x0 + i)), zero);
+        __m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(uvrow + x0 + i)), zero);
+        __m128i u, v, bb, gg, rr;
+        split_uv_sse2(uv, u, v);
+        yuv8_sse2(y, u, v, bb, gg, rr);
+        P::put8(dst + i * P::bytes, bb, gg, rr);
+    }
+#endif
+
+    for (; i < n; i++) {
+        const int x = x0 + i;
+        yuv_px(yrow[x], uvrow[x & ~1], uvrow[(x & ~1) + 1], b, g, r);
+        P::put(dst + i * P::bytes, b, g, r);
+    }
+}
+
+static const yuv_row_fn yuyv_kernels[FB_FMT_COUNT] = {
+    NULL,
+    &yuyv_row<FB_FMT_RGB565>,
+    &yuyv_row<FB_FMT_BGR565>,
+    &yuyv_row<FB_FMT_RGB888>,
+    &yuyv_row<FB_FMT_XRGB8888>,
+    &yuyv_row<FB_FMT_ARGB8888>,
+};
+
+static const yuv_row_fn nv12_kernels[FB_FMT_COUNT] = {
+    NULL,
+    &nv12_row<FB_FMT_RGB565>,
+    &nv12_row<FB_FMT_BGR565>,
+    &nv12_row<FB_FMT_RGB888>,
+    &nv12_row<FB_FMT_XRGB8888>,
+    &nv12_row<FB_FMT_ARGB8888>,
+};
+
+yuv_row_fn yuv_row_kernel(yuv_layout layout, fb_format fmt)
+{
+    if (fmt <= FB_FMT_UNKNOWN || fmt >= FB_FMT_COUNT) return NULL;
+    return layout == YUV_NV12 ? nv12_kernels[fmt] : yuyv_kernels[fmt];
+}
+
+// ---- grey ----
+
+void yuv_yuyv_to_gray(const uint8_t *src, size_t src_step, uint8_t *dst, size_t dst_step, int w, int h)
+{
+    for (int y = 0; y < h; y++) {
+        const uint8_t *s = src + (size_t)y * src_step;
+        uint8_t *d = dst + (size_t)y * dst_step;
+        int x = 0;
+#if defined(FB_SIMD_NEON)
+        for (; x + 16 <= w; x += 16)
+            vst1q_u8(d + x, vld2q_u8(s + 2 * x).val[0]);
+#elif defined(FB_SIMD_SSE2)
+        const __m128i lo8 = _mm_set1_epi16(0x00ff);
+        for (; x + 16 <= w; x += 16) {
+            __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(s + 2 * x)), lo8);
+            __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(s + 2 * x + 16)), lo8);
+            _mm_storeu_si128((__m128i *)(d + x), _mm_packus_epi16(a, b));
+        }
+#endif
+        for (; x < w; x++) d[x] = s[2 * x];
+    }
+}
+
+// ---- BGR patch -> YUV ----
+
+static inline uint8_t bgr_y(const uint8_t *p)
+{
+    return (uint8_t)(((66 * p[2] + 129 * p[1] + 25 * p[0] + 128) >> 8) + 16);
+}
+
+// chroma of the average of n pixels whose channel sums are given
+static inline void bgr_uv(int sb, int sg, int sr, int n, uint8_t &u, uint8_t &v)
+{
+    const int b = sb / n, g = sg / n, r = sr / n;
+    u = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    v = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void yuv_store_bgr(yuv_layout layout, const uint8_t *bgr, size_t bgr_step,
+                   uint8_t *y_plane, size_t y_step, uint8_t *uv_plane, size_t uv_step,
+                   int x, int y, int w, int h)
+{
+    if (layout == YUV_YUYV) {
+        for (int r = 0; r < h; r++) {
+            const uint8_t *s = bgr + (size_t)r * bgr_step;
+            uint8_t *d = y_plane + (size_t)(y + r) * y_step + 2 * x;
+            for (int c = 0; c < w; c++) d[2 * c] = bgr_y(s + 3 * c);
+            for (int c = (x & 1); c + 1 < w; c += 2) {
+                const uint8_t *p = s + 3 * c;
+                bgr_uv(p[0] + p[3], p[1] + p[4], p[2] + p[5], 2, d[2 * c + 1], d[2 * c + 3]);
+            }
+        }
+        return;
+    }
+
+    for (int r = 0; r < h; r++) {
+        const uint8_t *s = bgr + (size_t)r * bgr_step;
+        uint8_t *d = y_plane + (size_t)(y + r) * y_step + x;
+        for (int c = 0; c < w; c++) d[c] = bgr_y(s + 3 * c);
+    }
+    for (int r = (y & 1); r + 1 < h; r += 2) {
+        const uint8_t *s0 = bgr + (size_t)r * bgr_step, *s1 = s0 + bgr_step;
+        uint8_t *d = uv_plane + (size_t)((y + r) / 2) * uv_step + x;
+        for (int c = (x & 1); c + 1 < w; c += 2) {
+            const uint8_t *a = s0 + 3 * c, *b = s1 + 3 * c;
+            bgr_uv(a[0] + a[3] + b[0] + b[3], a[1] + a[4] + b[1] + b[4], a[2] + a[5] + b[2] + b[5], 4,
+                   d[c], d[c + 1]);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fb_format.h"
+
+// ================== YUV camera buffer conversion ==================
+// Kernels that read the camera's own YUYV (packed 4:2:2) or NV12 (Y plane +
+// interleaved UV plane, 4:2:0) buffers directly, so a frame does not have
+// to go through BGR888 first:
+//   - grey for detectors is just Y (a view for NV12, a SIMD de-interleave
+//     for YUYV);
+//   - display rows are converted straight into a framebuffer format with
+//     the fb_pack.h stores (FB_FMT_RGB888 doubles as packed BGR24).
+// BT.601 limited range, as cv::COLOR_YUV2BGR_YUYV / _NV12, in Q6 fixed
+// point (within 1 level of the exact result). Vectorised like fb_letterbox
+// (NEON / SSE2, FB_NO_SIMD for scalar only).
+
+enum yuv_layout {
+    YUV_YUYV,
+    YUV_NV12
+};
+
+// Convert pixels [x0, x0 + n) of one image row into n pixels at dst.
+// YUYV: y is the packed row, uv is unused. NV12: y is the luma row and uv
+// the chroma row (image row / 2). Any x0 / n, odd ones included.
+typedef void (*yuv_row_fn)(const uint8_t *y, const uint8_t *uv, int x0, int n, uint8_t *dst);
+
+// Kernel for layout -> fmt; NULL for FB_FMT_UNKNOWN.
+yuv_row_fn yuv_row_kernel(yuv_layout layout, fb_format fmt);
+
+// Y of a YUYV image into an 8-bit grey image.
+void yuv_yuyv_to_gray(const uint8_t *src, size_t src_step, uint8_t *dst, size_t dst_step, int w, int h);
+
+// Write a small packed BGR24 patch back into a YUV image at (x, y); chroma
+// is averaged over each 2x1 (YUYV) / 2x2 (NV12) block, so x (and y for
+// NV12), w and h should be even. Scalar: meant for overlay boxes, not
+// whole frames.
+void yuv_store_bgr(yuv_layout layout, const uint8_t *bgr, size_t bgr_step,
+                   uint8_t *y_plane, size_t y_step, uint8_t *uv_plane, size_t uv_step,
+                   int x, int y, int w, int h);
+
+#endif